@@ -0,0 +1,160 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <assert.h>
+#include <string.h>
+#include <glib.h>
+
+namespace pinyin{
+
+/**
+ * FlatHashMap:
+ *
+ * The open addressing hash table with linear probing, the items are
+ *   stored in the insertion order and only appended.
+ *
+ * KeyTraits provides:
+ *   static guint32 hash(const Key & key);
+ *   static bool equal(const Key & lhs, const Key & rhs);
+ *
+ * Note: the allocated memory is kept across resets,
+ *   the Key and Value are copied by value with GArray.
+ *
+ */
+template <typename Key, typename Value, typename KeyTraits>
+class FlatHashMap{
+private:
+    struct item_t {
+        Key m_key;
+        Value m_value;
+    };
+
+    /* Array of item_t */
+    GArray * m_items;
+    /* Array of guint32, the index plus one of m_items,
+       zero for the empty slot. */
+    GArray * m_slots;
+    /* the number of slots minus one, the number of slots is power of 2. */
+    guint32 m_mask;
+
+    /* no copy. */
+    FlatHashMap(const FlatHashMap & other);
+    FlatHashMap & operator=(const FlatHashMap & other);
+
+    /* returns the slot of the key, or the empty slot to insert. */
+    guint32 find_slot(const Key & key) const {
+        const guint32 * slots = (const guint32 *) m_slots->data;
+        guint32 pos = KeyTraits::hash(key) & m_mask;
+
+        while (slots[pos]) {
+            const item_t * item = &g_array_index
+                (m_items, item_t, slots[pos] - 1);
+            if (KeyTraits::equal(key, item->m_key))
+                break;
+            pos = (pos + 1) & m_mask;
+        }
+
+        return pos;
+    }
+
+    bool rehash(guint32 nslot) {
+        g_array_set_size(m_slots, nslot);
+        memset(m_slots->data, 0, nslot * sizeof(guint32));
+        m_mask = nslot - 1;
+
+        guint32 * slots = (guint32 *) m_slots->data;
+        for (size_t i = 0; i < m_items->len; ++i) {
+            const item_t * item = &g_array_index(m_items, item_t, i);
+            slots[find_slot(item->m_key)] = i + 1;
+        }
+
+        return true;
+    }
+
+public:
+    /* the number of slots must be power of 2. */
+    FlatHashMap(guint32 nslot) {
+        assert(nslot && 0 == (nslot & (nslot - 1)));
+
+        m_items = g_array_new(FALSE, FALSE, sizeof(item_t));
+        m_slots = g_array_new(FALSE, TRUE, sizeof(guint32));
+        m_mask = 0;
+        rehash(nslot);
+    }
+
+    ~FlatHashMap() {
+        g_array_free(m_items, TRUE);
+        m_items = NULL;
+        g_array_free(m_slots, TRUE);
+        m_slots = NULL;
+    }
+
+    /* only reset the used slots, keep the allocated memory. */
+    bool reset() {
+        if (0 == m_items->len)
+            return true;
+
+        memset(m_slots->data, 0, m_slots->len * sizeof(guint32));
+        g_array_set_size(m_items, 0);
+        return true;
+    }
+
+    size_t length() const {
+        return m_items->len;
+    }
+
+    /* the items are in the insertion order. */
+    Value * get_value(size_t index) const {
+        return &g_array_index(m_items, item_t, index).m_value;
+    }
+
+    Value * lookup(const Key & key) const {
+        const guint32 * slots = (const guint32 *) m_slots->data;
+        guint32 slot = slots[find_slot(key)];
+        if (0 == slot)
+            return NULL;
+
+        return get_value(slot - 1);
+    }
+
+    /* the key must not be in this map, returns the default value. */
+    Value * insert(const Key & key) {
+        /* keep the load factor below one half. */
+        if ((m_items->len + 1) * 2 > m_slots->len)
+            rehash(m_slots->len * 2);
+
+        guint32 pos = find_slot(key);
+        assert(0 == g_array_index(m_slots, guint32, pos));
+
+        item_t item;
+        item.m_key = key;
+        g_array_append_val(m_items, item);
+        g_array_index(m_slots, guint32, pos) = m_items->len;
+
+        return get_value(m_items->len - 1);
+    }
+};
+
+};
+
+#endif
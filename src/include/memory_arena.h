@@ -0,0 +1,164 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <string.h>
+#include <glib.h>
+
+namespace pinyin{
+
+/**
+ * MemoryArena:
+ *
+ * The bump allocator of the per-query memory, all the allocated memory
+ *   is released at once by reset.
+ *
+ * Note: the blocks are kept across resets, so the arena stops
+ *   allocating from the heap when the queries are similar.
+ *
+ */
+class MemoryArena{
+private:
+    struct block_t {
+        gchar * m_data;
+        size_t m_size;
+    };
+
+    /* Array of block_t */
+    GArray * m_blocks;
+    size_t m_block_size;
+
+    /* the current block and the used bytes in it. */
+    size_t m_current;
+    size_t m_offset;
+
+    /* the number of the heap allocations since created. */
+    guint32 m_num_allocations;
+
+    /* no copy. */
+    MemoryArena(const MemoryArena & other);
+    MemoryArena & operator=(const MemoryArena & other);
+
+public:
+    /**
+     * MemoryArena::MemoryArena:
+     * @block_size: the size of the blocks allocated from the heap.
+     *
+     * The constructor of the MemoryArena.
+     *
+     */
+    MemoryArena(size_t block_size = 16 * 1024) {
+        m_blocks = g_array_new(FALSE, FALSE, sizeof(block_t));
+        m_block_size = block_size;
+        m_current = 0;
+        m_offset = 0;
+        m_num_allocations = 0;
+    }
+
+    /**
+     * MemoryArena::~MemoryArena:
+     *
+     * The destructor of the MemoryArena.
+     *
+     */
+    ~MemoryArena() {
+        for (size_t i = 0; i < m_blocks->len; ++i)
+            g_free(g_array_index(m_blocks, block_t, i).m_data);
+        g_array_free(m_blocks, TRUE);
+        m_blocks = NULL;
+    }
+
+    /**
+     * MemoryArena::alloc:
+     * @size: the size of the memory in bytes.
+     * @returns: the allocated memory, aligned to the pointer size.
+     *
+     * Allocate the memory, which is valid until the next reset.
+     *
+     */
+    void * alloc(size_t size) {
+        /* align to the pointer size. */
+        size = (size + sizeof(gpointer) - 1) & ~(sizeof(gpointer) - 1);
+
+        for (; m_current < m_blocks->len; ++m_current, m_offset = 0) {
+            block_t * block = &g_array_index(m_blocks, block_t, m_current);
+            if (m_offset + size <= block->m_size) {
+                void * memory = block->m_data + m_offset;
+                m_offset += size;
+                return memory;
+            }
+        }
+
+        /* the large memory gets its own block. */
+        block_t block;
+        block.m_size = MAX(m_block_size, size);
+        block.m_data = (gchar *) g_malloc(block.m_size);
+        g_array_append_val(m_blocks, block);
+        ++m_num_allocations;
+
+        m_current = m_blocks->len - 1;
+        m_offset = size;
+        return block.m_data;
+    }
+
+    /**
+     * MemoryArena::strdup:
+     * @str: the string.
+     * @returns: the copied string.
+     *
+     * Copy the string into the arena.
+     *
+     */
+    gchar * strdup(const gchar * str) {
+        size_t len = strlen(str) + 1;
+        gchar * copy = (gchar *) alloc(len);
+        memcpy(copy, str, len);
+        return copy;
+    }
+
+    /**
+     * MemoryArena::reset:
+     *
+     * Release all the allocated memory, and keep the blocks for re-use.
+     *
+     */
+    void reset() {
+        m_current = 0;
+        m_offset = 0;
+    }
+
+    /**
+     * MemoryArena::get_num_allocations:
+     * @returns: the number of the heap allocations.
+     *
+     * Get the number of the blocks allocated from the heap
+     * since the arena is created.
+     *
+     */
+    guint32 get_num_allocations() const {
+        return m_num_allocations;
+    }
+};
+
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include <math.h>
 #include "novel_types.h"
 #include "pinyin_utils.h"
+#include "flat_hash_map.h"
 #include "phonetic_key_matrix.h"
 #include "ngram.h"
 #include "lookup.h"
@@ -34,7 +35,10 @@ namespace pinyin{
 
 
 /* internal definition */
+/* the default beam width. */
 static const size_t nbeam = 32;
+/* the minimum number of the steps to expand in parallel. */
+static const int parallel_min_steps = 16;
 
 #define LONG_SENTENCE_PENALTY log(1.2f)
 
@@ -177,66 +181,275 @@ static G_GNUC_UNUSED gint trellis_value_compare(const trellis_value_t ** lhs,
     return -((*lhs)->m_poss - (*rhs)->m_poss);
 }
 
-template <gint32 nstore, gint32 nbest>
-class ForwardPhoneticTrellis {
+/* the hash of the lookup key in the trellis step. */
+struct lookup_key_traits {
+    static guint32 hash(const lookup_key_t & key) {
+        /* Fibonacci hashing. */
+        guint32 value = key * 2654435761U;
+        return value ^ (value >> 16);
+    }
+
+    static bool equal(const lookup_key_t & lhs, const lookup_key_t & rhs) {
+        return lhs == rhs;
+    }
+};
+
+/**
+ * ForwardPhoneticStep:
+ *
+ * One step of the forward phonetic trellis, the trellis nodes are
+ *   indexed by the flat hash map.
+ *
+ * Note: the allocated memory is kept across lookups.
+ *
+ */
+template <gint32 nstore>
+class ForwardPhoneticStep {
 private:
-    /* Array of LookupStepIndex */
-    GPtrArray * m_steps_index;
-    /* Array of LookupStepContent */
-    GPtrArray * m_steps_content;
+    FlatHashMap<lookup_key_t, trellis_node<nstore>, lookup_key_traits> m_nodes;
 
 public:
-    ForwardPhoneticTrellis() {
-        m_steps_index = g_ptr_array_new();
-        m_steps_content = g_ptr_array_new();
+    ForwardPhoneticStep() : m_nodes(64) {
     }
 
-    ~ForwardPhoneticTrellis() {
-        clear();
-        g_ptr_array_free(m_steps_index, TRUE);
-        m_steps_index = NULL;
-        g_ptr_array_free(m_steps_content, TRUE);
-        m_steps_content = NULL;
+    /* only reset the used slots, keep the allocated memory. */
+    bool reset() {
+        return m_nodes.reset();
+    }
+
+    size_t length() const {
+        return m_nodes.length();
+    }
+
+    trellis_node<nstore> * get_node(size_t index) const {
+        return m_nodes.get_value(index);
+    }
+
+    trellis_node<nstore> * lookup(lookup_key_t key) const {
+        return m_nodes.lookup(key);
+    }
+
+    /* the key must not be in this step. */
+    trellis_node<nstore> * insert(lookup_key_t key) {
+        return m_nodes.insert(key);
+    }
+};
+
+/* the phrase token between the start and end steps. */
+struct pronunciation_key_t {
+    phrase_token_t m_token;
+    gint32 m_start;
+    gint32 m_end;
+};
+
+struct pronunciation_key_traits {
+    static guint32 hash(const pronunciation_key_t & key) {
+        /* Fibonacci hashing. */
+        guint32 value = (key.m_token ^ ((guint32) key.m_start << 24) ^
+                         ((guint32) key.m_end << 16)) * 2654435761U;
+        return value ^ (value >> 16);
+    }
+
+    static bool equal(const pronunciation_key_t & lhs,
+                      const pronunciation_key_t & rhs) {
+        return lhs.m_token == rhs.m_token &&
+            lhs.m_start == rhs.m_start && lhs.m_end == rhs.m_end;
+    }
+};
+
+/**
+ * PronunciationCache:
+ *
+ * The memo of the pronunciation possibilities of the phrase tokens
+ *   between the start and end steps, indexed by the flat hash map.
+ *
+ * Note: the allocated memory is kept across lookups.
+ *
+ */
+class PronunciationCache {
+private:
+    FlatHashMap<pronunciation_key_t, gfloat,
+                pronunciation_key_traits> m_possibilities;
+
+    /* the statistics of the lookups. */
+    guint32 m_hits;
+    guint32 m_misses;
+
+    static pronunciation_key_t make_key(gint32 start, gint32 end,
+                                        phrase_token_t token) {
+        pronunciation_key_t key;
+        key.m_token = token;
+        key.m_start = start;
+        key.m_end = end;
+        return key;
     }
 
 public:
-    size_t size() const {
-        assert(m_steps_index->len == m_steps_content->len);
-        return m_steps_index->len;
+    PronunciationCache() : m_possibilities(256) {
+        m_hits = 0;
+        m_misses = 0;
     }
 
-    bool clear() {
-        /* clear m_steps_index */
-        for ( size_t i = 0; i < m_steps_index->len; ++i){
-            LookupStepIndex step_index = (LookupStepIndex) g_ptr_array_index(m_steps_index, i);
-            g_hash_table_destroy(step_index);
-            g_ptr_array_index(m_steps_index, i) = NULL;
+    /* only reset the used slots, keep the allocated memory
+       and the statistics. */
+    bool reset() {
+        return m_possibilities.reset();
+    }
+
+    bool lookup(gint32 start, gint32 end, phrase_token_t token,
+                gfloat & poss) {
+        const gfloat * value = m_possibilities.lookup
+            (make_key(start, end, token));
+        if (NULL == value) {
+            ++m_misses;
+            return false;
         }
-        g_ptr_array_set_size(m_steps_index, 0);
 
-        /* clear m_steps_content */
-        for ( size_t i = 0; i < m_steps_content->len; ++i){
-            LookupStepContent step_content = (LookupStepContent) g_ptr_array_index(m_steps_content, i);
-            g_array_free(step_content, TRUE);
-            g_ptr_array_index(m_steps_content, i) = NULL;
+        ++m_hits;
+        poss = *value;
+        return true;
+    }
+
+    /* the key must not be in this cache. */
+    bool insert(gint32 start, gint32 end, phrase_token_t token,
+                gfloat poss) {
+        *m_possibilities.insert(make_key(start, end, token)) = poss;
+        return true;
+    }
+
+    guint32 get_hits() const {
+        return m_hits;
+    }
+
+    guint32 get_misses() const {
+        return m_misses;
+    }
+};
+
+/**
+ * TrellisExpandScratch:
+ *
+ * The memory of one worker of the trellis expansion,
+ *   the parallel workers never share it.
+ *
+ */
+class TrellisExpandScratch {
+public:
+    GArray * m_cached_keys;
+    PhraseItem m_cached_phrase_item;
+    BigramPhraseArray m_bigram_phrase_items;
+    /* the pronunciation possibilities of the current get_nbest_match. */
+    PronunciationCache m_pronunciation_cache;
+
+public:
+    TrellisExpandScratch() {
+        m_cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+        m_bigram_phrase_items = g_array_new
+            (FALSE, FALSE, sizeof(BigramPhraseItem));
+    }
+
+    ~TrellisExpandScratch() {
+        g_array_free(m_cached_keys, TRUE);
+        m_cached_keys = NULL;
+        g_array_free(m_bigram_phrase_items, TRUE);
+        m_bigram_phrase_items = NULL;
+    }
+};
+
+/**
+ * NBestResultExtractor:
+ *
+ * The interface to extract the result of one tail of the trellis,
+ *   used by NBestMatchResults to extract the results on demand.
+ *
+ */
+class NBestResultExtractor {
+public:
+    virtual ~NBestResultExtractor() {}
+
+    virtual bool extract(const trellis_value_t * tail,
+                         /* out */ MatchResult & result) const = 0;
+};
+
+template <gint32 nstore>
+class ForwardPhoneticTrellis;
+
+template <gint32 nstore>
+bool extract_result(const ForwardPhoneticTrellis<nstore> * trellis,
+                    const trellis_value_t * tail,
+                    /* out */ MatchResult & result);
+
+template <gint32 nstore>
+class ForwardPhoneticTrellis : public NBestResultExtractor {
+private:
+    /* Array of ForwardPhoneticStep * */
+    GPtrArray * m_steps;
+    /* the number of used steps, the steps after it are kept for re-use. */
+    gint32 m_nstep;
+
+    ForwardPhoneticStep<nstore> * get_step(gint32 index) const {
+        assert(index < m_nstep);
+        return (ForwardPhoneticStep<nstore> *)
+            g_ptr_array_index(m_steps, index);
+    }
+
+    /* reset the steps in [start, end). */
+    bool reset_steps(gint32 start, gint32 end) {
+        for (gint32 i = m_steps->len; i < end; ++i)
+            g_ptr_array_add(m_steps, new ForwardPhoneticStep<nstore>);
+
+        for (gint32 i = start; i < end; ++i) {
+            ForwardPhoneticStep<nstore> * step =
+                (ForwardPhoneticStep<nstore> *)
+                g_ptr_array_index(m_steps, i);
+            step->reset();
         }
-        g_ptr_array_set_size(m_steps_content, 0);
 
         return true;
     }
 
+public:
+    ForwardPhoneticTrellis() {
+        m_steps = g_ptr_array_new();
+        m_nstep = 0;
+    }
+
+    ~ForwardPhoneticTrellis() {
+        for (size_t i = 0; i < m_steps->len; ++i) {
+            ForwardPhoneticStep<nstore> * step =
+                (ForwardPhoneticStep<nstore> *)
+                g_ptr_array_index(m_steps, i);
+            delete step;
+        }
+        g_ptr_array_free(m_steps, TRUE);
+        m_steps = NULL;
+    }
+
+public:
+    size_t size() const {
+        return m_nstep;
+    }
+
+    bool clear() {
+        /* the steps are reset in prepare. */
+        m_nstep = 0;
+        return true;
+    }
+
     bool prepare(gint32 nstep) {
         /* add null start step */
-        g_ptr_array_set_size(m_steps_index, nstep);
-        g_ptr_array_set_size(m_steps_content, nstep);
-
-        for (int i = 0; i < nstep; ++i) {
-            /* initialize m_steps_index */
-            g_ptr_array_index(m_steps_index, i) = g_hash_table_new(g_direct_hash, g_direct_equal);
-            /* initialize m_steps_content */
-            g_ptr_array_index(m_steps_content, i) = g_array_new(FALSE, FALSE, sizeof(trellis_node<nstore>));
-        }
+        reset_steps(0, nstep);
+        m_nstep = nstep;
+        return true;
+    }
 
+    /* keep the steps until the index, clear the remaining steps,
+       and resize to nstep. */
+    bool truncate(gint32 index, gint32 nstep) {
+        assert(index < (gint32) size() && index < nstep);
+
+        reset_steps(index + 1, nstep);
+        m_nstep = nstep;
         return true;
     }
 
@@ -244,25 +457,19 @@ public:
     bool fill_prefixes(/* in */ TokenVector prefixes) {
         assert(prefixes->len > 0);
 
+        ForwardPhoneticStep<nstore> * initial_step = get_step(0);
+
         for (size_t i = 0; i < prefixes->len; ++i) {
             phrase_token_t token = g_array_index(prefixes, phrase_token_t, i);
             lookup_key_t initial_key = token;
             trellis_value_t initial_value(log(1.f));
             initial_value.m_handles[1] = token;
 
-            trellis_node<nstore> initial_node;
-            check_result(initial_node.eval_item(&initial_value));
-
-            LookupStepContent initial_step_content = (LookupStepContent)
-                g_ptr_array_index(m_steps_content, 0);
-            initial_step_content = g_array_append_val
-                (initial_step_content, initial_node);
-
-            LookupStepIndex initial_step_index = (LookupStepIndex)
-                g_ptr_array_index(m_steps_index, 0);
-            g_hash_table_insert(initial_step_index,
-                                GUINT_TO_POINTER(initial_key),
-                                GUINT_TO_POINTER(initial_step_content->len - 1));
+            trellis_node<nstore> * initial_node =
+                initial_step->lookup(initial_key);
+            if (NULL == initial_node)
+                initial_node = initial_step->insert(initial_key);
+            check_result(initial_node->eval_item(&initial_value));
         }
 
         return true;
@@ -271,17 +478,15 @@ public:
     /* PtrArray of trellis_value_t pointer */
     bool get_candidates(/* in */ gint32 index,
                         /* out */ GPtrArray * candidates) const {
-        LookupStepContent step = (LookupStepContent)
-            g_ptr_array_index(m_steps_content, index);
+        const ForwardPhoneticStep<nstore> * step = get_step(index);
 
         g_ptr_array_set_size(candidates, 0);
 
-        if (0 == step->len)
+        if (0 == step->length())
             return false;
 
-        for (size_t i = 0; i < step->len; ++i) {
-            trellis_node<nstore> * node = &g_array_index
-                (step, trellis_node<nstore>, i);
+        for (size_t i = 0; i < step->length(); ++i) {
+            trellis_node<nstore> * node = step->get_node(i);
 
             // only initialized in the get_candidates method.
             node->number();
@@ -300,39 +505,27 @@ public:
     /* insert candidate */
     bool insert_candidate(gint32 index, lookup_key_t token,
                           const trellis_value_t * candidate) {
-        LookupStepIndex step_index = (LookupStepIndex) g_ptr_array_index(m_steps_index, index);
-        LookupStepContent step_content = (LookupStepContent) g_ptr_array_index(m_steps_content, index);
-
-        gpointer key = NULL, value = NULL;
-        gboolean lookup_result = g_hash_table_lookup_extended
-            (step_index, GUINT_TO_POINTER(token), &key, &value);
+        ForwardPhoneticStep<nstore> * step = get_step(index);
 
-        if (!lookup_result) {
-            trellis_node<nstore> node;
-            check_result(node.eval_item(candidate));
+        trellis_node<nstore> * node = step->lookup(token);
 
-            g_array_append_val(step_content, node);
-            g_hash_table_insert(step_index, GUINT_TO_POINTER(token), GUINT_TO_POINTER(step_content->len - 1));
+        if (NULL == node) {
+            node = step->insert(token);
+            check_result(node->eval_item(candidate));
             return true;
-        } else {
-            size_t node_index = GPOINTER_TO_UINT(value);
-            trellis_node<nstore> * node = &g_array_index
-                (step_content, trellis_node<nstore>, node_index);
-
-            return node->eval_item(candidate);
         }
 
-        abort();
+        return node->eval_item(candidate);
     }
 
-    /* get tails */
+    /* get the top num tails */
     /* Array of trellis_value_t * */
-    bool get_tails(/* out */ GPtrArray * tails) const {
+    bool get_tails(size_t num, /* out */ GPtrArray * tails) const {
         gint32 tail_index = size() - 1;
 
         GPtrArray * candidates = g_ptr_array_new();
         get_candidates(tail_index, candidates);
-        get_top_results<nstore>(nbest, tails, candidates);
+        get_top_results<nstore>(num, tails, candidates);
 
         g_ptr_array_sort(tails, (GCompareFunc)trellis_value_compare);
 
@@ -343,20 +536,12 @@ public:
     /* get candidate */
     bool get_candidate(gint32 index, lookup_key_t token, gint32 sub_index,
                        const trellis_value_t * & candidate) const {
-        LookupStepIndex step_index = (LookupStepIndex) g_ptr_array_index(m_steps_index, index);
-        LookupStepContent step_content = (LookupStepContent) g_ptr_array_index(m_steps_content, index);
+        const ForwardPhoneticStep<nstore> * step = get_step(index);
 
-        gpointer key = NULL, value = NULL;
-        gboolean lookup_result = g_hash_table_lookup_extended
-            (step_index, GUINT_TO_POINTER(token), &key, &value);
-
-        if (!lookup_result)
+        trellis_node<nstore> * node = step->lookup(token);
+        if (NULL == node)
             return false;
 
-        size_t node_index = GPOINTER_TO_UINT(value);
-        trellis_node<nstore> * node = &g_array_index
-            (step_content, trellis_node<nstore>, node_index);
-
         if (sub_index >= node->length())
             return false;
 
@@ -364,10 +549,16 @@ public:
 
         return true;
     }
+
+    /* extract the result of the tail */
+    virtual bool extract(const trellis_value_t * tail,
+                         /* out */ MatchResult & result) const {
+        return extract_result<nstore>(this, tail, result);
+    }
 };
 
-template <gint32 nstore, gint32 nbest>
-bool extract_result(const ForwardPhoneticTrellis<nstore, nbest> * trellis,
+template <gint32 nstore>
+bool extract_result(const ForwardPhoneticTrellis<nstore> * trellis,
                     const trellis_value_t * tail,
                     /* out */ MatchResult & result) {
     /* reset result */
@@ -459,20 +650,38 @@ public:
 };
 
 
+/**
+ * NBestMatchResults:
+ *
+ * The n-best results of the PhoneticLookup, the results after the best one
+ *   are extracted from the trellis when get_result is called.
+ *
+ * Note: the tails are owned by the trellis of the lookup, the results are
+ *   valid until the next get_nbest_match call of the same lookup.
+ *
+ */
 class NBestMatchResults {
 private:
-    /* Array of MatchResult */
+    /* Array of MatchResult, NULL for the result not extracted yet. */
     GPtrArray * m_results;
+    /* Array of const trellis_value_t *, NULL for the copied result. */
+    GPtrArray * m_tails;
+    /* the trellis of the tails. */
+    const NBestResultExtractor * m_extractor;
 
 public:
     NBestMatchResults() {
         m_results = g_ptr_array_new();
+        m_tails = g_ptr_array_new();
+        m_extractor = NULL;
     }
 
     ~NBestMatchResults() {
         clear();
         g_ptr_array_free(m_results, TRUE);
         m_results = NULL;
+        g_ptr_array_free(m_tails, TRUE);
+        m_tails = NULL;
     }
 
 public:
@@ -484,7 +693,20 @@ public:
         if (index >= m_results->len)
             return false;
 
-        result = (MatchResult) g_ptr_array_index(m_results, index);
+        MatchResult array = (MatchResult) g_ptr_array_index(m_results, index);
+
+        /* extract the result on demand. */
+        if (NULL == array) {
+            const trellis_value_t * tail = (const trellis_value_t *)
+                g_ptr_array_index(m_tails, index);
+            assert(NULL != tail && NULL != m_extractor);
+
+            array = g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
+            check_result(m_extractor->extract(tail, array));
+            g_ptr_array_index(m_results, index) = array;
+        }
+
+        result = array;
         return true;
     }
 
@@ -493,9 +715,12 @@ public:
         for (size_t i = 0; i < m_results->len; ++i) {
             MatchResult array =
                 (MatchResult) g_ptr_array_index(m_results, i);
-            g_array_free(array, TRUE);
+            if (array)
+                g_array_free(array, TRUE);
         }
         g_ptr_array_set_size(m_results, 0);
+        g_ptr_array_set_size(m_tails, 0);
+        m_extractor = NULL;
 
         return true;
     }
@@ -508,11 +733,23 @@ public:
         g_array_append_vals(array, result->data, result->len);
 
         g_ptr_array_add(m_results, array);
+        g_ptr_array_add(m_tails, NULL);
+        return true;
+    }
+
+    /* the result is extracted when get_result is called. */
+    bool add_tail(const NBestResultExtractor * extractor,
+                  const trellis_value_t * tail) {
+        assert(NULL == m_extractor || extractor == m_extractor);
+        m_extractor = extractor;
+
+        g_ptr_array_add(m_results, NULL);
+        g_ptr_array_add(m_tails, (gpointer) tail);
         return true;
     }
 };
 
-template <gint32 nstore, gint32 nbest>
+template <gint32 nstore>
 class PhoneticLookup {
 private:
     const gfloat bigram_lambda;
@@ -521,10 +758,63 @@ private:
     /* memory cache */
     GArray * m_cached_keys;
     PhraseItem m_cached_phrase_item;
-    SingleGram m_merged_single_gram;
+    /* the merged single grams of the previous tokens. */
+    MergedSingleGramCache m_bigram_cache;
+    /* log of the total freq of the phrase index, saved in get_nbest_match. */
+    gdouble m_log_total_freq;
+    /* Array of TrellisExpandScratch *, the first one is used by
+       the serial expansion. */
+    GPtrArray * m_scratches;
+
+    /* the memory of get_nbest_match, kept across calls. */
+    PhraseIndexRanges m_ranges;
+    /* Array of trellis_value_t * */
+    GPtrArray * m_candidates;
+    GPtrArray * m_topresults;
+    /* Array of const SingleGram * */
+    GPtrArray * m_grams;
+    /* the number of the prepared ranges since created. */
+    guint32 m_num_allocations;
+
+    /* the parallel expansion, the thread pool is NULL when disabled. */
+    GThreadPool * m_thread_pool;
+    /* the expansion shared with the workers of the thread pool. */
+    GPtrArray * m_task_topresults;
+    GPtrArray * m_task_grams;
+    int m_task_start;
+    int m_task_first;
+    int m_task_last;
+    /* the number of the unfinished tasks. */
+    guint m_task_pending;
+    GMutex m_task_mutex;
+    GCond m_task_cond;
 
 protected:
-    ForwardPhoneticTrellis<nstore, nbest> m_trellis;
+    ForwardPhoneticTrellis<nstore> m_trellis;
+
+    /* the pinyin table search results from one start column. */
+    MatrixSearchResults m_search_results;
+
+    /* saved variables for the incremental mode. */
+    bool m_incremental;
+    bool m_saved;
+    TokenVector m_saved_prefixes;
+    PhoneticKeyMatrix m_saved_matrix;
+    /* Array of trellis_constraint_t */
+    GArray * m_saved_constraints;
+
+    /* the beam of the viterbi search. */
+    size_t m_beam_width;
+    gfloat m_beam_margin;
+    /* Array of guint32, the number of the expanded steps
+       indexed by the number of the expanded states. */
+    GArray * m_beam_histogram;
+
+    /* the number of the n-best results. */
+    size_t m_nbest;
+
+    /* whether the last get_nbest_match ran out of time. */
+    bool m_degraded;
 
 protected:
     /* saved varibles */
@@ -537,7 +827,8 @@ protected:
     Bigram * m_user_bigram;
 
 protected:
-    bool search_unigram2(GPtrArray * topresults,
+    bool search_unigram2(TrellisExpandScratch * scratch,
+                         GPtrArray * topresults,
                          int start, int end,
                          PhraseIndexRanges ranges) {
         if (0 == topresults->len)
@@ -550,7 +841,8 @@ protected:
         check_result(m_constraints->get_constraint(start, constraint));
 
         if (CONSTRAINT_ONESTEP == constraint->m_type) {
-            return unigram_gen_next_step(start, constraint->m_constraint_step,
+            return unigram_gen_next_step(scratch, start,
+                                         constraint->m_constraint_step,
                                          max, constraint->m_token);
         }
 
@@ -565,8 +857,8 @@ protected:
                     PhraseIndexRange * range = &g_array_index(array, PhraseIndexRange, n);
                     for ( phrase_token_t token = range->m_range_begin;
                           token != range->m_range_end; ++token){
-                        found = unigram_gen_next_step(start, end, max, token) ||
-                            found;
+                        found = unigram_gen_next_step
+                            (scratch, start, end, max, token) || found;
                     }
                 }
             }
@@ -575,15 +867,18 @@ protected:
         return found;
     }
 
-    bool search_bigram2(GPtrArray * topresults,
+    /* the grams are loaded by load_bigrams, or NULL to load here. */
+    bool search_bigram2(TrellisExpandScratch * scratch,
+                        GPtrArray * topresults,
+                        GPtrArray * grams,
                         int start, int end,
                         PhraseIndexRanges ranges) {
         const trellis_constraint_t * constraint = NULL;
         check_result(m_constraints->get_constraint(start, constraint));
 
         bool found = false;
-        BigramPhraseArray bigram_phrase_items = g_array_new
-            (FALSE, FALSE, sizeof(BigramPhraseItem));
+        BigramPhraseArray bigram_phrase_items =
+            scratch->m_bigram_phrase_items;
 
         for (size_t i = 0; i < topresults->len; ++i) {
             trellis_value_t * value = (trellis_value_t *)
@@ -591,22 +886,24 @@ protected:
 
             phrase_token_t index_token = value->m_handles[1];
 
-            SingleGram * system = NULL, * user = NULL;
-            m_system_bigram->load(index_token, system);
-            m_user_bigram->load(index_token, user);
+            const SingleGram * merged = NULL;
+            if (grams)
+                merged = (const SingleGram *) g_ptr_array_index(grams, i);
+            else
+                m_bigram_cache.load(index_token, merged);
 
-            if ( !merge_single_gram(&m_merged_single_gram, system, user) )
+            if ( NULL == merged )
                 continue;
 
             if ( CONSTRAINT_ONESTEP == constraint->m_type ){
                 phrase_token_t token = constraint->m_token;
 
                 guint32 freq;
-                if( m_merged_single_gram.get_freq(token, freq) ){
+                if( merged->get_freq(token, freq) ){
                     guint32 total_freq;
-                    m_merged_single_gram.get_total_freq(total_freq);
+                    merged->get_total_freq(total_freq);
                     gfloat bigram_poss = freq / (gfloat) total_freq;
-                    found = bigram_gen_next_step(start,
+                    found = bigram_gen_next_step(scratch, start,
                                                  constraint->m_constraint_step,
                                                  value, token, bigram_poss) || found;
                 }
@@ -622,67 +919,179 @@ protected:
                             &g_array_index(array, PhraseIndexRange, n);
 
                         g_array_set_size(bigram_phrase_items, 0);
-                        m_merged_single_gram.search(range, bigram_phrase_items);
+                        merged->search(range, bigram_phrase_items);
                         for( size_t k = 0; k < bigram_phrase_items->len; ++k) {
                             BigramPhraseItem * item = &g_array_index(bigram_phrase_items, BigramPhraseItem, k);
-                            found = bigram_gen_next_step(start, end, value, item->m_token, item->m_freq) || found;
+                            found = bigram_gen_next_step(scratch, start, end, value, item->m_token, item->m_freq) || found;
                         }
                     }
                 }
             }
-            if (system)
-                delete system;
-            if (user)
-                delete user;
         }
 
-        g_array_free(bigram_phrase_items, TRUE);
         return found;
     }
 
-    bool unigram_gen_next_step(int start, int end,
+    /* load the merged single grams of the top results,
+       which stay valid during the expansion of one step. */
+    bool load_bigrams(GPtrArray * topresults, /* out */ GPtrArray * grams) {
+        g_ptr_array_set_size(grams, 0);
+
+        if (topresults->len > m_bigram_cache.get_capacity())
+            return false;
+
+        for (size_t i = 0; i < topresults->len; ++i) {
+            trellis_value_t * value = (trellis_value_t *)
+                g_ptr_array_index(topresults, i);
+
+            const SingleGram * merged = NULL;
+            m_bigram_cache.load(value->m_handles[1], merged);
+            g_ptr_array_add(grams, (gpointer) merged);
+        }
+
+        return true;
+    }
+
+    /* the same span of the token is computed once in one lookup. */
+    gfloat get_pronunciation_possibility(TrellisExpandScratch * scratch,
+                                         int start, int end,
+                                         phrase_token_t token) {
+        PronunciationCache & cache = scratch->m_pronunciation_cache;
+
+        gfloat pinyin_poss = 0.;
+        if (cache.lookup(start, end, token, pinyin_poss))
+            return pinyin_poss;
+
+        if (ERROR_OK == m_phrase_index->get_phrase_item
+            (token, scratch->m_cached_phrase_item))
+            pinyin_poss = compute_pronunciation_possibility
+                (m_matrix, start, end, scratch->m_cached_keys,
+                 scratch->m_cached_phrase_item);
+
+        cache.insert(start, end, token, pinyin_poss);
+        return pinyin_poss;
+    }
+
+    /* expand the top results of the start step to the steps in
+       [first, last], the worker of index only expands every num steps. */
+    bool expand_steps(TrellisExpandScratch * scratch,
+                      GPtrArray * topresults, GPtrArray * grams,
+                      int start, int first, int last,
+                      guint index, guint num) {
+        bool found = false;
+
+        for (int m = first + index; m <= last; m += num) {
+            if (!(m_search_results.get_result(m) & SEARCH_OK))
+                continue;
+
+            GArray ** step_ranges = m_search_results.get_ranges(m);
+
+            /* assume topresults always contains items. */
+            if (!m_degraded)
+                found = search_bigram2(scratch, topresults, grams,
+                                       start, m, step_ranges) || found;
+            found = search_unigram2(scratch, topresults,
+                                    start, m, step_ranges) || found;
+        }
+
+        return found;
+    }
+
+    static void expand_worker(gpointer data, gpointer user_data) {
+        PhoneticLookup * lookup = (PhoneticLookup *) user_data;
+        guint index = GPOINTER_TO_UINT(data);
+
+        TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+            g_ptr_array_index(lookup->m_scratches, index);
+        lookup->expand_steps(scratch, lookup->m_task_topresults,
+                             lookup->m_task_grams, lookup->m_task_start,
+                             lookup->m_task_first, lookup->m_task_last,
+                             index, lookup->m_scratches->len);
+
+        g_mutex_lock(&lookup->m_task_mutex);
+        --lookup->m_task_pending;
+        g_cond_signal(&lookup->m_task_cond);
+        g_mutex_unlock(&lookup->m_task_mutex);
+    }
+
+    /* each step is expanded by one worker, then the trellis nodes
+       of the step are only updated by the worker. */
+    bool expand_parallel(GPtrArray * topresults, GPtrArray * grams,
+                         int start, int first, int last) {
+        m_task_topresults = topresults;
+        m_task_grams = grams;
+        m_task_start = start;
+        m_task_first = first;
+        m_task_last = last;
+
+        const guint num = m_scratches->len;
+        m_task_pending = num - 1;
+        for (guint i = 1; i < num; ++i)
+            g_thread_pool_push(m_thread_pool, GUINT_TO_POINTER(i), NULL);
+
+        /* the current thread works as the first worker. */
+        TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+            g_ptr_array_index(m_scratches, 0);
+        expand_steps(scratch, topresults, grams, start, first, last, 0, num);
+
+        g_mutex_lock(&m_task_mutex);
+        while (m_task_pending)
+            g_cond_wait(&m_task_cond, &m_task_mutex);
+        g_mutex_unlock(&m_task_mutex);
+
+        m_task_topresults = NULL;
+        m_task_grams = NULL;
+        return true;
+    }
+
+    bool unigram_gen_next_step(TrellisExpandScratch * scratch,
+                               int start, int end,
                                trellis_value_t * cur_step,
                                phrase_token_t token) {
-        if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+        const PhraseUnigramItem * unigram = NULL;
+        if (m_phrase_index->get_unigram_item(token, unigram))
             return false;
 
-        size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-        gdouble elem_poss = m_cached_phrase_item.get_unigram_frequency() /
-            (gdouble) m_phrase_index->get_phrase_index_total_freq();
-        if ( elem_poss < DBL_EPSILON )
+        /* the unigram possibility is zero. */
+        if (0 == unigram->m_freq)
             return false;
 
-        gfloat pinyin_poss = compute_pronunciation_possibility
-            (m_matrix, start, end, m_cached_keys, m_cached_phrase_item);
+        size_t phrase_length = unigram->m_length;
+
+        gfloat pinyin_poss = get_pronunciation_possibility
+            (scratch, start, end, token);
         if (pinyin_poss < FLT_EPSILON )
             return false;
 
         trellis_value_t next_step;
         next_step.m_handles[0] = cur_step->m_handles[1]; next_step.m_handles[1] = token;
         next_step.m_sentence_length = cur_step->m_sentence_length + phrase_length;
-        next_step.m_poss = cur_step->m_poss + log(elem_poss * pinyin_poss * unigram_lambda);
+        next_step.m_poss = cur_step->m_poss +
+            unigram->m_log_freq - m_log_total_freq +
+            log(pinyin_poss * unigram_lambda);
         next_step.m_last_step = start;
         next_step.m_sub_index = cur_step->m_current_index;
 
         return save_next_step(end, &next_step);
     }
 
-    bool bigram_gen_next_step(int start, int end,
+    bool bigram_gen_next_step(TrellisExpandScratch * scratch,
+                              int start, int end,
                               trellis_value_t * cur_step,
                               phrase_token_t token,
                               gfloat bigram_poss) {
-        if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+        const PhraseUnigramItem * unigram = NULL;
+        if (m_phrase_index->get_unigram_item(token, unigram))
             return false;
 
-        size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-        gdouble unigram_poss = m_cached_phrase_item.get_unigram_frequency() /
+        size_t phrase_length = unigram->m_length;
+        gdouble unigram_poss = unigram->m_freq /
             (gdouble) m_phrase_index->get_phrase_index_total_freq();
         if ( bigram_poss < FLT_EPSILON && unigram_poss < DBL_EPSILON )
             return false;
 
-        gfloat pinyin_poss = compute_pronunciation_possibility
-                           (m_matrix, start, end,
-                            m_cached_keys, m_cached_phrase_item);
+        gfloat pinyin_poss = get_pronunciation_possibility
+            (scratch, start, end, token);
         if ( pinyin_poss < FLT_EPSILON )
             return false;
 
@@ -697,11 +1106,109 @@ protected:
         return save_next_step(end, &next_step);
     }
 
+    /* drop the states far below the best state of the step. */
+    bool prune_top_results(GPtrArray * topresults) const {
+        if (m_beam_margin <= 0. || 0 == topresults->len)
+            return false;
+
+        gfloat best = -FLT_MAX;
+        for (size_t i = 0; i < topresults->len; ++i) {
+            const trellis_value_t * value = (const trellis_value_t *)
+                g_ptr_array_index(topresults, i);
+            best = std_lite::max(best, value->m_poss);
+        }
+
+        /* keep the order of the top results. */
+        size_t len = 0;
+        for (size_t i = 0; i < topresults->len; ++i) {
+            trellis_value_t * value = (trellis_value_t *)
+                g_ptr_array_index(topresults, i);
+            if (value->m_poss < best - m_beam_margin)
+                continue;
+            g_ptr_array_index(topresults, len++) = value;
+        }
+        g_ptr_array_set_size(topresults, len);
+
+        return true;
+    }
+
+    bool record_expanded_states(size_t num) {
+        if (num >= m_beam_histogram->len)
+            g_array_set_size(m_beam_histogram, num + 1);
+
+        ++g_array_index(m_beam_histogram, guint32, num);
+        return true;
+    }
+
     bool save_next_step(int index, trellis_value_t * candidate) {
         lookup_key_t token = candidate->m_handles[1];
         return m_trellis.insert_candidate(index, token, candidate);
     }
 
+    /* returns the last unchanged step since the last call,
+       or -1 when all steps need to be re-computed. */
+    int compute_unchanged_step(TokenVector prefixes, int nstep) {
+        if (!m_incremental || !m_saved)
+            return -1;
+
+        if (prefixes->len != m_saved_prefixes->len ||
+            0 != memcmp(prefixes->data, m_saved_prefixes->data,
+                        prefixes->len * sizeof(phrase_token_t)))
+            return -1;
+
+        /* the step 'index' only depends on the columns before it. */
+        int keep = diff_matrix(m_matrix, &m_saved_matrix);
+
+        /* the step 'index' only depends on the constraints until it. */
+        const int length = std_lite::min
+            (m_constraints->length(), (size_t) m_saved_constraints->len);
+        int index = 0;
+        for (; index < length; ++index) {
+            const trellis_constraint_t * constraint = NULL;
+            check_result(m_constraints->get_constraint(index, constraint));
+            const trellis_constraint_t * saved = &g_array_index
+                (m_saved_constraints, trellis_constraint_t, index);
+
+            if (constraint->m_type != saved->m_type)
+                break;
+
+            if (NO_CONSTRAINT != constraint->m_type &&
+                constraint->m_constraint_step != saved->m_constraint_step)
+                break;
+
+            if (CONSTRAINT_ONESTEP == constraint->m_type &&
+                constraint->m_token != saved->m_token)
+                break;
+        }
+
+        /* the different constraint may change its step. */
+        keep = std_lite::min(keep, index - 1);
+        keep = std_lite::min(keep, nstep - 1);
+        keep = std_lite::min(keep, (int) m_trellis.size() - 1);
+
+        return keep;
+    }
+
+    bool save_variables(TokenVector prefixes) {
+        if (!m_incremental)
+            return false;
+
+        g_array_set_size(m_saved_prefixes, 0);
+        g_array_append_vals(m_saved_prefixes, prefixes->data, prefixes->len);
+
+        copy_matrix(&m_saved_matrix, m_matrix);
+
+        g_array_set_size(m_saved_constraints, 0);
+        for (size_t i = 0; i < m_constraints->length(); ++i) {
+            const trellis_constraint_t * constraint = NULL;
+            check_result(m_constraints->get_constraint(i, constraint));
+            g_array_append_val(m_saved_constraints, *constraint);
+        }
+
+        m_saved = true;
+        return true;
+    }
+
 public:
 
     PhoneticLookup(const gfloat lambda,
@@ -710,10 +1217,10 @@ public:
                    Bigram * system_bigram,
                    Bigram * user_bigram)
         : bigram_lambda(lambda),
-          unigram_lambda(1. - lambda)
+          unigram_lambda(1. - lambda),
+          m_bigram_cache(system_bigram, user_bigram),
+          m_search_results(phrase_index)
     {
-        assert(nstore <= nbest);
-
         /* store the pointer. */
         m_pinyin_table = pinyin_table;
         m_phrase_index = phrase_index;
@@ -721,6 +1228,35 @@ public:
         m_user_bigram = user_bigram;
 
         m_cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+        m_log_total_freq = 0.;
+        m_scratches = g_ptr_array_new();
+        g_ptr_array_add(m_scratches, new TrellisExpandScratch);
+
+        memset(m_ranges, 0, sizeof(PhraseIndexRanges));
+        m_candidates = g_ptr_array_new();
+        m_topresults = g_ptr_array_new();
+        m_grams = g_ptr_array_new();
+        m_num_allocations = 0;
+
+        m_thread_pool = NULL;
+        m_task_topresults = NULL;
+        m_task_grams = NULL;
+        m_task_start = m_task_first = m_task_last = 0;
+        m_task_pending = 0;
+        g_mutex_init(&m_task_mutex);
+        g_cond_init(&m_task_cond);
+
+        m_incremental = false;
+        m_saved = false;
+        m_saved_prefixes = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+        m_saved_constraints = g_array_new
+            (FALSE, FALSE, sizeof(trellis_constraint_t));
+
+        m_beam_width = nbeam;
+        m_beam_margin = 0.;
+        m_beam_histogram = g_array_new(FALSE, TRUE, sizeof(guint32));
+        m_nbest = 1;
+        m_degraded = false;
 
         /* the member variables below are saved in get_nbest_match call. */
         m_matrix = NULL;
@@ -728,17 +1264,253 @@ public:
     }
 
     ~PhoneticLookup(){
+        set_parallel(1);
+        g_mutex_clear(&m_task_mutex);
+        g_cond_clear(&m_task_cond);
+
+        for (size_t i = 0; i < m_scratches->len; ++i) {
+            TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+                g_ptr_array_index(m_scratches, i);
+            delete scratch;
+        }
+        g_ptr_array_free(m_scratches, TRUE);
+        m_scratches = NULL;
+
+        m_phrase_index->destroy_ranges(m_ranges);
+        g_ptr_array_free(m_candidates, TRUE);
+        m_candidates = NULL;
+        g_ptr_array_free(m_topresults, TRUE);
+        m_topresults = NULL;
+        g_ptr_array_free(m_grams, TRUE);
+        m_grams = NULL;
+
         g_array_free(m_cached_keys, TRUE);
         m_cached_keys = NULL;
+        g_array_free(m_saved_prefixes, TRUE);
+        m_saved_prefixes = NULL;
+        g_array_free(m_saved_constraints, TRUE);
+        m_saved_constraints = NULL;
+        g_array_free(m_beam_histogram, TRUE);
+        m_beam_histogram = NULL;
+    }
+
+    /**
+     * PhoneticLookup::set_incremental:
+     * @incremental: whether to enable the incremental mode.
+     *
+     * In the incremental mode, get_nbest_match keeps the trellis steps
+     * for the unchanged matrix columns and constraints of the last call.
+     *
+     * Note: call invalidate when the tables or bi-grams are modified.
+     *
+     */
+    void set_incremental(bool incremental) {
+        m_incremental = incremental;
+        m_saved = false;
+    }
+
+    /**
+     * PhoneticLookup::set_beam:
+     * @width: the maximum number of the expanded states in one step.
+     * @margin: the maximum log possibility below the best state of
+     *   the step for the expanded states, zero to disable.
+     *
+     * Set the beam of the viterbi search, the narrow beam is faster
+     * but may miss the best sentence.
+     *
+     */
+    void set_beam(size_t width, gfloat margin) {
+        assert(width > 0 && margin >= 0.);
+        m_beam_width = width;
+        m_beam_margin = margin;
+        /* the saved trellis steps are expanded with the old beam. */
+        m_saved = false;
+    }
+
+    /**
+     * PhoneticLookup::set_nbest:
+     * @nbest: the maximum number of the n-best results.
+     *
+     * Set the number of the n-best results, only the best result is
+     * extracted in get_nbest_match, the others are extracted when
+     * NBestMatchResults::get_result is called.
+     *
+     */
+    void set_nbest(size_t nbest) {
+        assert(nbest > 0);
+        m_nbest = nbest;
+    }
+
+    size_t get_nbest() const {
+        return m_nbest;
+    }
+
+    /**
+     * PhoneticLookup::set_parallel:
+     * @num_threads: the number of the threads to expand the trellis,
+     *   one to disable the parallel expansion.
+     * @returns: whether the set operation is successful.
+     *
+     * Expand the steps of the long input in parallel, the top results
+     * of one step are expanded to the following steps by the threads,
+     * the results are the same as the serial expansion.
+     *
+     * Note: the current thread is one of the threads.
+     *
+     */
+    bool set_parallel(guint num_threads) {
+        if (0 == num_threads)
+            return false;
+
+        if (m_thread_pool) {
+            /* wait for the queued tasks. */
+            g_thread_pool_free(m_thread_pool, FALSE, TRUE);
+            m_thread_pool = NULL;
+        }
+
+        if (num_threads > 1) {
+            m_thread_pool = g_thread_pool_new
+                (expand_worker, this, num_threads - 1, TRUE, NULL);
+            if (NULL == m_thread_pool)
+                num_threads = 1;
+        }
+
+        for (size_t i = m_scratches->len; i < num_threads; ++i)
+            g_ptr_array_add(m_scratches, new TrellisExpandScratch);
+
+        for (size_t i = num_threads; i < m_scratches->len; ++i) {
+            TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+                g_ptr_array_index(m_scratches, i);
+            delete scratch;
+        }
+        g_ptr_array_set_size(m_scratches, num_threads);
+
+        return true;
+    }
+
+    /**
+     * PhoneticLookup::get_beam_histogram:
+     * @returns: the GArray of guint32.
+     *
+     * Get the histogram of the expanded states, the item at index n
+     * is the number of the steps which expanded n states.
+     *
+     */
+    const GArray * get_beam_histogram() const {
+        return m_beam_histogram;
+    }
+
+    /**
+     * PhoneticLookup::reset_beam_histogram:
+     *
+     * Reset the histogram of the expanded states.
+     *
+     */
+    void reset_beam_histogram() {
+        g_array_set_size(m_beam_histogram, 0);
+    }
+
+    /**
+     * PhoneticLookup::is_degraded:
+     * @returns: whether the last get_nbest_match ran out of time.
+     *
+     * Check whether the results of the last get_nbest_match are
+     * the best effort results after the deadline.
+     *
+     */
+    bool is_degraded() const {
+        return m_degraded;
+    }
+
+    /**
+     * PhoneticLookup::invalidate:
+     *
+     * Drop the saved trellis steps of the incremental mode,
+     * and the cached single grams.
+     *
+     */
+    void invalidate() {
+        m_saved = false;
+        m_bigram_cache.clear();
+    }
+
+    /**
+     * PhoneticLookup::get_num_scratch_allocations:
+     * @returns: the number of the prepared ranges.
+     *
+     * Get the number of the ranges prepared by this lookup since created,
+     * the trellis and the single grams are not counted.
+     *
+     */
+    guint32 get_num_scratch_allocations() const {
+        return m_num_allocations +
+            m_search_results.get_num_scratch_allocations();
+    }
+
+    /**
+     * PhoneticLookup::get_bigram_cache:
+     * @returns: the merged single gram cache of this lookup.
+     *
+     * Get the merged single gram cache, which can be shared
+     * with the candidate lookup.
+     *
+     */
+    MergedSingleGramCache * get_bigram_cache() {
+        return &m_bigram_cache;
     }
 
+    /**
+     * PhoneticLookup::get_pronunciation_cache_stats:
+     * @hits: the number of the cached pronunciation possibilities used.
+     * @misses: the number of the computed pronunciation possibilities.
+     *
+     * Get the statistics of the pronunciation possibility memo
+     * since this lookup is created.
+     *
+     */
+    void get_pronunciation_cache_stats(guint32 & hits,
+                                       guint32 & misses) const {
+        hits = 0; misses = 0;
+        for (size_t i = 0; i < m_scratches->len; ++i) {
+            const TrellisExpandScratch * scratch =
+                (const TrellisExpandScratch *)
+                g_ptr_array_index(m_scratches, i);
+            hits += scratch->m_pronunciation_cache.get_hits();
+            misses += scratch->m_pronunciation_cache.get_misses();
+        }
+    }
 
+
+    /**
+     * PhoneticLookup::get_nbest_match:
+     * @prefixes: the prefix tokens before the sentence.
+     * @matrix: the phonetic key matrix.
+     * @constraints: the constraints of the sentence.
+     * @results: the n-best results.
+     * @deadline: the monotonic time in microseconds, zero for no deadline.
+     * @returns: whether the get operation is successful.
+     *
+     * Guess the n-best sentences with the viterbi beam search.
+     *
+     * Note: after the deadline, the remaining steps only expand the best
+     *   state with the unigram, check it with is_degraded.
+     *
+     */
     bool get_nbest_match(TokenVector prefixes,
                          const PhoneticKeyMatrix * matrix,
                          const ForwardPhoneticConstraints * constraints,
-                         NBestMatchResults * results) {
+                         NBestMatchResults * results,
+                         gint64 deadline = 0) {
         m_constraints = constraints;
         m_matrix = matrix;
+        m_degraded = false;
+        m_log_total_freq = log((gdouble)
+                               m_phrase_index->get_phrase_index_total_freq());
+        for (size_t i = 0; i < m_scratches->len; ++i) {
+            TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+                g_ptr_array_index(m_scratches, i);
+            scratch->m_pronunciation_cache.reset();
+        }
 
         int nstep = m_matrix->size();
         if (0 == nstep)
@@ -747,17 +1519,30 @@ public:
         /* free results */
         results->clear();
 
-        m_trellis.clear();
-        m_trellis.prepare(nstep);
+        /* all the steps until the 'keep' step are unchanged. */
+        int keep = compute_unchanged_step(prefixes, nstep);
+
+        if (keep < 0) {
+            m_trellis.clear();
+            m_trellis.prepare(nstep);
+
+            m_trellis.fill_prefixes(prefixes);
+        } else {
+            m_trellis.truncate(keep, nstep);
+        }
 
-        m_trellis.fill_prefixes(prefixes);
+        save_variables(prefixes);
 
-        PhraseIndexRanges ranges;
-        memset(ranges, 0, sizeof(PhraseIndexRanges));
-        m_phrase_index->prepare_ranges(ranges);
+        /* the ranges are kept until the sub phrase indices are changed. */
+        if (m_phrase_index->update_ranges(m_ranges))
+            ++m_num_allocations;
+        GArray ** ranges = m_ranges;
 
-        GPtrArray * candidates = g_ptr_array_new();
-        GPtrArray * topresults = g_ptr_array_new();
+        GPtrArray * candidates = m_candidates;
+        GPtrArray * topresults = m_topresults;
+        GPtrArray * grams = m_grams;
+        TrellisExpandScratch * scratch = (TrellisExpandScratch *)
+            g_ptr_array_index(m_scratches, 0);
 
         /* begin the viterbi beam search. */
         for ( int i = 0; i < nstep - 1; ++i ){
@@ -767,8 +1552,19 @@ public:
             if (CONSTRAINT_NOSEARCH == cur_constraint->m_type)
                 continue;
 
+            /* the time is out, keep the sentence complete
+               with the cheapest expansion. */
+            if (!m_degraded && deadline &&
+                g_get_monotonic_time() >= deadline)
+                m_degraded = true;
+
             m_trellis.get_candidates(i, candidates);
-            get_top_results<nstore>(nbeam, topresults, candidates);
+            if (m_degraded) {
+                get_top_results<nstore>(1, topresults, candidates);
+            } else {
+                get_top_results<nstore>(m_beam_width, topresults, candidates);
+                prune_top_results(topresults);
+            }
 
             if (0 == topresults->len)
                 continue;
@@ -776,6 +1572,12 @@ public:
             if (CONSTRAINT_ONESTEP == cur_constraint->m_type) {
                 int m = cur_constraint->m_constraint_step;
 
+                /* the unchanged step. */
+                if (m <= keep)
+                    continue;
+
+                record_expanded_states(topresults->len);
+
                 m_phrase_index->clear_ranges(ranges);
 
                 /* do one pinyin table search. */
@@ -784,13 +1586,17 @@ public:
 
                 if (retval & SEARCH_OK) {
                     /* assume topresults always contains items. */
-                    search_bigram2(topresults, i, m, ranges),
-                        search_unigram2(topresults, i, m, ranges);
+                    if (!m_degraded)
+                        search_bigram2(scratch, topresults, NULL,
+                                       i, m, ranges);
+                    search_unigram2(scratch, topresults, i, m, ranges);
                 }
 
                 continue;
             }
 
+            /* find the last step before the no search constraint. */
+            int last = i;
             for ( int m = i + 1; m < nstep; ++m ){
                 const trellis_constraint_t * next_constraint = NULL;
                 check_result(m_constraints->get_constraint(m, next_constraint));
@@ -798,44 +1604,59 @@ public:
                 if (CONSTRAINT_NOSEARCH == next_constraint->m_type)
                     break;
 
-                m_phrase_index->clear_ranges(ranges);
+                last = m;
+            }
 
-                /* do one pinyin table search. */
-                int retval = search_matrix(m_pinyin_table, m_matrix,
-                                           i, m, ranges);
+            if (last == i || last <= keep)
+                continue;
 
-                if (retval & SEARCH_OK) {
-                    /* assume topresults always contains items. */
-                    search_bigram2(topresults, i, m, ranges),
-                        search_unigram2(topresults, i, m, ranges);
-                }
+            record_expanded_states(topresults->len);
 
-                /* no longer pinyin */
-                if (!(retval & SEARCH_CONTINUED))
-                    break;
+            /* do the pinyin table search for all steps in one pass. */
+            int retval = search_matrix_all(m_pinyin_table, m_matrix,
+                                           i, last, &m_search_results);
+            if (!(retval & SEARCH_OK))
+                continue;
+
+            /* skip the unchanged steps. */
+            const int first = std_lite::max(i, keep) + 1;
+
+            /* the long input is expanded by the thread pool. */
+            if (m_thread_pool && nstep >= parallel_min_steps &&
+                last > first &&
+                (m_degraded || load_bigrams(topresults, grams))) {
+                expand_parallel(topresults, m_degraded ? NULL : grams,
+                                i, first, last);
+                continue;
             }
+
+            expand_steps(scratch, topresults, NULL, i, first, last, 0, 1);
         }
 
-        m_phrase_index->destroy_ranges(ranges);
+        g_ptr_array_set_size(candidates, 0);
+        g_ptr_array_set_size(topresults, 0);
+        g_ptr_array_set_size(grams, 0);
 
-        g_ptr_array_free(candidates, TRUE);
-        g_ptr_array_free(topresults, TRUE);
+        /* the degraded trellis steps can't be re-used. */
+        if (m_degraded)
+            m_saved = false;
 
-        /* extract every result. */
+        /* only extract the best result here, the others are
+           extracted on demand. */
         GPtrArray * tails = g_ptr_array_new();
-        m_trellis.get_tails(tails);
+        m_trellis.get_tails(m_nbest, tails);
 
-        MatchResult result = g_array_new
-            (TRUE, TRUE, sizeof(phrase_token_t));
         for (size_t i = 0; i < tails->len; ++i) {
             const trellis_value_t * tail = (const trellis_value_t *)
                 g_ptr_array_index(tails, i);
+            results->add_tail(&m_trellis, tail);
+        }
 
-            check_result(extract_result<nstore>(&m_trellis, tail, result));
-            results->add_result(result);
+        if (results->size() > 0) {
+            MatchResult result = NULL;
+            check_result(results->get_result(0, result));
         }
 
-        g_array_free(result, TRUE);
         g_ptr_array_free(tails, TRUE);
 
         return true;
@@ -902,6 +1723,7 @@ public:
                     /* if total_freq is not overflow, then freq won't overflow. */
                     check_result(user->set_freq(token, freq + seed));
                     check_result(m_user_bigram->store(last_token, user));
+                    m_bigram_cache.invalidate(last_token);
                 next:
                     assert(NULL != user);
                     if (user)
@@ -95,7 +95,8 @@ PhraseLookup::PhraseLookup(const gfloat lambda,
                            Bigram * system_bigram,
                            Bigram * user_bigram)
     : bigram_lambda(lambda),
-      unigram_lambda(1. - lambda)
+      unigram_lambda(1. - lambda),
+      m_log_unigram_lambda(log(1. - lambda))
 {
     m_phrase_table = phrase_table;
     m_phrase_index = phrase_index;
@@ -108,6 +109,7 @@ PhraseLookup::PhraseLookup(const gfloat lambda,
     /* the member variables below are saved in get_best_match call. */
     m_sentence = NULL;
     m_sentence_length = 0;
+    m_log_total_freq = 0.;
 }
 
 PhraseLookup::~PhraseLookup(){
@@ -120,6 +122,8 @@ bool PhraseLookup::get_best_match(int sentence_length, ucs4_t sentence[],
                                   MatchResult & result){
     m_sentence_length = sentence_length;
     m_sentence = sentence;
+    m_log_total_freq = log((gdouble)
+                           m_phrase_index->get_phrase_index_total_freq());
     int nstep = m_sentence_length + 1;
 
     clear_steps(m_steps_index, m_steps_content);
@@ -307,18 +311,20 @@ bool PhraseLookup::search_bigram2(int nstep, PhraseTokens tokens){
 bool PhraseLookup::unigram_gen_next_step(int nstep, lookup_value_t * cur_value,
 phrase_token_t token){
 
-    if (m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+    const PhraseUnigramItem * unigram = NULL;
+    if (m_phrase_index->get_unigram_item(token, unigram))
         return false;
 
-    size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-    gdouble elem_poss = m_cached_phrase_item.get_unigram_frequency() / (gdouble)
-        m_phrase_index->get_phrase_index_total_freq();
-    if ( elem_poss < DBL_EPSILON )
+    /* the unigram possibility is zero. */
+    if (0 == unigram->m_freq)
         return false;
 
+    size_t phrase_length = unigram->m_length;
+
     lookup_value_t next_value;
     next_value.m_handles[0] = cur_value->m_handles[1]; next_value.m_handles[1] = token;
-    next_value.m_poss = cur_value->m_poss + log(elem_poss * unigram_lambda);
+    next_value.m_poss = cur_value->m_poss +
+        unigram->m_log_freq - m_log_total_freq + m_log_unigram_lambda;
     next_value.m_last_step = nstep;
 
     return save_next_step(nstep + phrase_length, cur_value, &next_value);
@@ -326,11 +332,12 @@ phrase_token_t token){
 
 bool PhraseLookup::bigram_gen_next_step(int nstep, lookup_value_t * cur_value, phrase_token_t token, gfloat bigram_poss){
 
-    if ( m_phrase_index->get_phrase_item(token, m_cached_phrase_item))
+    const PhraseUnigramItem * unigram = NULL;
+    if (m_phrase_index->get_unigram_item(token, unigram))
         return false;
 
-    size_t phrase_length = m_cached_phrase_item.get_phrase_length();
-    gdouble unigram_poss = m_cached_phrase_item.get_unigram_frequency() /
+    size_t phrase_length = unigram->m_length;
+    gdouble unigram_poss = unigram->m_freq /
         (gdouble) m_phrase_index->get_phrase_index_total_freq();
 
     if ( bigram_poss < FLT_EPSILON && unigram_poss < DBL_EPSILON )
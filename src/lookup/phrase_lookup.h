@@ -44,8 +44,8 @@ class PhraseLookup{
 private:
     const gfloat bigram_lambda;
     const gfloat unigram_lambda;
+    const gdouble m_log_unigram_lambda;
 
-    PhraseItem m_cached_phrase_item;
     SingleGram m_merged_single_gram;
 protected:
     //saved varibles
@@ -64,6 +64,9 @@ protected:
     int m_sentence_length;
     ucs4_t * m_sentence;
 
+    /* log of the total freq of the phrase index */
+    gdouble m_log_total_freq;
+
 protected:
     /* Explicitly search the next phrase,
      *  to avoid double phrase lookup as the next token has only one.
@@ -32,6 +32,9 @@ using namespace pinyin;
 /* reduce bigram frequency affects on candidates sorting */
 #define BIGRAM_FREQUENCY_DISCOUNT 0.1f
 
+/* the default number of the n-best sentences. */
+static const size_t nbest = 3;
+
 /* a glue layer for input method integration. */
 
 typedef GArray * CandidateVector; /* GArray of lookup_candidate_t */
@@ -49,12 +52,10 @@ struct _pinyin_context_t{
     FacadePhraseTable3 * m_phrase_table;
     FacadePhraseIndex * m_phrase_index;
     Bigram * m_system_bigram;
+    /* the optional read-only copy of the system bi-gram. */
+    MmapBigram * m_mmap_system_bigram;
     Bigram * m_user_bigram;
 
-    /* lookups. */
-    PhoneticLookup<2, 3> * m_pinyin_lookup;
-    PhraseLookup * m_phrase_lookup;
-
     /* addon tables. */
     FacadeChewingTable2 * m_addon_pinyin_table;
     FacadePhraseTable3 * m_addon_phrase_table;
@@ -63,6 +64,8 @@ struct _pinyin_context_t{
     char * m_system_dir;
     char * m_user_dir;
     bool m_modified;
+    /* increased when the tables or bi-grams are changed. */
+    guint32 m_serial;
 
     SystemTableInfo2 m_system_table_info;
     UserTableInfo m_user_table_info;
@@ -83,6 +86,22 @@ struct _pinyin_instance_t{
     PhoneticKeyMatrix m_matrix;
     size_t m_parsed_len;
     size_t m_parsed_key_len;
+    /* the keys of the matrix filled by the full pinyin parser,
+       cleared when the matrix is filled by the other parsers. */
+    ChewingKeyVector m_parsed_keys;
+    ChewingKeyRestVector m_parsed_key_rests;
+    pinyin_option_t m_parsed_options;
+    /* the first changed column of the matrix by the last parse. */
+    size_t m_changed_offset;
+    /* the parse steps of the full pinyin parser,
+       the parsers are shared among instances. */
+    PhoneticParseScratch m_parse_scratch;
+
+    /* per-instance lookups, the context is shared among instances. */
+    PhoneticLookup<2> * m_pinyin_lookup;
+    PhraseLookup * m_phrase_lookup;
+    /* the context serial of the last sentence guess. */
+    guint32 m_serial;
 
     /* cached pinyin lookup variables. */
     ForwardPhoneticConstraints * m_constraints;
@@ -90,8 +109,26 @@ struct _pinyin_instance_t{
     TokenVector m_phrase_result;
     CandidateVector m_candidates;
 
+    /* the phrase strings of the candidates, reset with the candidates. */
+    MemoryArena m_arena;
+    /* the pinyin table search results, kept across queries. */
+    MatrixSearchResults * m_search_results;
+    MatrixSearchResults * m_addon_search_results;
+    /* the heap allocations of the pooled scratch before the current query. */
+    guint32 m_saved_scratch_allocations;
+
     /* cache the sort option here. */
     guint m_sort_option;
+
+    /* the cached candidates of all offsets,
+       filled by pinyin_guess_candidates_batch. */
+    /* Array of CandidateVector, indexed by the offset. */
+    GPtrArray * m_lattice;
+    /* the previous token of every offset. */
+    TokenVector m_lattice_prev_tokens;
+    PhoneticKeyMatrix m_lattice_matrix;
+    guint32 m_lattice_serial;
+    guint m_lattice_sort_option;
 };
 
 struct _lookup_candidate_t{
@@ -331,6 +368,7 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
     context->m_system_dir = g_strdup(systemdir);
     context->m_user_dir = g_strdup(userdir);
     context->m_modified = false;
+    context->m_serial = 0;
 
     gchar * filename = g_build_filename
         (context->m_system_dir, SYSTEM_TABLE_INFO, NULL);
@@ -358,6 +396,12 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
     g_free(user_filename);
     g_free(system_filename);
 
+    /* prefer the compact system chewing table when available. */
+    system_filename = g_build_filename
+        (context->m_system_dir, SYSTEM_COMPACT_PINYIN_INDEX, NULL);
+    context->m_pinyin_table->load_compact(system_filename);
+    g_free(system_filename);
+
 
     /* load phrase table */
     context->m_phrase_table = new FacadePhraseTable3;
@@ -396,23 +440,20 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
     context->m_system_bigram->attach(filename, ATTACH_READONLY);
     g_free(filename);
 
+    context->m_mmap_system_bigram = new MmapBigram;
+    filename = g_build_filename(context->m_system_dir,
+                                SYSTEM_MMAP_BIGRAM, NULL);
+    if (!context->m_mmap_system_bigram->attach(filename)) {
+        delete context->m_mmap_system_bigram;
+        context->m_mmap_system_bigram = NULL;
+    }
+    g_free(filename);
+
     context->m_user_bigram = new Bigram;
     filename = g_build_filename(context->m_user_dir, USER_BIGRAM, NULL);
     context->m_user_bigram->load_db(filename);
     g_free(filename);
 
-    gfloat lambda = context->m_system_table_info.get_lambda();
-
-    context->m_pinyin_lookup = new PhoneticLookup<2, 3>
-        (lambda,
-         context->m_pinyin_table, context->m_phrase_index,
-         context->m_system_bigram, context->m_user_bigram);
-
-    context->m_phrase_lookup = new PhraseLookup
-        (lambda,
-         context->m_phrase_table, context->m_phrase_index,
-         context->m_system_bigram, context->m_user_bigram);
-
     /* load addon chewing table. */
     context->m_addon_pinyin_table = new FacadeChewingTable2;
 
@@ -421,6 +462,11 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
     context->m_addon_pinyin_table->load(system_filename, NULL);
     g_free(system_filename);
 
+    system_filename = g_build_filename
+        (context->m_system_dir, ADDON_SYSTEM_COMPACT_PINYIN_INDEX, NULL);
+    context->m_addon_pinyin_table->load_compact(system_filename);
+    g_free(system_filename);
+
     /* load addon phrase table */
     context->m_addon_phrase_table = new FacadePhraseTable3;
 
@@ -445,6 +491,8 @@ pinyin_context_t * pinyin_init(const char * systemdir, const char * userdir){
 
 bool pinyin_load_phrase_library(pinyin_context_t * context,
                                 guint8 index){
+    context->m_serial++;
+
     if (!(index < PHRASE_INDEX_LIBRARY_COUNT))
         return false;
 
@@ -463,6 +511,8 @@ bool pinyin_load_phrase_library(pinyin_context_t * context,
 
 bool pinyin_unload_phrase_library(pinyin_context_t * context,
                                   guint8 index){
+    context->m_serial++;
+
     assert(index < PHRASE_INDEX_LIBRARY_COUNT);
 
     /* default table. */
@@ -656,6 +706,7 @@ void pinyin_end_add_phrases(import_iterator_t * iter){
     /* compact the content memory chunk of phrase index. */
     iter->m_context->m_phrase_index->compact();
     iter->m_context->m_modified = true;
+    iter->m_context->m_serial++;
     delete iter;
 }
 
@@ -1206,9 +1257,8 @@ void pinyin_fini(pinyin_context_t * context){
     delete context->m_phrase_table;
     delete context->m_phrase_index;
     delete context->m_system_bigram;
+    delete context->m_mmap_system_bigram;
     delete context->m_user_bigram;
-    delete context->m_pinyin_lookup;
-    delete context->m_phrase_lookup;
     delete context->m_addon_pinyin_table;
     delete context->m_addon_phrase_table;
     delete context->m_addon_phrase_index;
@@ -1224,6 +1274,7 @@ void pinyin_fini(pinyin_context_t * context){
 bool pinyin_mask_out(pinyin_context_t * context,
                      phrase_token_t mask,
                      phrase_token_t value) {
+    context->m_serial++;
 
     context->m_pinyin_table->mask_out(mask, value);
     context->m_phrase_table->mask_out(mask, value);
@@ -1301,7 +1352,6 @@ bool pinyin_set_options(pinyin_context_t * context,
     context->m_options = options;
 #if 0
     context->m_pinyin_table->set_options(context->m_options);
-    context->m_pinyin_lookup->set_options(context->m_options);
 #endif
     return true;
 }
@@ -1317,6 +1367,29 @@ pinyin_instance_t * pinyin_alloc_instance(pinyin_context_t * context){
 
     instance->m_parsed_len = 0;
     instance->m_parsed_key_len = 0;
+    instance->m_parsed_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    instance->m_parsed_key_rests =
+        g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+    instance->m_parsed_options = 0;
+    instance->m_changed_offset = 0;
+
+    gfloat lambda = context->m_system_table_info.get_lambda();
+
+    instance->m_pinyin_lookup = new PhoneticLookup<2>
+        (lambda,
+         context->m_pinyin_table, context->m_phrase_index,
+         context->m_system_bigram, context->m_user_bigram);
+
+    instance->m_pinyin_lookup->set_incremental(true);
+    instance->m_pinyin_lookup->set_nbest(nbest);
+    instance->m_pinyin_lookup->get_bigram_cache()->set_mmap_system_bigram
+        (context->m_mmap_system_bigram);
+    instance->m_serial = context->m_serial;
+
+    instance->m_phrase_lookup = new PhraseLookup
+        (lambda,
+         context->m_phrase_table, context->m_phrase_index,
+         context->m_system_bigram, context->m_user_bigram);
 
     instance->m_constraints = new ForwardPhoneticConstraints
         (context->m_phrase_index);
@@ -1326,20 +1399,62 @@ pinyin_instance_t * pinyin_alloc_instance(pinyin_context_t * context){
     instance->m_candidates =
         g_array_new(TRUE, TRUE, sizeof(lookup_candidate_t));
 
+    instance->m_search_results =
+        new MatrixSearchResults(context->m_phrase_index);
+    instance->m_addon_search_results =
+        new MatrixSearchResults(context->m_addon_phrase_index);
+    instance->m_saved_scratch_allocations = 0;
+
     instance->m_sort_option =
         SORT_BY_PHRASE_LENGTH | SORT_BY_PINYIN_LENGTH | SORT_BY_FREQUENCY;
 
+    instance->m_lattice = g_ptr_array_new();
+    instance->m_lattice_prev_tokens =
+        g_array_new(TRUE, TRUE, sizeof(phrase_token_t));
+    instance->m_lattice_serial = context->m_serial;
+    instance->m_lattice_sort_option = instance->m_sort_option;
+
     return instance;
 }
 
-static bool _free_candidates(CandidateVector candidates) {
-    /* free candidates */
-    for (size_t i = 0; i < candidates->len; ++i) {
-        lookup_candidate_t * candidate = &g_array_index
-            (candidates, lookup_candidate_t, i);
-        g_free(candidate->m_phrase_string);
+/* the heap allocations of the pooled scratch since created. */
+static guint32 _get_num_scratch_allocations(pinyin_instance_t * instance) {
+    return instance->m_arena.get_num_allocations() +
+        instance->m_search_results->get_num_scratch_allocations() +
+        instance->m_addon_search_results->get_num_scratch_allocations() +
+        instance->m_pinyin_lookup->get_num_scratch_allocations();
+}
+
+static bool _begin_query(pinyin_instance_t * instance) {
+    instance->m_saved_scratch_allocations =
+        _get_num_scratch_allocations(instance);
+    return true;
+}
+
+static bool _free_candidates(pinyin_instance_t * instance) {
+    /* the phrase strings are in the arena. */
+    g_array_set_size(instance->m_candidates, 0);
+    instance->m_arena.reset();
+
+    return true;
+}
+
+static bool _clear_lattice(pinyin_instance_t * instance) {
+    GPtrArray * lattice = instance->m_lattice;
+
+    /* the cached candidates have no phrase strings. */
+    for (size_t i = 0; i < lattice->len; ++i) {
+        CandidateVector candidates =
+            (CandidateVector) g_ptr_array_index(lattice, i);
+        if (NULL == candidates)
+            continue;
+
+        g_array_free(candidates, TRUE);
     }
-    g_array_set_size(candidates, 0);
+    g_ptr_array_set_size(lattice, 0);
+
+    g_array_set_size(instance->m_lattice_prev_tokens, 0);
+    instance->m_lattice_matrix.clear_all();
 
     return true;
 }
@@ -1347,10 +1462,19 @@ static bool _free_candidates(CandidateVector candidates) {
 void pinyin_free_instance(pinyin_instance_t * instance){
     g_free(instance->m_prefix_ucs4);
     g_array_free(instance->m_prefixes, TRUE);
+    g_array_free(instance->m_parsed_keys, TRUE);
+    g_array_free(instance->m_parsed_key_rests, TRUE);
+    delete instance->m_pinyin_lookup;
+    delete instance->m_phrase_lookup;
     delete instance->m_constraints;
     g_array_free(instance->m_phrase_result, TRUE);
-    _free_candidates(instance->m_candidates);
+    _free_candidates(instance);
     g_array_free(instance->m_candidates, TRUE);
+    delete instance->m_search_results;
+    delete instance->m_addon_search_results;
+    _clear_lattice(instance);
+    g_ptr_array_free(instance->m_lattice, TRUE);
+    g_array_free(instance->m_lattice_prev_tokens, TRUE);
 
     delete instance;
 }
@@ -1369,21 +1493,16 @@ static bool pinyin_update_constraints(pinyin_instance_t * instance){
 }
 
 
-bool pinyin_guess_sentence(pinyin_instance_t * instance){
+/* drop the saved trellis when the context is changed. */
+static bool _check_context_serial(pinyin_instance_t * instance){
     pinyin_context_t * & context = instance->m_context;
-    PhoneticKeyMatrix & matrix = instance->m_matrix;
-
-    g_array_set_size(instance->m_prefixes, 0);
-    g_array_append_val(instance->m_prefixes, sentence_start);
 
-    pinyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_nbest_match
-        (instance->m_prefixes,
-         &matrix,
-         instance->m_constraints,
-         &instance->m_nbest_results);
+    if (instance->m_serial == context->m_serial)
+        return false;
 
-    return retval;
+    instance->m_pinyin_lookup->invalidate();
+    instance->m_serial = context->m_serial;
+    return true;
 }
 
 static void _compute_prefixes(pinyin_instance_t * instance,
@@ -1423,26 +1542,103 @@ static void _compute_prefixes(pinyin_instance_t * instance,
     g_array_free(tokenarray, TRUE);
 }
 
-bool pinyin_guess_sentence_with_prefix(pinyin_instance_t * instance,
-                                       const char * prefix){
-    pinyin_context_t * & context = instance->m_context;
+/* the prefix is NULL for no prefix, the deadline is zero for no deadline. */
+static bool _guess_sentence(pinyin_instance_t * instance,
+                            const char * prefix,
+                            gint64 deadline){
     PhoneticKeyMatrix & matrix = instance->m_matrix;
 
     g_array_set_size(instance->m_prefixes, 0);
     g_array_append_val(instance->m_prefixes, sentence_start);
 
-    _compute_prefixes(instance, prefix);
+    if (prefix)
+        _compute_prefixes(instance, prefix);
 
     pinyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_nbest_match
+    _check_context_serial(instance);
+    _begin_query(instance);
+    bool retval = instance->m_pinyin_lookup->get_nbest_match
         (instance->m_prefixes,
          &matrix,
          instance->m_constraints,
-         &instance->m_nbest_results);
+         &instance->m_nbest_results,
+         deadline);
 
     return retval;
 }
 
+bool pinyin_guess_sentence(pinyin_instance_t * instance){
+    return _guess_sentence(instance, NULL, 0);
+}
+
+bool pinyin_guess_sentence_with_prefix(pinyin_instance_t * instance,
+                                       const char * prefix){
+    return _guess_sentence(instance, prefix, 0);
+}
+
+bool pinyin_guess_sentence_with_deadline(pinyin_instance_t * instance,
+                                         guint64 budget_us,
+                                         bool * degraded){
+    /* clamp the budget before the addition overflows. */
+    const gint64 now = g_get_monotonic_time();
+    const gint64 deadline = now +
+        (gint64) MIN(budget_us, (guint64) (G_MAXINT64 - now));
+
+    bool retval = _guess_sentence(instance, NULL, deadline);
+
+    if (degraded)
+        *degraded = instance->m_pinyin_lookup->is_degraded();
+
+    return retval;
+}
+
+bool pinyin_set_beam(pinyin_instance_t * instance,
+                     guint width, gfloat margin){
+    if (margin < 0.)
+        return false;
+
+    if (0 == width)
+        width = nbeam;
+
+    instance->m_pinyin_lookup->set_beam(width, margin);
+    return true;
+}
+
+bool pinyin_get_beam_histogram(pinyin_instance_t * instance,
+                               GArray * histogram){
+    const GArray * beam_histogram =
+        instance->m_pinyin_lookup->get_beam_histogram();
+
+    g_array_set_size(histogram, 0);
+    g_array_append_vals(histogram, beam_histogram->data,
+                        beam_histogram->len);
+    return true;
+}
+
+bool pinyin_reset_beam_histogram(pinyin_instance_t * instance){
+    instance->m_pinyin_lookup->reset_beam_histogram();
+    return true;
+}
+
+bool pinyin_set_nbest(pinyin_instance_t * instance, guint num){
+    if (0 == num)
+        num = nbest;
+
+    instance->m_pinyin_lookup->set_nbest(num);
+    return true;
+}
+
+bool pinyin_set_parallel(pinyin_instance_t * instance, guint num_threads){
+    return instance->m_pinyin_lookup->set_parallel(num_threads);
+}
+
+bool pinyin_get_query_scratch_allocations(pinyin_instance_t * instance,
+                                          guint * count){
+    *count = _get_num_scratch_allocations(instance) -
+        instance->m_saved_scratch_allocations;
+    return true;
+}
+
 bool pinyin_phrase_segment(pinyin_instance_t * instance,
                            const char * sentence){
     pinyin_context_t * & context = instance->m_context;
@@ -1453,7 +1649,7 @@ bool pinyin_phrase_segment(pinyin_instance_t * instance,
 
     g_return_val_if_fail(num_of_chars == ucs4_len, FALSE);
 
-    bool retval = context->m_phrase_lookup->get_best_match
+    bool retval = instance->m_phrase_lookup->get_best_match
         (ucs4_len, ucs4_str, instance->m_phrase_result);
 
     g_free(ucs4_str);
@@ -1481,6 +1677,97 @@ bool pinyin_get_sentence(pinyin_instance_t * instance,
     return retval;
 }
 
+/* the number of the consecutive inputs converted by one worker at once,
+   the incremental parse re-uses the common prefix of the sorted inputs. */
+static const gint convert_batch_chunk = 16;
+
+/* the conversion shared with the workers of pinyin_convert_batch. */
+struct convert_batch_t{
+    pinyin_context_t * m_context;
+    const char ** m_inputs;
+    gint m_num;
+    char ** m_results;
+    /* the next unconverted input, updated atomically. */
+    gint m_next;
+    /* the number of the failed inputs, updated atomically. */
+    gint m_failures;
+};
+
+static gpointer convert_batch_worker(gpointer data){
+    convert_batch_t * batch = (convert_batch_t *) data;
+
+    /* the instance is re-used by all the inputs of the worker. */
+    pinyin_instance_t * instance = pinyin_alloc_instance(batch->m_context);
+
+    gint start = 0;
+    while ((start = g_atomic_int_add(&batch->m_next, convert_batch_chunk))
+           < batch->m_num) {
+        const gint end = MIN(start + convert_batch_chunk, batch->m_num);
+
+        for (gint i = start; i < end; ++i) {
+            char * sentence = NULL;
+            pinyin_parse_more_full_pinyins(instance, batch->m_inputs[i]);
+
+            if (!pinyin_guess_sentence(instance) ||
+                !pinyin_get_sentence(instance, 0, &sentence)) {
+                g_atomic_int_inc(&batch->m_failures);
+                sentence = NULL;
+            }
+
+            batch->m_results[i] = sentence;
+        }
+    }
+
+    pinyin_free_instance(instance);
+    return NULL;
+}
+
+bool pinyin_convert_batch(pinyin_context_t * context,
+                          const char ** inputs,
+                          size_t num,
+                          char ** results,
+                          guint num_threads){
+    if (0 == num_threads)
+        return false;
+
+    /* the index of the inputs is updated atomically as gint. */
+    if (num > (size_t) (G_MAXINT - convert_batch_chunk))
+        return false;
+
+    convert_batch_t batch;
+    batch.m_context = context;
+    batch.m_inputs = inputs;
+    batch.m_num = num;
+    batch.m_results = results;
+    batch.m_next = 0;
+    batch.m_failures = 0;
+
+    /* no idle workers. */
+    const guint num_chunks = (num + convert_batch_chunk - 1) /
+        convert_batch_chunk;
+    num_threads = MAX(1, MIN(num_threads, num_chunks));
+
+    /* Array of GThread * */
+    GPtrArray * threads = g_ptr_array_new();
+    for (guint i = 1; i < num_threads; ++i) {
+        GThread * thread = g_thread_try_new
+            ("pinyin-convert", convert_batch_worker, &batch, NULL);
+        /* the other workers convert the remaining inputs. */
+        if (NULL == thread)
+            break;
+        g_ptr_array_add(threads, thread);
+    }
+
+    /* the current thread works as the first worker. */
+    convert_batch_worker(&batch);
+
+    for (size_t i = 0; i < threads->len; ++i)
+        g_thread_join((GThread *) g_ptr_array_index(threads, i));
+    g_ptr_array_free(threads, TRUE);
+
+    return 0 == batch.m_failures;
+}
+
 bool pinyin_parse_full_pinyin(pinyin_instance_t * instance,
                               const char * onepinyin,
                               ChewingKey * onekey){
@@ -1504,20 +1791,33 @@ size_t pinyin_parse_more_full_pinyins(pinyin_instance_t * instance,
     ChewingKeyRestVector key_rests =
         g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
 
-    int parsed_len = context->m_full_pinyin_parser->parse
-        (options, keys,
+    /* re-use the parse steps of the previous input. */
+    int parsed_len = context->m_full_pinyin_parser->parse_incremental
+        (options, &instance->m_parse_scratch, keys,
          key_rests, pinyins, strlen(pinyins));
 
     instance->m_parsed_len = parsed_len;
     instance->m_parsed_key_len = keys->len;
 
-    fill_matrix(&matrix, keys, key_rests, parsed_len);
+    /* the matrix is filled with the different options. */
+    if (options != instance->m_parsed_options) {
+        g_array_set_size(instance->m_parsed_keys, 0);
+        g_array_set_size(instance->m_parsed_key_rests, 0);
+    }
 
-    resplit_step(options, &matrix);
+    /* only re-fill the columns after the unchanged keys. */
+    instance->m_changed_offset = refill_matrix
+        (options, &matrix,
+         instance->m_parsed_keys, instance->m_parsed_key_rests,
+         keys, key_rests, parsed_len);
 
-    inner_split_step(options, &matrix);
-
-    fuzzy_syllable_step(options, &matrix);
+    /* save the keys of the matrix. */
+    g_array_set_size(instance->m_parsed_keys, 0);
+    g_array_append_vals(instance->m_parsed_keys, keys->data, keys->len);
+    g_array_set_size(instance->m_parsed_key_rests, 0);
+    g_array_append_vals(instance->m_parsed_key_rests,
+                        key_rests->data, key_rests->len);
+    instance->m_parsed_options = options;
 
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
@@ -1558,6 +1858,11 @@ size_t pinyin_parse_more_double_pinyins(pinyin_instance_t * instance,
 
     fuzzy_syllable_step(options, &matrix);
 
+    /* the matrix is not filled by the full pinyin parser. */
+    g_array_set_size(instance->m_parsed_keys, 0);
+    g_array_set_size(instance->m_parsed_key_rests, 0);
+    instance->m_changed_offset = 0;
+
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
     return parsed_len;
@@ -1603,6 +1908,11 @@ size_t pinyin_parse_more_chewings(pinyin_instance_t * instance,
 
     fuzzy_syllable_step(options, &matrix);
 
+    /* the matrix is not filled by the full pinyin parser. */
+    g_array_set_size(instance->m_parsed_keys, 0);
+    g_array_set_size(instance->m_parsed_key_rests, 0);
+    instance->m_changed_offset = 0;
+
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
     return parsed_len;
@@ -1612,6 +1922,10 @@ size_t pinyin_get_parsed_input_length(pinyin_instance_t * instance) {
     return instance->m_parsed_len;
 }
 
+size_t pinyin_get_changed_offset(pinyin_instance_t * instance) {
+    return instance->m_changed_offset;
+}
+
 bool pinyin_in_chewing_keyboard(pinyin_instance_t * instance,
                                 const char key, gchar *** symbols) {
     pinyin_context_t * & context = instance->m_context;
@@ -1645,6 +1959,35 @@ static bool _token_get_phrase(FacadePhraseIndex * phrase_index,
     return true;
 }
 
+/* the phrase string is allocated in the arena. */
+static gchar * _token_get_phrase_in_arena(MemoryArena & arena,
+                                          FacadePhraseIndex * phrase_index,
+                                          phrase_token_t token,
+                                          guint begin) {
+    PhraseItem item;
+    ucs4_t buffer[MAX_PHRASE_LENGTH];
+
+    int retval = phrase_index->get_phrase_item(token, item);
+    if (ERROR_OK != retval)
+        return NULL;
+
+    item.get_phrase_string(buffer);
+    guint length = item.get_phrase_length();
+
+    /* compute the length of the utf8 string first. */
+    size_t utf8_len = 0;
+    for (guint i = begin; i < length; ++i)
+        utf8_len += g_unichar_to_utf8(buffer[i], NULL);
+
+    gchar * utf8_str = (gchar *) arena.alloc(utf8_len + 1);
+    gchar * end = utf8_str;
+    for (guint i = begin; i < length; ++i)
+        end += g_unichar_to_utf8(buffer[i], end);
+    *end = '\0';
+
+    return utf8_str;
+}
+
 #if 0
 static gint compare_item_with_token(gconstpointer lhs,
                                     gconstpointer rhs) {
@@ -1793,7 +2136,7 @@ static void _append_items(PhraseIndexRanges ranges,
 
 static void _compute_frequency_of_items(pinyin_context_t * context,
                                         phrase_token_t prev_token,
-                                        SingleGram * merged_gram,
+                                        const SingleGram * merged_gram,
                                         CandidateVector items) {
     pinyin_option_t & options = context->m_options;
     ssize_t i;
@@ -2004,31 +2347,30 @@ static bool _compute_phrase_strings_of_items(pinyin_instance_t * instance,
         case NBEST_MATCH_CANDIDATE: {
             gchar * sentence = NULL;
             pinyin_get_sentence(instance, candidate->m_nbest_index, &sentence);
-            candidate->m_phrase_string = sentence;
+            candidate->m_phrase_string = sentence ?
+                instance->m_arena.strdup(sentence) : NULL;
+            g_free(sentence);
             break;
         }
         case NORMAL_CANDIDATE:
         case LONGER_CANDIDATE:
         case PREDICTED_BIGRAM_CANDIDATE:
-            _token_get_phrase
-                (instance->m_context->m_phrase_index,
-                 candidate->m_token, 0, NULL,
-                 &(candidate->m_phrase_string));
+            candidate->m_phrase_string = _token_get_phrase_in_arena
+                (instance->m_arena, instance->m_context->m_phrase_index,
+                 candidate->m_token, 0);
             break;
         case PREDICTED_PREFIX_CANDIDATE:
-            _token_get_phrase
-                (instance->m_context->m_phrase_index,
-                 candidate->m_token, candidate->m_begin, NULL,
-                 &(candidate->m_phrase_string));
+            candidate->m_phrase_string = _token_get_phrase_in_arena
+                (instance->m_arena, instance->m_context->m_phrase_index,
+                 candidate->m_token, candidate->m_begin);
             break;
         case PREDICTED_PUNCTUATION_CANDIDATE:
             /* already computed. */
             break;
         case ADDON_CANDIDATE:
-            _token_get_phrase
-                (instance->m_context->m_addon_phrase_index,
-                 candidate->m_token, 0, NULL,
-                 &(candidate->m_phrase_string));
+            candidate->m_phrase_string = _token_get_phrase_in_arena
+                (instance->m_arena, instance->m_context->m_addon_phrase_index,
+                 candidate->m_token, 0);
             break;
         case ZOMBIE_CANDIDATE:
             abort();
@@ -2150,7 +2492,6 @@ static bool _remove_duplicated_items_by_phrase_string
             (candidates, lookup_candidate_t, i);
 
         if (ZOMBIE_CANDIDATE == candidate->m_candidate_type) {
-            g_free(candidate->m_phrase_string);
             g_array_remove_index(candidates, i);
             i--;
         }
@@ -2179,112 +2520,171 @@ static bool _check_offset(PhoneticKeyMatrix & matrix, size_t offset) {
     return true;
 }
 
-bool pinyin_guess_candidates(pinyin_instance_t * instance,
-                             size_t offset,
-                             guint sort_option) {
-
-    pinyin_context_t * & context = instance->m_context;
-    pinyin_option_t & options = context->m_options;
-    PhoneticKeyMatrix & matrix = instance->m_matrix;
-    CandidateVector candidates = instance->m_candidates;
-
-    _free_candidates(candidates);
+/* the zero ChewingKey "'" column. */
+static bool _is_zero_key_column(PhoneticKeyMatrix & matrix, size_t index) {
+    ChewingKey key; ChewingKeyRest key_rest;
+    const ChewingKey zero_key;
 
-    if (0 == matrix.size())
+    /* assume only one zero ChewingKey "'" here, but no check. */
+    if (1 != matrix.get_column_size(index))
         return false;
 
-    instance->m_sort_option = sort_option;
-
-    /* lookup the previous token here. */
-    phrase_token_t prev_token = null_token;
+    matrix.get_item(index, 0, key, key_rest);
+    return zero_key == key;
+}
 
-    if (options & DYNAMIC_ADJUST) {
-        prev_token = _get_previous_token(instance, offset);
-    }
+/* search, compute the frequency and sort the phrase candidates. */
+static bool _compute_phrase_candidates(pinyin_instance_t * instance,
+                                       size_t offset,
+                                       phrase_token_t prev_token,
+                                       guint sort_option,
+                                       MatrixSearchResults & results,
+                                       MatrixSearchResults & addon_results,
+                                       CandidateVector candidates) {
+    pinyin_context_t * & context = instance->m_context;
+    pinyin_option_t & options = context->m_options;
+    PhoneticKeyMatrix & matrix = instance->m_matrix;
 
-    SingleGram merged_gram;
-    SingleGram * system_gram = NULL, * user_gram = NULL;
+    SingleGram empty_gram;
+    const SingleGram * merged_gram = &empty_gram;
 
     if (options & DYNAMIC_ADJUST) {
         if (null_token != prev_token) {
-            context->m_system_bigram->load(prev_token, system_gram);
-            context->m_user_bigram->load(prev_token, user_gram);
-            merge_single_gram(&merged_gram, system_gram, user_gram);
+            MergedSingleGramCache * cache =
+                instance->m_pinyin_lookup->get_bigram_cache();
+            if (!cache->load(prev_token, merged_gram))
+                merged_gram = &empty_gram;
         }
     }
 
-    PhraseIndexRanges ranges;
-    memset(ranges, 0, sizeof(ranges));
-    context->m_phrase_index->prepare_ranges(ranges);
-
-    PhraseIndexRanges addon_ranges;
-    memset(addon_ranges, 0, sizeof(addon_ranges));
-    context->m_addon_phrase_index->prepare_ranges(addon_ranges);
-
-    _check_offset(matrix, offset);
-
     /* matrix reserved one extra slot. */
     const size_t start = offset;
-    for (size_t end = start + 1; end < matrix.size();) {
-        /* do pinyin search. */
-        context->m_phrase_index->clear_ranges(ranges);
-        int retval = search_matrix(context->m_pinyin_table, &matrix,
-                                   start, end, ranges);
 
-        context->m_addon_phrase_index->clear_ranges(addon_ranges);
-        retval = search_matrix(context->m_addon_pinyin_table, &matrix,
-                               start, end, addon_ranges) | retval;
+    /* do pinyin search for all ends in one pass. */
+    search_matrix_all(context->m_pinyin_table, &matrix,
+                      start, matrix.size() - 1, &results);
+    search_matrix_all(context->m_addon_pinyin_table, &matrix,
+                      start, matrix.size() - 1, &addon_results);
+
+    for (size_t end = start + 1; end < matrix.size();) {
+        int retval = results.get_result(end) |
+            addon_results.get_result(end);
 
         if ( !(retval & SEARCH_OK) ) {
             ++end;
             continue;
         }
 
-        lookup_candidate_t template_item;
-        template_item.m_begin = start; template_item.m_end = end;
-        _append_items(ranges, &template_item, candidates);
-
-        lookup_candidate_t addon_template_item;
-        addon_template_item.m_candidate_type = ADDON_CANDIDATE;
-        addon_template_item.m_begin = start;
-        addon_template_item.m_end = end;
-        _append_items(addon_ranges, &addon_template_item, candidates);
+        if (results.get_result(end) & SEARCH_OK) {
+            lookup_candidate_t template_item;
+            template_item.m_begin = start; template_item.m_end = end;
+            _append_items(results.get_ranges(end), &template_item, candidates);
+        }
 
-        if ( !(retval & SEARCH_CONTINUED) )
-            break;
+        if (addon_results.get_result(end) & SEARCH_OK) {
+            lookup_candidate_t addon_template_item;
+            addon_template_item.m_candidate_type = ADDON_CANDIDATE;
+            addon_template_item.m_begin = start;
+            addon_template_item.m_end = end;
+            _append_items(addon_results.get_ranges(end),
+                          &addon_template_item, candidates);
+        }
 
         /* skip the consecutive zero ChewingKey "'",
            to avoid duplicates of candidates. */
         ++end;
-        ChewingKey key; ChewingKeyRest key_rest;
-        const ChewingKey zero_key;
         for (; end < matrix.size(); ++end) {
-            const size_t index = end - 1;
-            const size_t size = matrix.get_column_size(index);
-
-            /* assume only one zero ChewingKey "'" here, but no check. */
-            if (1 != size)
-                break;
-            matrix.get_item(index, 0, key, key_rest);
-
-            if (zero_key != key)
+            if (!_is_zero_key_column(matrix, end - 1))
                 break;
         }
     }
 
-    context->m_phrase_index->destroy_ranges(ranges);
-
     /* post process to sort the candidates */
 
     _compute_phrase_length(context, candidates);
 
-    _compute_frequency_of_items(context, prev_token, &merged_gram, candidates);
+    _compute_frequency_of_items(context, prev_token, merged_gram, candidates);
 
     /* sort the candidates. */
     g_array_sort_with_data
         (candidates, compare_item_with_sort_option,
          GUINT_TO_POINTER(sort_option));
 
+    return true;
+}
+
+/* copy the cached candidates when the lattice is still valid. */
+static bool _load_lattice_candidates(pinyin_instance_t * instance,
+                                     size_t offset,
+                                     phrase_token_t prev_token,
+                                     guint sort_option,
+                                     CandidateVector candidates) {
+    pinyin_context_t * & context = instance->m_context;
+    PhoneticKeyMatrix & matrix = instance->m_matrix;
+    GPtrArray * lattice = instance->m_lattice;
+
+    if (offset >= lattice->len)
+        return false;
+
+    if (instance->m_lattice_serial != context->m_serial ||
+        instance->m_lattice_sort_option != sort_option)
+        return false;
+
+    PhoneticKeyMatrix & lattice_matrix = instance->m_lattice_matrix;
+    if (lattice_matrix.size() != matrix.size() ||
+        diff_matrix(&lattice_matrix, &matrix) != matrix.size())
+        return false;
+
+    if (prev_token != g_array_index
+        (instance->m_lattice_prev_tokens, phrase_token_t, offset))
+        return false;
+
+    CandidateVector cached =
+        (CandidateVector) g_ptr_array_index(lattice, offset);
+    if (NULL == cached)
+        return false;
+
+    g_array_append_vals(candidates, cached->data, cached->len);
+    return true;
+}
+
+bool pinyin_guess_candidates(pinyin_instance_t * instance,
+                             size_t offset,
+                             guint sort_option) {
+
+    pinyin_context_t * & context = instance->m_context;
+    pinyin_option_t & options = context->m_options;
+    PhoneticKeyMatrix & matrix = instance->m_matrix;
+    CandidateVector candidates = instance->m_candidates;
+
+    _begin_query(instance);
+    _free_candidates(instance);
+
+    if (0 == matrix.size())
+        return false;
+
+    /* drop the cached single grams when the context is changed. */
+    _check_context_serial(instance);
+
+    instance->m_sort_option = sort_option;
+
+    /* lookup the previous token here. */
+    phrase_token_t prev_token = null_token;
+
+    if (options & DYNAMIC_ADJUST) {
+        prev_token = _get_previous_token(instance, offset);
+    }
+
+    _check_offset(matrix, offset);
+
+    if (!_load_lattice_candidates(instance, offset, prev_token,
+                                  sort_option, candidates)) {
+        _compute_phrase_candidates(instance, offset, prev_token, sort_option,
+                                   *instance->m_search_results,
+                                   *instance->m_addon_search_results,
+                                   candidates);
+    }
+
     /* post process to remove duplicated candidates */
 
     if (!(sort_option & SORT_WITHOUT_LONGER_CANDIDATE))
@@ -2297,10 +2697,56 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
 
     _remove_duplicated_items_by_phrase_string(instance, instance->m_candidates);
 
-    if (system_gram)
-        delete system_gram;
-    if (user_gram)
-        delete user_gram;
+    return true;
+}
+
+bool pinyin_guess_candidates_batch(pinyin_instance_t * instance,
+                                   guint sort_option) {
+    pinyin_context_t * & context = instance->m_context;
+    pinyin_option_t & options = context->m_options;
+    PhoneticKeyMatrix & matrix = instance->m_matrix;
+    GPtrArray * lattice = instance->m_lattice;
+    TokenVector prev_tokens = instance->m_lattice_prev_tokens;
+
+    _clear_lattice(instance);
+
+    if (0 == matrix.size())
+        return false;
+
+    /* drop the cached single grams when the context is changed. */
+    _check_context_serial(instance);
+
+    _begin_query(instance);
+
+    /* share the prepared ranges among all offsets. */
+    MatrixSearchResults & results = *instance->m_search_results;
+    MatrixSearchResults & addon_results = *instance->m_addon_search_results;
+
+    /* matrix reserved one extra slot. */
+    g_ptr_array_set_size(lattice, matrix.size() - 1);
+    g_array_set_size(prev_tokens, matrix.size() - 1);
+
+    for (size_t offset = 0; offset < matrix.size() - 1; ++offset) {
+        /* the offset can't follow the zero ChewingKey "'". */
+        if (offset > 0 && _is_zero_key_column(matrix, offset - 1))
+            continue;
+
+        phrase_token_t prev_token = null_token;
+        if (options & DYNAMIC_ADJUST)
+            prev_token = _get_previous_token(instance, offset);
+
+        CandidateVector candidates =
+            g_array_new(TRUE, TRUE, sizeof(lookup_candidate_t));
+        _compute_phrase_candidates(instance, offset, prev_token, sort_option,
+                                   results, addon_results, candidates);
+
+        g_ptr_array_index(lattice, offset) = candidates;
+        g_array_index(prev_tokens, phrase_token_t, offset) = prev_token;
+    }
+
+    copy_matrix(&instance->m_lattice_matrix, &matrix);
+    instance->m_lattice_serial = context->m_serial;
+    instance->m_lattice_sort_option = sort_option;
 
     return true;
 }
@@ -2415,7 +2861,8 @@ bool pinyin_guess_predicted_candidates(pinyin_instance_t * instance,
     TokenVector prefixes = instance->m_prefixes;
     phrase_token_t prev_token = null_token;
 
-    _free_candidates(candidates);
+    _begin_query(instance);
+    _free_candidates(instance);
 
     /* search bigram candidate. */
     g_array_set_size(instance->m_prefixes, 0);
@@ -2476,7 +2923,7 @@ bool pinyin_guess_predicted_candidates_with_punctuations(pinyin_instance_t * ins
         for (guint i = 0; i < len; ++i) {
             if (g_strv_contains((gchar **) punct_array->data, puncts[i]))
                 continue;
-            gchar * punct = g_strdup(puncts[i]);
+            gchar * punct = instance->m_arena.strdup(puncts[i]);
             g_array_append_val(punct_array, punct);
         }
 
@@ -2520,6 +2967,7 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
 
     if (LONGER_CANDIDATE == candidate->m_candidate_type) {
         /* only train uni-gram for longer candidate. */
+        context->m_serial++;
         phrase_token_t token = candidate->m_token;
         int error = context->m_phrase_index->add_unigram_frequency
             (token, initial_seed * unigram_factor);
@@ -2530,6 +2978,8 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
     }
 
     if (ADDON_CANDIDATE == candidate->m_candidate_type) {
+        context->m_serial++;
+
         PhraseItem item;
         context->m_addon_phrase_index->get_phrase_item
             (candidate->m_token, item);
@@ -2564,6 +3014,7 @@ int pinyin_choose_candidate(pinyin_instance_t * instance,
         assert(0 == offset);
 
         /* only train uni-gram. */
+        context->m_serial++;
         phrase_token_t token = candidate->m_token;
         int error = context->m_phrase_index->add_unigram_frequency
             (token, initial_seed * unigram_factor);
@@ -2603,6 +3054,7 @@ bool pinyin_choose_predicted_candidate(pinyin_instance_t * instance,
         return true;
 
     /* train uni-gram */
+    context->m_serial++;
     phrase_token_t token = candidate->m_token;
     int error = phrase_index->add_unigram_frequency
         (token, initial_seed * unigram_factor);
@@ -2634,6 +3086,7 @@ bool pinyin_choose_predicted_candidate(pinyin_instance_t * instance,
     }
     check_result(user_gram->set_total_freq(total_freq + initial_seed));
     context->m_user_bigram->store(prev_token, user_gram);
+    instance->m_pinyin_lookup->get_bigram_cache()->invalidate(prev_token);
     delete user_gram;
     return true;
 }
@@ -2677,12 +3130,13 @@ bool pinyin_train(pinyin_instance_t * instance, guint8 index){
         return false;
 
     context->m_modified = true;
+    context->m_serial++;
 
     MatchResult result = NULL;
     assert(index < results.size());
     check_result(results.get_result(index, result));
 
-    bool retval = context->m_pinyin_lookup->train_result3
+    bool retval = instance->m_pinyin_lookup->train_result3
         (&matrix, instance->m_constraints, result);
 
     return retval;
@@ -2691,13 +3145,17 @@ bool pinyin_train(pinyin_instance_t * instance, guint8 index){
 bool pinyin_reset(pinyin_instance_t * instance){
     instance->m_parsed_len = 0;
     instance->m_matrix.clear_all();
+    g_array_set_size(instance->m_parsed_keys, 0);
+    g_array_set_size(instance->m_parsed_key_rests, 0);
+    instance->m_changed_offset = 0;
 
     g_array_set_size(instance->m_prefixes, 0);
 
     instance->m_constraints->clear();
     instance->m_nbest_results.clear();
     g_array_set_size(instance->m_phrase_result, 0);
-    _free_candidates(instance->m_candidates);
+    _free_candidates(instance);
+    _clear_lattice(instance);
 
     return true;
 }
@@ -2835,6 +3293,7 @@ bool pinyin_token_add_unigram_frequency(pinyin_instance_t * instance,
                                         phrase_token_t token,
                                         guint delta){
     pinyin_context_t * & context = instance->m_context;
+    context->m_serial++;
     int retval = context->m_phrase_index->add_unigram_frequency
         (token, delta);
     return ERROR_OK == retval;
@@ -3668,6 +4127,7 @@ bool pinyin_remember_user_input(pinyin_instance_t * instance,
                                 const char * phrase,
                                 gint count) {
     pinyin_context_t * context = instance->m_context;
+    context->m_serial++;
 
     if (NULL == phrase)
         return false;
@@ -3724,6 +4184,7 @@ bool pinyin_is_user_candidate(pinyin_instance_t * instance,
 bool pinyin_remove_user_candidate(pinyin_instance_t * instance,
                                   lookup_candidate_t * candidate) {
     pinyin_context_t * context = instance->m_context;
+    context->m_serial++;
     FacadePhraseIndex * phrase_index = context->m_phrase_index;
     FacadePhraseTable3 * phrase_table = context->m_phrase_table;
     FacadeChewingTable2 * pinyin_table = context->m_pinyin_table;
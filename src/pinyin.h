@@ -387,6 +387,107 @@ bool pinyin_guess_sentence(pinyin_instance_t * instance);
 bool pinyin_guess_sentence_with_prefix(pinyin_instance_t * instance,
                                        const char * prefix);
 
+/**
+ * pinyin_guess_sentence_with_deadline:
+ * @instance: the pinyin instance.
+ * @budget_us: the time budget in microseconds.
+ * @degraded: whether the time budget ran out, or NULL.
+ * @returns: whether the sentence are guessed successfully.
+ *
+ * Guess a sentence from the saved pinyin keys within the time budget,
+ * the remaining steps after the budget only use the unigram,
+ * the guessed sentence is still complete.
+ *
+ */
+bool pinyin_guess_sentence_with_deadline(pinyin_instance_t * instance,
+                                         guint64 budget_us,
+                                         bool * degraded);
+
+/**
+ * pinyin_set_beam:
+ * @instance: the pinyin instance.
+ * @width: the maximum number of the expanded states in one step,
+ *   zero for the default width.
+ * @margin: the maximum log possibility below the best state of the step
+ *   for the expanded states, zero to disable.
+ * @returns: whether the set beam operation is successful.
+ *
+ * Set the beam of the sentence guess, the narrow beam is faster
+ * but may miss the best sentence.
+ *
+ */
+bool pinyin_set_beam(pinyin_instance_t * instance,
+                     guint width, gfloat margin);
+
+/**
+ * pinyin_get_beam_histogram:
+ * @instance: the pinyin instance.
+ * @histogram: the returned GArray of guint32.
+ * @returns: whether the get operation is successful.
+ *
+ * Get the histogram of the expanded states of the sentence guesses,
+ * the item at index n is the number of the steps which expanded n states.
+ *
+ */
+bool pinyin_get_beam_histogram(pinyin_instance_t * instance,
+                               GArray * histogram);
+
+/**
+ * pinyin_reset_beam_histogram:
+ * @instance: the pinyin instance.
+ * @returns: whether the reset operation is successful.
+ *
+ * Reset the histogram of the expanded states.
+ *
+ */
+bool pinyin_reset_beam_histogram(pinyin_instance_t * instance);
+
+/**
+ * pinyin_set_nbest:
+ * @instance: the pinyin instance.
+ * @num: the maximum number of the n-best sentences,
+ *   zero for the default number.
+ * @returns: whether the set operation is successful.
+ *
+ * Set the number of the n-best sentences of the sentence guess,
+ * the sentences after the best one are only extracted when they are
+ * requested by pinyin_get_sentence or the n-best match candidates.
+ *
+ */
+bool pinyin_set_nbest(pinyin_instance_t * instance, guint num);
+
+/**
+ * pinyin_set_parallel:
+ * @instance: the pinyin instance.
+ * @num_threads: the number of the threads to guess the sentence,
+ *   one to disable the parallel guess.
+ * @returns: whether the set operation is successful.
+ *
+ * Guess the sentence of the long input with the threads,
+ * the guessed sentences are the same as the single thread.
+ *
+ */
+bool pinyin_set_parallel(pinyin_instance_t * instance, guint num_threads);
+
+/**
+ * pinyin_get_query_scratch_allocations:
+ * @instance: the pinyin instance.
+ * @count: the number of the heap allocations.
+ * @returns: whether the get operation is successful.
+ *
+ * Get the number of the heap allocations of the pooled scratch
+ * in the last guess of the sentence or the candidates, the pooled
+ * scratch is kept across queries, so the number drops to zero for
+ * the similar queries.
+ *
+ * Note: only the candidate strings and the prepared phrase index ranges
+ *   are pooled, the trellis, the single grams and the results
+ *   are not counted.
+ *
+ */
+bool pinyin_get_query_scratch_allocations(pinyin_instance_t * instance,
+                                          guint * count);
+
 /**
  * pinyin_guess_predicted_candidates:
  * @instance: the pinyin instance.
@@ -439,6 +540,30 @@ bool pinyin_get_sentence(pinyin_instance_t * instance,
                          guint8 index,
                          char ** sentence);
 
+/**
+ * pinyin_convert_batch:
+ * @context: the pinyin context.
+ * @inputs: the full pinyin strings to be converted.
+ * @num: the number of the inputs.
+ * @results: the best sentences of the inputs in the same order,
+ *   NULL for the inputs which can't be converted.
+ * @num_threads: the number of the threads to convert the inputs.
+ * @returns: whether all the inputs are converted.
+ *
+ * Convert many full pinyin strings into sentences in one call, each thread
+ * re-uses one instance for its inputs, as pinyin_parse_more_full_pinyins,
+ * pinyin_guess_sentence and pinyin_get_sentence are called for each input.
+ *
+ * Note: the context should not be changed during the conversion,
+ *   the returned sentences should be freed by g_free().
+ *
+ */
+bool pinyin_convert_batch(pinyin_context_t * context,
+                          const char ** inputs,
+                          size_t num,
+                          char ** results,
+                          guint num_threads);
+
 /**
  * pinyin_parse_full_pinyin:
  * @instance: the pinyin instance.
@@ -527,6 +652,20 @@ size_t pinyin_parse_more_chewings(pinyin_instance_t * instance,
  */
 size_t pinyin_get_parsed_input_length(pinyin_instance_t * instance);
 
+/**
+ * pinyin_get_changed_offset:
+ * @instance: the pinyin instance.
+ * @returns: the offset of the first changed pinyin key.
+ *
+ * Get the offset of the input, from which the parsed keys are changed
+ * by the last pinyin_parse_more_full_pinyins call.
+ *
+ * Note: the keys before the offset are kept from the previous parse,
+ *   the other parsers always return zero.
+ *
+ */
+size_t pinyin_get_changed_offset(pinyin_instance_t * instance);
+
 
 /**
  * pinyin_in_chewing_keyboard:
@@ -555,6 +694,20 @@ bool pinyin_guess_candidates(pinyin_instance_t * instance,
                              size_t offset,
                              guint sort_option);
 
+/**
+ * pinyin_guess_candidates_batch:
+ * @instance: the pinyin instance.
+ * @sort_option: the sort option.
+ * @returns: whether the candidates of all offsets are computed.
+ *
+ * Guess the candidates at all offsets in one pass, then
+ * pinyin_guess_candidates at any offset uses the cached candidates,
+ * until the pinyin keys, the previous token or the sort option change.
+ *
+ */
+bool pinyin_guess_candidates_batch(pinyin_instance_t * instance,
+                                   guint sort_option);
+
 /**
  * pinyin_choose_candidate:
  * @instance: the pinyin instance.
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include "novel_types.h"
 #include "memory_chunk.h"
+#include "memory_arena.h"
 #include "pinyin_custom2.h"
 #include "chewing_key.h"
 #include "pinyin_utils.h"
@@ -33,12 +34,14 @@
 #include "phonetic_key_matrix.h"
 #include "pinyin_phrase3.h"
 #include "chewing_large_table2.h"
+#include "chewing_compact_table.h"
 #include "phrase_large_table3.h"
 #include "facade_chewing_table2.h"
 #include "facade_phrase_table3.h"
 #include "phrase_index.h"
 #include "phrase_index_logger.h"
 #include "ngram.h"
+#include "ngram_mmap.h"
 #include "lookup.h"
 #include "phonetic_lookup.h"
 #include "phrase_lookup.h"
@@ -55,6 +58,7 @@
 #define SYSTEM_TABLE_INFO "table.conf"
 #define USER_TABLE_INFO "user.conf"
 #define SYSTEM_BIGRAM "bigram.db"
+#define SYSTEM_MMAP_BIGRAM "bigram.bin"
 #define USER_BIGRAM "user_bigram.db"
 #define DELETED_BIGRAM "deleted_bigram.db"
 #define SYSTEM_PINYIN_INDEX "pinyin_index.bin"
@@ -63,6 +67,8 @@
 #define USER_PHRASE_INDEX "user_phrase_index.bin"
 #define ADDON_SYSTEM_PINYIN_INDEX "addon_pinyin_index.bin"
 #define ADDON_SYSTEM_PHRASE_INDEX "addon_phrase_index.bin"
+#define SYSTEM_COMPACT_PINYIN_INDEX "compact_pinyin_index.bin"
+#define ADDON_SYSTEM_COMPACT_PINYIN_INDEX "addon_compact_pinyin_index.bin"
 #define SYSTEM_PUNCT_TABLE "punct.bin"
 
 
@@ -22,6 +22,7 @@
 #define BDB_UTILS_H
 
 #include <assert.h>
+#include <stdlib.h>
 #include <db.h>
 
 namespace pinyin{
@@ -39,6 +40,13 @@ inline u_int32_t attach_options(guint32 flags) {
     return db_flags;
 }
 
+/* the DB handles shared by the lookup threads are opened with DB_THREAD,
+   then every DBT returned by the handle needs DB_DBT_MALLOC,
+   DB_DBT_REALLOC or DB_DBT_USERMEM. */
+inline u_int32_t attach_thread_options(guint32 flags) {
+    return attach_options(flags) | DB_THREAD;
+}
+
 
 inline bool copy_bdb(DB * srcdb, DB * destdb) {
     int ret = 0;
@@ -51,21 +59,22 @@ inline bool copy_bdb(DB * srcdb, DB * destdb) {
     if (NULL == cursorp)
         return false;
 
-    /* Initialize our DBTs. */
+    /* Initialize our DBTs, the buffers are re-used by each record. */
     memset(&key, 0, sizeof(DBT));
     memset(&data, 0, sizeof(DBT));
+    key.flags = DB_DBT_REALLOC;
+    data.flags = DB_DBT_REALLOC;
 
     /* Iterate over the database, retrieving each record in turn. */
     while ((ret = cursorp->c_get(cursorp, &key, &data, DB_NEXT)) == 0) {
         ret = destdb->put(destdb, NULL, &key, &data, 0);
         assert(0 == ret);
-
-        /* Initialize our DBTs. */
-        memset(&key, 0, sizeof(DBT));
-        memset(&data, 0, sizeof(DBT));
     }
     assert(DB_NOTFOUND == ret);
 
+    free(key.data);
+    free(data.data);
+
     /* Cursors must be closed */
     if ( cursorp != NULL )
         cursorp->c_close(cursorp);
@@ -0,0 +1,133 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bloom_filter.h"
+#include <assert.h>
+
+using namespace pinyin;
+
+/* about 1% false positive rate with 10 bits per key and 7 probes. */
+static const guint32 bits_per_key = 10;
+static const guint32 num_probes = 7;
+static const guint32 min_num_bits = 1024;
+
+BloomFilter::BloomFilter(){
+    m_bits = NULL;
+    m_mask = 0;
+    m_capacity = 0;
+    m_num_keys = 0;
+    m_rejects = 0;
+}
+
+BloomFilter::~BloomFilter(){
+    disable();
+}
+
+/* FNV-1a with the final mix of MurmurHash3. */
+guint64 BloomFilter::hash(const void * key, size_t len){
+    const guchar * data = (const guchar *) key;
+
+    guint64 value = G_GUINT64_CONSTANT(14695981039346656037);
+    for (size_t i = 0; i < len; ++i) {
+        value ^= data[i];
+        value *= G_GUINT64_CONSTANT(1099511628211);
+    }
+
+    value ^= value >> 33;
+    value *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    value ^= value >> 33;
+    value *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    value ^= value >> 33;
+    return value;
+}
+
+bool BloomFilter::init(guint32 capacity){
+    disable();
+
+    guint64 num_bits = min_num_bits;
+    while (num_bits < (guint64) capacity * bits_per_key)
+        num_bits <<= 1;
+
+    /* too large for the filter. */
+    if (num_bits > G_GUINT64_CONSTANT(1) << 32)
+        return false;
+
+    m_bits = g_new0(guint64, num_bits / 64);
+    m_mask = num_bits - 1;
+    m_capacity = num_bits / bits_per_key;
+    m_num_keys = 0;
+    return true;
+}
+
+void BloomFilter::disable(){
+    g_free(m_bits);
+    m_bits = NULL;
+    m_mask = 0;
+    m_capacity = 0;
+    m_num_keys = 0;
+}
+
+bool BloomFilter::add(const void * key, size_t len){
+    if (NULL == m_bits)
+        return false;
+
+    /* the false positive rate is too high, disable it. */
+    if (m_num_keys >= 2 * m_capacity) {
+        disable();
+        return false;
+    }
+
+    const guint64 value = hash(key, len);
+    const guint32 h1 = value;
+    /* odd step to visit different bits. */
+    const guint32 h2 = (value >> 32) | 1;
+
+    bool added = false;
+    for (guint32 i = 0; i < num_probes; ++i) {
+        const guint32 bit = (h1 + i * h2) & m_mask;
+        const guint64 flag = G_GUINT64_CONSTANT(1) << (bit % 64);
+        added = added || !(m_bits[bit / 64] & flag);
+        m_bits[bit / 64] |= flag;
+    }
+
+    /* the shared prefixes are added many times, count the new keys only. */
+    if (added)
+        ++m_num_keys;
+    return true;
+}
+
+bool BloomFilter::may_contain(const void * key, size_t len) const{
+    if (NULL == m_bits)
+        return true;
+
+    const guint64 value = hash(key, len);
+    const guint32 h1 = value;
+    const guint32 h2 = (value >> 32) | 1;
+
+    for (guint32 i = 0; i < num_probes; ++i) {
+        const guint32 bit = (h1 + i * h2) & m_mask;
+        if (!(m_bits[bit / 64] & (G_GUINT64_CONSTANT(1) << (bit % 64)))) {
+            g_atomic_int_inc(&m_rejects);
+            return false;
+        }
+    }
+
+    return true;
+}
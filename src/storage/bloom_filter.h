@@ -0,0 +1,140 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <glib.h>
+
+namespace pinyin{
+
+/**
+ * BloomFilter:
+ *
+ * The Bloom filter of the keys in one DBM, to skip the DBM lookups
+ *   of the absent keys.
+ *
+ * Note: the filter is disabled until init is called, and is disabled
+ *   again when too many keys are added after init.
+ *   The disabled filter may contain all keys.
+ *
+ */
+class BloomFilter{
+private:
+    /* the bits of the filter, NULL when disabled. */
+    guint64 * m_bits;
+    /* the number of bits minus one, the number of bits is power of 2. */
+    guint32 m_mask;
+    guint32 m_capacity;
+    guint32 m_num_keys;
+
+    /* the number of rejected lookups, updated atomically. */
+    mutable gint m_rejects;
+
+    /* no copy. */
+    BloomFilter(const BloomFilter & other);
+    BloomFilter & operator=(const BloomFilter & other);
+
+    static guint64 hash(const void * key, size_t len);
+
+public:
+    /**
+     * BloomFilter::BloomFilter:
+     *
+     * The constructor of the BloomFilter.
+     *
+     */
+    BloomFilter();
+
+    /**
+     * BloomFilter::~BloomFilter:
+     *
+     * The destructor of the BloomFilter.
+     *
+     */
+    ~BloomFilter();
+
+    /**
+     * BloomFilter::init:
+     * @capacity: the expected number of keys.
+     * @returns: whether the init operation is successful.
+     *
+     * Enable the filter with no keys.
+     *
+     */
+    bool init(guint32 capacity);
+
+    /**
+     * BloomFilter::disable:
+     *
+     * Disable the filter, the reject counter is kept.
+     *
+     */
+    void disable();
+
+    /**
+     * BloomFilter::is_enabled:
+     * @returns: whether the filter is enabled.
+     *
+     * Check whether the filter is enabled.
+     *
+     */
+    bool is_enabled() const {
+        return NULL != m_bits;
+    }
+
+    /**
+     * BloomFilter::add:
+     * @key: the key.
+     * @len: the length of the key in bytes.
+     * @returns: whether the add operation is successful.
+     *
+     * Add the key into the enabled filter.
+     *
+     */
+    bool add(const void * key, size_t len);
+
+    /**
+     * BloomFilter::may_contain:
+     * @key: the key.
+     * @len: the length of the key in bytes.
+     * @returns: false when the key is surely absent.
+     *
+     * Check the key before the DBM lookup, the rejected lookups
+     *   are counted.
+     *
+     */
+    bool may_contain(const void * key, size_t len) const;
+
+    /**
+     * BloomFilter::get_rejects:
+     * @returns: the number of rejected lookups.
+     *
+     * Get the number of the DBM lookups saved by this filter.
+     *
+     */
+    guint32 get_rejects() const {
+        return g_atomic_int_get(&m_rejects);
+    }
+};
+
+};
+
+#endif
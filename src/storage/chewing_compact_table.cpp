@@ -0,0 +1,579 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chewing_compact_table.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chewing_large_table2.h"
+#include "chewing_table_text.h"
+
+namespace pinyin{
+
+static const size_t section_header_size =
+    (MAX_PHRASE_LENGTH + 1) * sizeof(guint32);
+
+static inline size_t align_to_4(size_t offset) {
+    return (offset + 3) & ~((size_t) 3);
+}
+
+/* the chewing index, the pinyin keys and the token. */
+static inline size_t record_size(int phrase_length) {
+    return 2 * phrase_length * sizeof(ChewingKey) + sizeof(phrase_token_t);
+}
+
+void ChewingCompactTable::reset() {
+    /* release the mapping. */
+    m_chunk.set_chunk(NULL, 0, NULL);
+}
+
+bool ChewingCompactTable::attach(const char * filename) {
+    reset();
+
+#ifdef LIBPINYIN_USE_MMAP
+    if (!m_chunk.mmap(filename))
+        return false;
+#else
+    if (!m_chunk.load(filename))
+        return false;
+#endif
+
+    const size_t size = m_chunk.size();
+    if (size < section_header_size) {
+        reset();
+        return false;
+    }
+
+    /* validate the sections. */
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        const guint32 offset =
+            m_chunk.get_content<guint32>(len * sizeof(guint32));
+        if (0 == offset)
+            continue;
+
+        if (offset < section_header_size ||
+            offset + sizeof(guint32) > size) {
+            reset();
+            return false;
+        }
+
+        const guint32 num = m_chunk.get_content<guint32>(offset);
+        const size_t offsets_begin = align_to_4
+            (offset + sizeof(guint32) + num * len * sizeof(ChewingKey));
+        const size_t offsets_end = offsets_begin +
+            (num + 1) * sizeof(guint32);
+        if (offsets_end > size) {
+            reset();
+            return false;
+        }
+
+        const guint32 * offsets = (const guint32 *)
+            ((const char *) m_chunk.begin() + offsets_begin);
+        if (offsets[0] < offsets_end || offsets[num] > size) {
+            reset();
+            return false;
+        }
+
+        for (size_t i = 0; i < num; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                reset();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ChewingCompactTable::get_section(int phrase_length, guint32 & num,
+                                      const ChewingKey * & indexes,
+                                      const guint32 * & offsets) const {
+    if (m_chunk.size() < section_header_size)
+        return false;
+
+    const guint32 offset =
+        m_chunk.get_content<guint32>(phrase_length * sizeof(guint32));
+    if (0 == offset)
+        return false;
+
+    const char * begin = (const char *) m_chunk.begin();
+    num = m_chunk.get_content<guint32>(offset);
+    indexes = (const ChewingKey *) (begin + offset + sizeof(guint32));
+    offsets = (const guint32 *) (begin + align_to_4
+        (offset + sizeof(guint32) + num * phrase_length * sizeof(ChewingKey)));
+    return true;
+}
+
+guint32 ChewingCompactTable::lower_bound(int phrase_length, guint32 num,
+                                         const ChewingKey * indexes,
+                                         int prefix_len,
+                                         const ChewingKey index[]) const {
+    const size_t size = prefix_len * sizeof(ChewingKey);
+    guint32 begin = 0, end = num;
+
+    /* binary search. */
+    while (begin < end) {
+        guint32 middle = begin + (end - begin) / 2;
+        if (memcmp(indexes + middle * phrase_length, index, size) < 0)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    return begin;
+}
+
+template<int phrase_length>
+int ChewingCompactTable::search_internal(pinyin_option_t options,
+                                         /* in */ const MemoryChunk & chunk,
+                                         /* in */ const ChewingKey keys[],
+                                         /* out */ PhraseIndexRanges ranges) const {
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
+
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
+
+    if (options & PINYIN_AMB_ALL)
+        return entry.search_fuzzy(options, keys, ranges);
+
+    return entry.search(keys, ranges);
+}
+
+int ChewingCompactTable::search_internal(pinyin_option_t options,
+                                         int phrase_length,
+                                         /* in */ const MemoryChunk & chunk,
+                                         /* in */ const ChewingKey keys[],
+                                         /* out */ PhraseIndexRanges ranges) const {
+#define CASE(len) case len:                                         \
+    {                                                               \
+        return search_internal<len>(options, chunk, keys, ranges);  \
+    }
+
+    switch(phrase_length) {
+        CASE(1);
+        CASE(2);
+        CASE(3);
+        CASE(4);
+        CASE(5);
+        CASE(6);
+        CASE(7);
+        CASE(8);
+        CASE(9);
+        CASE(10);
+        CASE(11);
+        CASE(12);
+        CASE(13);
+        CASE(14);
+        CASE(15);
+        CASE(16);
+    default:
+        abort();
+    }
+
+#undef CASE
+
+    return SEARCH_NONE;
+}
+
+template<int phrase_length>
+int ChewingCompactTable::search_suggestion_internal
+(/* in */ const MemoryChunk & chunk,
+ int prefix_len,
+ /* in */ const ChewingKey prefix_keys[],
+ /* out */ PhraseTokens tokens) const {
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
+
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
+
+    return entry.search_suggestion(prefix_len, prefix_keys, tokens);
+}
+
+int ChewingCompactTable::search_suggestion_internal
+(int phrase_length,
+ /* in */ const MemoryChunk & chunk,
+ int prefix_len,
+ /* in */ const ChewingKey prefix_keys[],
+ /* out */ PhraseTokens tokens) const {
+
+#define CASE(len) case len:                             \
+    {                                                   \
+        return search_suggestion_internal<len>          \
+            (chunk, prefix_len, prefix_keys, tokens);   \
+    }
+
+    switch(phrase_length) {
+        CASE(1);
+        CASE(2);
+        CASE(3);
+        CASE(4);
+        CASE(5);
+        CASE(6);
+        CASE(7);
+        CASE(8);
+        CASE(9);
+        CASE(10);
+        CASE(11);
+        CASE(12);
+        CASE(13);
+        CASE(14);
+        CASE(15);
+        CASE(16);
+    default:
+        abort();
+    }
+
+#undef CASE
+
+    return SEARCH_NONE;
+}
+
+int ChewingCompactTable::search_internal(pinyin_option_t options,
+                                         int phrase_length,
+                                         /* in */ const ChewingKey index[],
+                                         /* in */ const ChewingKey keys[],
+                                         /* out */ PhraseIndexRanges ranges) const {
+    guint32 num = 0;
+    const ChewingKey * indexes = NULL;
+    const guint32 * offsets = NULL;
+    if (!get_section(phrase_length, num, indexes, offsets))
+        return SEARCH_NONE;
+
+    guint32 pos = lower_bound(phrase_length, num, indexes,
+                              phrase_length, index);
+    if (pos == num || 0 != memcmp(indexes + pos * phrase_length, index,
+                                  phrase_length * sizeof(ChewingKey)))
+        return SEARCH_NONE;
+
+    /* continue searching. */
+    int result = SEARCH_CONTINUED;
+    if (offsets[pos] == offsets[pos + 1])
+        return result;
+
+    MemoryChunk chunk;
+    chunk.set_chunk((char *) m_chunk.begin() + offsets[pos],
+                    offsets[pos + 1] - offsets[pos], NULL);
+    result = search_internal(options, phrase_length, chunk, keys, ranges) |
+        result;
+    return result;
+}
+
+/* search method */
+int ChewingCompactTable::search(int phrase_length,
+                                /* in */ const ChewingKey keys[],
+                                /* out */ PhraseIndexRanges ranges) const {
+    ChewingKey index[MAX_PHRASE_LENGTH];
+
+    if (contains_incomplete_pinyin(keys, phrase_length))
+        compute_incomplete_chewing_index(keys, index, phrase_length);
+    else
+        compute_chewing_index(keys, index, phrase_length);
+
+    return search_internal(0, phrase_length, index, keys, ranges);
+}
+
+/* search_fuzzy method */
+int ChewingCompactTable::search_fuzzy(pinyin_option_t options,
+                                      int phrase_length,
+                                      /* in */ const ChewingKey keys[],
+                                      /* out */ PhraseIndexRanges ranges) const {
+    ChewingKey index[MAX_PHRASE_LENGTH];
+
+    /* the fuzzy pinyin keys are verified with the options. */
+    options &= PINYIN_AMB_ALL;
+    if (!options)
+        return search(phrase_length, keys, ranges);
+
+    if (contains_incomplete_pinyin(keys, phrase_length))
+        compute_incomplete_fuzzy_chewing_index(keys, index, phrase_length);
+    else
+        compute_fuzzy_chewing_index(keys, index, phrase_length);
+
+    return search_internal(options, phrase_length, index, keys, ranges);
+}
+
+/* search_suggesion method */
+int ChewingCompactTable::search_suggestion
+(int prefix_len,
+ /* in */ const ChewingKey prefix_keys[],
+ /* out */ PhraseTokens tokens) const {
+    ChewingKey index[MAX_PHRASE_LENGTH];
+    int result = SEARCH_NONE;
+
+    if (contains_incomplete_pinyin(prefix_keys, prefix_len))
+        compute_incomplete_chewing_index(prefix_keys, index, prefix_len);
+    else
+        compute_chewing_index(prefix_keys, index, prefix_len);
+
+    const size_t size = prefix_len * sizeof(ChewingKey);
+
+    /* visit the longer chewing indexes with the same prefix. */
+    for (int len = prefix_len + 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        guint32 num = 0;
+        const ChewingKey * indexes = NULL;
+        const guint32 * offsets = NULL;
+        if (!get_section(len, num, indexes, offsets))
+            continue;
+
+        guint32 pos = lower_bound(len, num, indexes, prefix_len, index);
+        for (; pos < num; ++pos) {
+            if (0 != memcmp(indexes + pos * len, index, size))
+                break;
+
+            if (offsets[pos] == offsets[pos + 1])
+                continue;
+
+            MemoryChunk chunk;
+            chunk.set_chunk((char *) m_chunk.begin() + offsets[pos],
+                            offsets[pos + 1] - offsets[pos], NULL);
+            result = search_suggestion_internal
+                (len, chunk, prefix_len, prefix_keys, tokens) | result;
+        }
+    }
+
+    return result;
+}
+
+static gint compare_record(gconstpointer lhs, gconstpointer rhs,
+                           gpointer user_data) {
+    const int phrase_length = GPOINTER_TO_INT(user_data);
+
+    /* compare the chewing index. */
+    int result = memcmp(lhs, rhs, phrase_length * sizeof(ChewingKey));
+    if (0 != result)
+        return result;
+
+    /* compare the token. */
+    const size_t offset = 2 * phrase_length * sizeof(ChewingKey);
+    phrase_token_t token_lhs = null_token, token_rhs = null_token;
+    memcpy(&token_lhs, (const char *) lhs + offset, sizeof(phrase_token_t));
+    memcpy(&token_rhs, (const char *) rhs + offset, sizeof(phrase_token_t));
+    if (token_lhs < token_rhs)
+        return -1;
+    if (token_lhs > token_rhs)
+        return 1;
+    return 0;
+}
+
+ChewingCompactTableBuilder::ChewingCompactTableBuilder() {
+    m_records = g_ptr_array_new();
+    /* NULL for the first pointer. */
+    g_ptr_array_set_size(m_records, MAX_PHRASE_LENGTH + 1);
+
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+        g_ptr_array_index(m_records, len) =
+            g_array_new(FALSE, FALSE, record_size(len));
+}
+
+ChewingCompactTableBuilder::~ChewingCompactTableBuilder() {
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+        g_array_free((GArray *) g_ptr_array_index(m_records, len), TRUE);
+
+    g_ptr_array_free(m_records, TRUE);
+    m_records = NULL;
+}
+
+bool ChewingCompactTableBuilder::load_text(FILE * infile,
+                                           TABLE_PHONETIC_TYPE type) {
+    return load_chewing_table_text(this, infile, type);
+}
+
+bool ChewingCompactTableBuilder::add_record(int phrase_length,
+                                            /* in */ const ChewingKey index[],
+                                            /* in */ const ChewingKey keys[],
+                                            /* in */ phrase_token_t token) {
+    GArray * records = (GArray *) g_ptr_array_index(m_records, phrase_length);
+    const size_t size = phrase_length * sizeof(ChewingKey);
+
+    g_array_set_size(records, records->len + 1);
+    char * record = records->data +
+        (records->len - 1) * record_size(phrase_length);
+
+    memcpy(record, index, size);
+    if (NULL == keys)
+        memset(record + size, 0, size);
+    else
+        memcpy(record + size, keys, size);
+    memcpy(record + 2 * size, &token, sizeof(phrase_token_t));
+    return true;
+}
+
+/* add index method */
+int ChewingCompactTableBuilder::add_index(int phrase_length,
+                                          /* in */ const ChewingKey keys[],
+                                          /* in */ phrase_token_t token) {
+    ChewingKey index[MAX_PHRASE_LENGTH];
+    assert(0 < phrase_length && phrase_length <= MAX_PHRASE_LENGTH);
+
+    /* for in-complete chewing index */
+    compute_incomplete_chewing_index(keys, index, phrase_length);
+    add_record(phrase_length, index, keys, token);
+    /* add the prefixes for continued information. */
+    for (int len = phrase_length - 1; len > 0; --len)
+        add_record(len, index, NULL, null_token);
+
+    /* for in-complete fuzzy chewing index */
+    compute_incomplete_fuzzy_chewing_index(keys, index, phrase_length);
+    add_record(phrase_length, index, keys, token);
+    for (int len = phrase_length - 1; len > 0; --len)
+        add_record(len, index, NULL, null_token);
+
+    /* for fuzzy chewing index */
+    compute_fuzzy_chewing_index(keys, index, phrase_length);
+    add_record(phrase_length, index, keys, token);
+    for (int len = phrase_length - 1; len > 0; --len)
+        add_record(len, index, NULL, null_token);
+
+    /* for chewing index */
+    compute_chewing_index(keys, index, phrase_length);
+    add_record(phrase_length, index, keys, token);
+    for (int len = phrase_length - 1; len > 0; --len)
+        add_record(len, index, NULL, null_token);
+
+    return ERROR_OK;
+}
+
+template<int phrase_length>
+bool ChewingCompactTableBuilder::append_value
+(GArray * records, size_t begin, size_t end,
+ /* out */ MemoryChunk & values) const {
+    const size_t size = phrase_length * sizeof(ChewingKey);
+    ChewingTableEntry<phrase_length> entry;
+
+    for (size_t i = begin; i < end; ++i) {
+        const char * record = records->data + i * record_size(phrase_length);
+
+        phrase_token_t token = null_token;
+        memcpy(&token, record + 2 * size, sizeof(phrase_token_t));
+        /* skip the prefixes. */
+        if (null_token == token)
+            continue;
+
+        ChewingKey keys[phrase_length];
+        memcpy(keys, record + size, size);
+        /* the duplicated tokens are merged here. */
+        entry.add_index(keys, token);
+    }
+
+    return values.append_content(entry.m_chunk.begin(),
+                                 entry.m_chunk.size());
+}
+
+bool ChewingCompactTableBuilder::append_value
+(int phrase_length, GArray * records, size_t begin, size_t end,
+ /* out */ MemoryChunk & values) const {
+#define CASE(len) case len:                                         \
+    {                                                               \
+        return append_value<len>(records, begin, end, values);      \
+    }
+
+    switch(phrase_length) {
+        CASE(1);
+        CASE(2);
+        CASE(3);
+        CASE(4);
+        CASE(5);
+        CASE(6);
+        CASE(7);
+        CASE(8);
+        CASE(9);
+        CASE(10);
+        CASE(11);
+        CASE(12);
+        CASE(13);
+        CASE(14);
+        CASE(15);
+        CASE(16);
+    default:
+        abort();
+    }
+
+#undef CASE
+
+    return false;
+}
+
+bool ChewingCompactTableBuilder::save(const char * filename) {
+    MemoryChunk chunk;
+    guint32 section_offsets[MAX_PHRASE_LENGTH + 1];
+    memset(section_offsets, 0, sizeof(section_offsets));
+    chunk.set_size(section_header_size);
+
+    const guint32 padding = 0;
+
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len) {
+        GArray * records = (GArray *) g_ptr_array_index(m_records, len);
+        if (0 == records->len)
+            continue;
+
+        g_array_sort_with_data(records, compare_record, GINT_TO_POINTER(len));
+
+        const size_t size = len * sizeof(ChewingKey);
+        const size_t item_size = record_size(len);
+
+        MemoryChunk indexes, values;
+        GArray * offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+        /* group the records by the chewing index. */
+        size_t begin = 0;
+        while (begin < records->len) {
+            const char * index = records->data + begin * item_size;
+
+            size_t end = begin + 1;
+            while (end < records->len &&
+                   0 == memcmp(index, records->data + end * item_size, size))
+                ++end;
+
+            indexes.append_content(index, size);
+            guint32 offset = values.size();
+            g_array_append_val(offsets, offset);
+            append_value(len, records, begin, end, values);
+
+            begin = end;
+        }
+
+        guint32 offset = values.size();
+        g_array_append_val(offsets, offset);
+
+        /* write the section. */
+        const guint32 num = offsets->len - 1;
+        section_offsets[len] = chunk.size();
+        chunk.append_content(&num, sizeof(guint32));
+        chunk.append_content(indexes.begin(), indexes.size());
+        chunk.append_content(&padding,
+                             align_to_4(chunk.size()) - chunk.size());
+
+        /* the values follow the value offsets. */
+        const guint32 values_begin = chunk.size() +
+            offsets->len * sizeof(guint32);
+        for (size_t i = 0; i < offsets->len; ++i) {
+            offset = g_array_index(offsets, guint32, i) + values_begin;
+            chunk.append_content(&offset, sizeof(guint32));
+        }
+        chunk.append_content(values.begin(), values.size());
+
+        g_array_free(offsets, TRUE);
+    }
+
+    chunk.set_content(0, section_offsets, sizeof(section_offsets));
+    return chunk.save(filename);
+}
+
+};
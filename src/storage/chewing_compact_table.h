@@ -0,0 +1,257 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEWING_COMPACT_TABLE_H
+#define CHEWING_COMPACT_TABLE_H
+
+#include <stdio.h>
+#include "novel_types.h"
+#include "memory_chunk.h"
+#include "chewing_key.h"
+#include "table_info.h"
+
+namespace pinyin{
+
+/** Note:
+ *  The file layout of the compact chewing table:
+ *    guint32 the section offsets, indexed by the phrase length;
+ *    for each phrase length, one section:
+ *      guint32 the number of chewing indexes;
+ *      the sorted chewing indexes, padded to 4 bytes;
+ *      guint32 the value offsets, one more than the chewing indexes;
+ *    the values, each is the sorted array of PinyinIndexItem2,
+ *      same as the value of ChewingLargeTable2.
+ *
+ *  The chewing indexes without value are the prefixes of
+ *    the longer chewing indexes, same as ChewingLargeTable2.
+ *
+ *  The fuzzy chewing indexes are stored in the same sections,
+ *    marked by the zero padding bit of ChewingKey.
+ */
+
+/**
+ * ChewingCompactTable:
+ *
+ * The read-only chewing table, which is memory mapped from one file.
+ *
+ */
+class ChewingCompactTable{
+private:
+    MemoryChunk m_chunk;
+
+    void reset();
+
+    /* the section of the phrase length. */
+    bool get_section(int phrase_length, guint32 & num,
+                     const ChewingKey * & indexes,
+                     const guint32 * & offsets) const;
+
+    /* returns the first chewing index not less than the index,
+       only compare the first prefix_len keys. */
+    guint32 lower_bound(int phrase_length, guint32 num,
+                        const ChewingKey * indexes,
+                        int prefix_len, const ChewingKey index[]) const;
+
+    template<int phrase_length>
+    int search_internal(pinyin_option_t options,
+                        /* in */ const MemoryChunk & chunk,
+                        /* in */ const ChewingKey keys[],
+                        /* out */ PhraseIndexRanges ranges) const;
+
+    int search_internal(pinyin_option_t options, int phrase_length,
+                        /* in */ const MemoryChunk & chunk,
+                        /* in */ const ChewingKey keys[],
+                        /* out */ PhraseIndexRanges ranges) const;
+
+    int search_internal(pinyin_option_t options, int phrase_length,
+                        /* in */ const ChewingKey index[],
+                        /* in */ const ChewingKey keys[],
+                        /* out */ PhraseIndexRanges ranges) const;
+
+    template<int phrase_length>
+    int search_suggestion_internal(/* in */ const MemoryChunk & chunk,
+                                   int prefix_len,
+                                   /* in */ const ChewingKey prefix_keys[],
+                                   /* out */ PhraseTokens tokens) const;
+
+    int search_suggestion_internal(int phrase_length,
+                                   /* in */ const MemoryChunk & chunk,
+                                   int prefix_len,
+                                   /* in */ const ChewingKey prefix_keys[],
+                                   /* out */ PhraseTokens tokens) const;
+
+public:
+    /**
+     * ChewingCompactTable::ChewingCompactTable:
+     *
+     * The constructor of the ChewingCompactTable.
+     *
+     */
+    ChewingCompactTable() {}
+
+    /**
+     * ChewingCompactTable::~ChewingCompactTable:
+     *
+     * The destructor of the ChewingCompactTable.
+     *
+     */
+    ~ChewingCompactTable() {
+        reset();
+    }
+
+    /**
+     * ChewingCompactTable::attach:
+     * @filename: the compact chewing table file.
+     * @returns: whether the attach operation is successful.
+     *
+     * Map the compact chewing table file.
+     *
+     */
+    bool attach(const char * filename);
+
+    /**
+     * ChewingCompactTable::search:
+     * @phrase_length: the length of the phrase to be searched.
+     * @keys: the pinyin key of the phrase to be searched.
+     * @ranges: the array of GArrays to store the matched phrase token.
+     * @returns: the search result of enum SearchResult.
+     *
+     * Search the phrase tokens according to the pinyin keys.
+     *
+     */
+    int search(int phrase_length, /* in */ const ChewingKey keys[],
+               /* out */ PhraseIndexRanges ranges) const;
+
+    /**
+     * ChewingCompactTable::search_fuzzy:
+     * @options: the fuzzy pinyin options.
+     * @phrase_length: the length of the phrase to be searched.
+     * @keys: the pinyin key of the phrase to be searched.
+     * @ranges: the array of GArrays to store the matched phrase token.
+     * @returns: the search result of enum SearchResult.
+     *
+     * Search the phrase tokens of all the fuzzy pinyin keys in one lookup,
+     * same as ChewingLargeTable2::search_fuzzy.
+     *
+     */
+    int search_fuzzy(pinyin_option_t options, int phrase_length,
+                     /* in */ const ChewingKey keys[],
+                     /* out */ PhraseIndexRanges ranges) const;
+
+    /**
+     * ChewingCompactTable::search_suggestion:
+     * @prefix_len: the length of the prefix to be searched.
+     * @prefix_keys: the pinyin key of the prefix to be searched.
+     * @tokens: the array of GArrays to store the matched prefix token.
+     * @returns: the search result of enum SearchResult.
+     *
+     * Search the phrase tokens according to the prefix pinyin keys.
+     *
+     */
+    int search_suggestion(int prefix_len,
+                          /* in */ const ChewingKey prefix_keys[],
+                          /* out */ PhraseTokens tokens) const;
+};
+
+/**
+ * ChewingCompactTableBuilder:
+ *
+ * Build the compact chewing table file.
+ *
+ */
+class ChewingCompactTableBuilder{
+private:
+    /* Array of GArray, indexed by the phrase length,
+       each item is the chewing index, the pinyin keys and the token. */
+    GPtrArray * m_records;
+
+    /* no copy. */
+    ChewingCompactTableBuilder(const ChewingCompactTableBuilder & other);
+    ChewingCompactTableBuilder & operator=
+    (const ChewingCompactTableBuilder & other);
+
+    bool add_record(int phrase_length, /* in */ const ChewingKey index[],
+                    /* in */ const ChewingKey keys[],
+                    /* in */ phrase_token_t token);
+
+    /* merge the records with the same chewing index into one value. */
+    template<int phrase_length>
+    bool append_value(GArray * records, size_t begin, size_t end,
+                      /* out */ MemoryChunk & values) const;
+
+    bool append_value(int phrase_length, GArray * records,
+                      size_t begin, size_t end,
+                      /* out */ MemoryChunk & values) const;
+
+public:
+    /**
+     * ChewingCompactTableBuilder::ChewingCompactTableBuilder:
+     *
+     * The constructor of the ChewingCompactTableBuilder.
+     *
+     */
+    ChewingCompactTableBuilder();
+
+    /**
+     * ChewingCompactTableBuilder::~ChewingCompactTableBuilder:
+     *
+     * The destructor of the ChewingCompactTableBuilder.
+     *
+     */
+    ~ChewingCompactTableBuilder();
+
+    /**
+     * ChewingCompactTableBuilder::load_text:
+     * @infile: the table text file.
+     * @type: the phonetic type of the table.
+     * @returns: whether the load operation is successful.
+     *
+     * Load the pinyin or zhuyin table text.
+     *
+     */
+    bool load_text(FILE * infile, TABLE_PHONETIC_TYPE type);
+
+    /**
+     * ChewingCompactTableBuilder::add_index:
+     * @phrase_length: the length of the phrase to be added.
+     * @keys: the pinyin keys of the phrase to be added.
+     * @token: the token of the phrase to be added.
+     * @returns: the add result of enum ErrorResult.
+     *
+     * Add the phrase token, same as ChewingLargeTable2::add_index.
+     *
+     */
+    int add_index(int phrase_length, /* in */ const ChewingKey keys[],
+                  /* in */ phrase_token_t token);
+
+    /**
+     * ChewingCompactTableBuilder::save:
+     * @filename: the compact chewing table file.
+     * @returns: whether the save operation is successful.
+     *
+     * Save the compact chewing table file.
+     *
+     */
+    bool save(const char * filename);
+};
+
+};
+
+#endif
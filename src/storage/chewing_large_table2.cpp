@@ -19,8 +19,7 @@
  */
 
 #include "chewing_large_table2.h"
-#include "pinyin_parser2.h"
-#include "zhuyin_parser2.h"
+#include "chewing_table_text.h"
 
 void ChewingLargeTable2::init_entries() {
     assert(NULL == m_entries);
@@ -107,65 +106,56 @@ void ChewingLargeTable2::fini_entries() {
     m_entries = NULL;
 }
 
-/* load text method */
-bool ChewingLargeTable2::load_text(FILE * infile, TABLE_PHONETIC_TYPE type) {
-    char pinyin[256];
-    char phrase[256];
-    phrase_token_t token;
-    size_t freq;
-
-    while (!feof(infile)) {
-#ifdef __APPLE__
-        int num = fscanf(infile, "%255s %255[^ \t] %u %ld",
-                         pinyin, phrase, &token, &freq);
-#else
-        int num = fscanf(infile, "%255s %255s %u %ld",
-                         pinyin, phrase, &token, &freq);
-#endif
-
-        if (4 != num)
-            continue;
-
-        if(feof(infile))
-            break;
+void ChewingLargeTable2::fini_filters() {
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+        m_filters[len].disable();
 
-        glong len = g_utf8_strlen(phrase, -1);
-
-        ChewingKeyVector keys;
-        ChewingKeyRestVector key_rests;
+    /* re-build the filters on the next search. */
+    g_atomic_int_set(&m_filters_ready, FALSE);
+}
 
-        keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
-        key_rests = g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+/* the concurrent readers wait for the first one to build the filters. */
+void ChewingLargeTable2::ensure_filters() const {
+    if (g_atomic_int_get(&m_filters_ready))
+        return;
 
-        switch (type) {
-        case PINYIN_TABLE: {
-            PinyinDirectParser2 parser;
-            pinyin_option_t options = USE_TONE;
-            parser.parse(options, keys, key_rests, pinyin, strlen(pinyin));
-            break;
-        }
+    g_mutex_lock(&m_filters_lock);
+    if (!g_atomic_int_get(&m_filters_ready)) {
+        /* the filters only cache the chewing indexes in the DBM. */
+        const_cast<ChewingLargeTable2 *>(this)->init_filters();
+        g_atomic_int_set(&m_filters_ready, TRUE);
+    }
+    g_mutex_unlock(&m_filters_lock);
+}
 
-        case ZHUYIN_TABLE: {
-            ZhuyinDirectParser2 parser;
-            pinyin_option_t options = USE_TONE | FORCE_TONE;
-            parser.parse(options, keys, key_rests, pinyin, strlen(pinyin));
-            break;
-        }
-        };
+/* add the chewing index with the prefixes for continued information. */
+void ChewingLargeTable2::add_filters(int phrase_length,
+                                     /* in */ const ChewingKey index[]) {
+    bool saturated = false;
 
-        if (len != keys->len) {
-            fprintf(stderr, "ChewingLargeTable2::load_text:%s\t%s\t%u\t%ld\n",
-                    pinyin, phrase, token, freq);
+    for (int len = phrase_length; len > 0; --len) {
+        if (!m_filters[len].is_enabled())
             continue;
-        }
-
-        add_index(keys->len, (ChewingKey *)keys->data, token);
 
-        g_array_free(keys, TRUE);
-        g_array_free(key_rests, TRUE);
+        m_filters[len].add(index, len * sizeof(ChewingKey));
+        saturated = saturated || !m_filters[len].is_enabled();
     }
 
-    return true;
+    /* re-build the saturated filters with the keys of the next search. */
+    if (saturated)
+        fini_filters();
+}
+
+guint32 ChewingLargeTable2::get_filter_rejects() const {
+    guint32 rejects = 0;
+    for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+        rejects += m_filters[len].get_rejects();
+    return rejects;
+}
+
+/* load text method */
+bool ChewingLargeTable2::load_text(FILE * infile, TABLE_PHONETIC_TYPE type) {
+    return load_chewing_table_text(this, infile, type);
 }
 
 /* search method */
@@ -175,15 +165,44 @@ int ChewingLargeTable2::search(int phrase_length,
     ChewingKey index[MAX_PHRASE_LENGTH];
     assert(NULL != m_db);
 
-    if (contains_incomplete_pinyin(keys, phrase_length)) {
+    if (contains_incomplete_pinyin(keys, phrase_length))
         compute_incomplete_chewing_index(keys, index, phrase_length);
-        return search_internal(phrase_length, index, keys, ranges);
-    } else {
+    else
         compute_chewing_index(keys, index, phrase_length);
-        return search_internal(phrase_length, index, keys, ranges);
-    }
 
-    return SEARCH_NONE;
+    /* skip the DBM lookup of the absent chewing index. */
+    ensure_filters();
+    if (!m_filters[phrase_length].may_contain
+        (index, phrase_length * sizeof(ChewingKey)))
+        return SEARCH_NONE;
+
+    return search_internal(0, phrase_length, index, keys, ranges);
+}
+
+int ChewingLargeTable2::search_fuzzy(pinyin_option_t options,
+                                     int phrase_length,
+                                     /* in */ const ChewingKey keys[],
+                                     /* out */ PhraseIndexRanges ranges) const {
+    ChewingKey index[MAX_PHRASE_LENGTH];
+    assert(NULL != m_db);
+
+    /* the fuzzy pinyin keys are verified with the options. */
+    options &= PINYIN_AMB_ALL;
+    if (!options)
+        return search(phrase_length, keys, ranges);
+
+    if (contains_incomplete_pinyin(keys, phrase_length))
+        compute_incomplete_fuzzy_chewing_index(keys, index, phrase_length);
+    else
+        compute_fuzzy_chewing_index(keys, index, phrase_length);
+
+    /* skip the DBM lookup of the absent chewing index. */
+    ensure_filters();
+    if (!m_filters[phrase_length].may_contain
+        (index, phrase_length * sizeof(ChewingKey)))
+        return SEARCH_NONE;
+
+    return search_internal(options, phrase_length, index, keys, ranges);
 }
 
 /* add/remove index method */
@@ -197,6 +216,23 @@ int ChewingLargeTable2::add_index(int phrase_length,
     /* for in-complete chewing index */
     compute_incomplete_chewing_index(keys, index, phrase_length);
     result = add_index_internal(phrase_length, index, keys, token);
+    add_filters(phrase_length, index);
+    assert(ERROR_OK == result || ERROR_INSERT_ITEM_EXISTS == result);
+    if (ERROR_OK != result)
+        return result;
+
+    /* for in-complete fuzzy chewing index */
+    compute_incomplete_fuzzy_chewing_index(keys, index, phrase_length);
+    result = add_index_internal(phrase_length, index, keys, token);
+    add_filters(phrase_length, index);
+    assert(ERROR_OK == result || ERROR_INSERT_ITEM_EXISTS == result);
+    if (ERROR_OK != result)
+        return result;
+
+    /* for fuzzy chewing index */
+    compute_fuzzy_chewing_index(keys, index, phrase_length);
+    result = add_index_internal(phrase_length, index, keys, token);
+    add_filters(phrase_length, index);
     assert(ERROR_OK == result || ERROR_INSERT_ITEM_EXISTS == result);
     if (ERROR_OK != result)
         return result;
@@ -204,6 +240,7 @@ int ChewingLargeTable2::add_index(int phrase_length,
     /* for chewing index */
     compute_chewing_index(keys, index, phrase_length);
     result = add_index_internal(phrase_length, index, keys, token);
+    add_filters(phrase_length, index);
     assert(ERROR_OK == result || ERROR_INSERT_ITEM_EXISTS == result);
     return result;
 }
@@ -222,6 +259,20 @@ int ChewingLargeTable2::remove_index(int phrase_length,
     if (ERROR_OK != result)
         return result;
 
+    /* for in-complete fuzzy chewing index */
+    compute_incomplete_fuzzy_chewing_index(keys, index, phrase_length);
+    result = remove_index_internal(phrase_length, index, keys, token);
+    assert(ERROR_OK == result || ERROR_REMOVE_ITEM_DONOT_EXISTS == result);
+    if (ERROR_OK != result)
+        return result;
+
+    /* for fuzzy chewing index */
+    compute_fuzzy_chewing_index(keys, index, phrase_length);
+    result = remove_index_internal(phrase_length, index, keys, token);
+    assert(ERROR_OK == result || ERROR_REMOVE_ITEM_DONOT_EXISTS == result);
+    if (ERROR_OK != result)
+        return result;
+
     /* for chewing index */
     compute_chewing_index(keys, index, phrase_length);
     result = remove_index_internal(phrase_length, index, keys, token);
@@ -42,6 +42,8 @@ namespace pinyin{
 
 class MaskOutVisitor2;
 class MaskOutProcessor2;
+class ChewingCompactTable;
+class ChewingCompactTableBuilder;
 
 template<int phrase_length>
 class PrefixLessThanWithTones{
@@ -75,6 +77,8 @@ class ChewingTableEntry{
     friend class ChewingLargeTable2;
     friend class MaskOutVisitor2;
     friend class MaskOutProcessor2;
+    friend class ChewingCompactTable;
+    friend class ChewingCompactTableBuilder;
 protected:
     typedef PinyinIndexItem2<phrase_length> IndexItem;
 
@@ -88,7 +92,7 @@ private:
 public:
     /* convert method. */
     /* compress consecutive tokens */
-    int convert(const ChewingKey keys[],
+    int convert(pinyin_option_t options, const ChewingKey keys[],
                 const IndexItem * begin, const IndexItem * end,
                 PhraseIndexRanges ranges) const {
         const IndexItem * iter = NULL;
@@ -99,8 +103,13 @@ public:
         /* TODO: check the below code */
         cursor.m_range_begin = null_token; cursor.m_range_end = null_token;
         for (iter = begin; iter != end; ++iter) {
-            if (0 != pinyin_compare_with_tones
-                (keys, iter->m_keys, phrase_length))
+            if (options & PINYIN_AMB_ALL) {
+                /* verify the exact keys from the fuzzy chewing index. */
+                if (!pinyin_fuzzy_equal_with_tones
+                    (options, keys, iter->m_keys, phrase_length))
+                    continue;
+            } else if (0 != pinyin_compare_with_tones
+                       (keys, iter->m_keys, phrase_length))
                 continue;
 
             phrase_token_t token = iter->m_token;
@@ -149,7 +158,18 @@ public:
             std_lite::equal_range(begin, end, item,
                                   phrase_less_than_with_tones<phrase_length>);
 
-        return convert(keys, range.first, range.second, ranges);
+        return convert(0, keys, range.first, range.second, ranges);
+    }
+
+    /* search_fuzzy method, the entry is loaded with the fuzzy chewing index,
+       which contains all the keys of the fuzzy classes. */
+    int search_fuzzy(pinyin_option_t options,
+                     /* in */ const ChewingKey keys[],
+                     /* out */ PhraseIndexRanges ranges) const {
+        const IndexItem * begin = (IndexItem *) m_chunk.begin();
+        const IndexItem * end = (IndexItem *) m_chunk.end();
+
+        return convert(options, keys, begin, end, ranges);
     }
 
     int convert_suggestion(int prefix_len,
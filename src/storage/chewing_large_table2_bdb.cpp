@@ -56,11 +56,14 @@ ChewingLargeTable2::ChewingLargeTable2() {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     assert(0 == ret);
 
     m_entries = NULL;
     init_entries();
+
+    m_filters_ready = FALSE;
+    g_mutex_init(&m_filters_lock);
 }
 
 void ChewingLargeTable2::reset() {
@@ -71,6 +74,56 @@ void ChewingLargeTable2::reset() {
     }
 
     fini_entries();
+    fini_filters();
+}
+
+/* filter methods */
+void ChewingLargeTable2::init_filters() {
+    fini_filters();
+
+    if (NULL == m_db)
+        return;
+
+    guint32 counts[MAX_PHRASE_LENGTH + 1] = {0};
+
+    /* the first pass counts the keys, the second pass adds the keys. */
+    for (int pass = 0; pass < 2; ++pass) {
+        DBC * cursorp = NULL;
+        DBT db_key, db_data;
+
+        /* Get a cursor */
+        m_db->cursor(m_db, NULL, &cursorp, 0);
+
+        if (NULL == cursorp) {
+            fini_filters();
+            return;
+        }
+
+        /* Initialize our DBTs, only the keys are retrieved. */
+        memset(&db_key, 0, sizeof(DBT));
+        memset(&db_data, 0, sizeof(DBT));
+        db_key.flags = DB_DBT_REALLOC;
+        db_data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
+
+        while (cursorp->c_get(cursorp, &db_key, &db_data, DB_NEXT) == 0) {
+            int phrase_length = db_key.size / sizeof(ChewingKey);
+            assert(0 < phrase_length && phrase_length <= MAX_PHRASE_LENGTH);
+
+            if (0 == pass)
+                ++counts[phrase_length];
+            else
+                m_filters[phrase_length].add(db_key.data, db_key.size);
+        }
+
+        /* Cursors must be closed */
+        cursorp->c_close(cursorp);
+        free(db_key.data);
+
+        if (0 == pass) {
+            for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+                m_filters[len].init(counts[len]);
+        }
+    }
 }
 
 /* attach method */
@@ -79,7 +132,7 @@ bool ChewingLargeTable2::attach(const char * dbfile, guint32 flags) {
 
     init_entries();
 
-    u_int32_t db_flags = attach_options(flags);
+    u_int32_t db_flags = attach_thread_options(flags);
 
     if (!dbfile)
         return false;
@@ -106,7 +159,7 @@ bool ChewingLargeTable2::load_db(const char * filename) {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     if (ret != 0)
         return false;
 
@@ -123,13 +176,12 @@ bool ChewingLargeTable2::load_db(const char * filename) {
     if (ret != 0)
         return false;
 
-    if (!copy_bdb(tmp_db, m_db))
-        return false;
+    bool retval = copy_bdb(tmp_db, m_db);
 
     if (tmp_db != NULL)
         tmp_db->close(tmp_db, 0);
 
-    return true;
+    return retval;
 }
 
 bool ChewingLargeTable2::save_db(const char * new_filename) {
@@ -162,44 +214,29 @@ bool ChewingLargeTable2::save_db(const char * new_filename) {
 }
 
 template<int phrase_length>
-int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        /* in */ const MemoryChunk & chunk,
                                         /* in */ const ChewingKey keys[],
                                         /* out */ PhraseIndexRanges ranges) const {
-    int result = SEARCH_NONE;
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
-
-    DBT db_key;
-    memset(&db_key, 0, sizeof(DBT));
-    db_key.data = (void *) index;
-    db_key.size = phrase_length * sizeof(ChewingKey);
-
-    DBT db_data;
-    memset(&db_data, 0, sizeof(DBT));
-    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
-    if (ret != 0)
-        return result;
-
-    /* continue searching. */
-    result |= SEARCH_CONTINUED;
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
 
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    if (options & PINYIN_AMB_ALL)
+        return entry.search_fuzzy(options, keys, ranges);
 
-    result = entry->search(keys, ranges) | result;
-
-    return result;
+    return entry.search(keys, ranges);
 }
 
-int ChewingLargeTable2::search_internal(int phrase_length,
-                                        /* in */ const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        /* in */ const MemoryChunk & chunk,
                                         /* in */ const ChewingKey keys[],
                                         /* out */ PhraseIndexRanges ranges) const {
-#define CASE(len) case len:                                     \
-    {                                                           \
-        return search_internal<len>(index, keys, ranges);       \
+#define CASE(len) case len:                                         \
+    {                                                               \
+        return search_internal<len>(options, chunk, keys, ranges);  \
     }
 
     switch(phrase_length) {
@@ -228,6 +265,71 @@ int ChewingLargeTable2::search_internal(int phrase_length,
     return SEARCH_NONE;
 }
 
+/* the per-thread buffer for the returned data of Berkeley DB,
+   only grows, to avoid the allocation per search. */
+static void free_search_chunk(gpointer data) {
+    delete (MemoryChunk *) data;
+}
+
+static GPrivate search_chunk_key = G_PRIVATE_INIT(free_search_chunk);
+
+static MemoryChunk * get_search_chunk() {
+    MemoryChunk * chunk = (MemoryChunk *) g_private_get(&search_chunk_key);
+    if (NULL == chunk) {
+        chunk = new MemoryChunk;
+        g_private_set(&search_chunk_key, chunk);
+    }
+    return chunk;
+}
+
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        /* in */ const ChewingKey index[],
+                                        /* in */ const ChewingKey keys[],
+                                        /* out */ PhraseIndexRanges ranges) const {
+    int result = SEARCH_NONE;
+
+    DBT db_key;
+    memset(&db_key, 0, sizeof(DBT));
+    db_key.data = (void *) index;
+    db_key.size = phrase_length * sizeof(ChewingKey);
+
+    MemoryChunk * buffer = get_search_chunk();
+
+    /* the internal buffer of the DB handle is shared by all readers,
+       use the per-thread buffer instead. */
+    DBT db_data;
+    memset(&db_data, 0, sizeof(DBT));
+    db_data.data = buffer->begin();
+    db_data.ulen = buffer->size();
+    db_data.flags = DB_DBT_USERMEM;
+    int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+
+    if (DB_BUFFER_SMALL == ret) {
+        /* db_data.size contains the required length. */
+        buffer->set_size(db_data.size);
+        db_data.data = buffer->begin();
+        db_data.ulen = buffer->size();
+        ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
+    }
+
+    if (ret != 0)
+        return result;
+
+    /* continue searching. */
+    result |= SEARCH_CONTINUED;
+    if (0 == db_data.size)
+        return result;
+
+    MemoryChunk chunk;
+    chunk.set_chunk(db_data.data, db_data.size, NULL);
+
+    result = search_internal(options, phrase_length, chunk, keys, ranges) |
+        result;
+
+    return result;
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::search_suggestion_internal
 (/* in */ const DBT & db_data,
@@ -236,14 +338,12 @@ int ChewingLargeTable2::search_suggestion_internal
  /* out */ PhraseTokens tokens) const {
     int result = SEARCH_NONE;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    entry.m_chunk.set_chunk(db_data.data, db_data.size, NULL);
 
-    result = entry->search_suggestion(prefix_len, prefix_keys, tokens) | result;
+    result = entry.search_suggestion(prefix_len, prefix_keys, tokens) | result;
 
     return result;
 }
@@ -304,6 +404,7 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
 
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
 
     if (ret != 0) {
@@ -324,7 +425,9 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
             db_key.data = (void *) index;
             db_key.size = len * sizeof(ChewingKey);
 
+            /* only check the existence of the entry. */
             memset(&db_data, 0, sizeof(DBT));
+            db_data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
 
             ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
             /* found entry. */
@@ -342,8 +445,10 @@ int ChewingLargeTable2::add_index_internal(/* in */ const ChewingKey index[],
         return ERROR_OK;
     }
 
-    /* already have keys. */
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    /* already have keys, copy the returned data. */
+    entry->m_chunk.set_size(0);
+    entry->m_chunk.set_content(0, db_data.data, db_data.size);
+    free(db_data.data);
     int result = entry->add_index(keys, token);
 
     /* store the entry. */
@@ -410,11 +515,15 @@ int ChewingLargeTable2::remove_index_internal(/* in */ const ChewingKey index[],
 
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
     if (ret != 0)
         return ERROR_REMOVE_ITEM_DONOT_EXISTS;
 
-    entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    /* copy the returned data. */
+    entry->m_chunk.set_size(0);
+    entry->m_chunk.set_content(0, db_data.data, db_data.size);
+    free(db_data.data);
 
     int result = entry->remove_index(keys, token);
     if (ERROR_OK != result)
@@ -479,9 +588,11 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
     if (NULL == cursorp)
         return false;
 
-    /* Initialize our DBTs. */
+    /* Initialize our DBTs, the buffers are re-used by each record. */
     memset(&db_key, 0, sizeof(DBT));
     memset(&db_data, 0, sizeof(DBT));
+    db_key.flags = DB_DBT_REALLOC;
+    db_data.flags = DB_DBT_REALLOC;
 
     /* Iterate over the database, retrieving each record in turn. */
     int ret = 0;
@@ -495,15 +606,17 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
                 g_ptr_array_index(m_entries, phrase_length);            \
             assert(NULL != entry);                                      \
                                                                         \
-            entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL); \
+            entry->m_chunk.set_size(0);                                 \
+            entry->m_chunk.set_content(0, db_data.data, db_data.size);  \
                                                                         \
             entry->mask_out(mask, value);                               \
                                                                         \
-            memset(&db_data, 0, sizeof(DBT));                           \
-            db_data.data = entry->m_chunk.begin();                      \
-            db_data.size = entry->m_chunk.size();                       \
+            DBT db_entry;                                               \
+            memset(&db_entry, 0, sizeof(DBT));                          \
+            db_entry.data = entry->m_chunk.begin();                     \
+            db_entry.size = entry->m_chunk.size();                      \
             int ret = cursorp->put                                      \
-                (cursorp, &db_key, &db_data,  DB_CURRENT);              \
+                (cursorp, &db_key, &db_entry,  DB_CURRENT);             \
             assert(ret == 0);                                           \
             break;                                                      \
         }
@@ -530,16 +643,14 @@ bool ChewingLargeTable2::mask_out(phrase_token_t mask,
         }
 
 #undef CASE
-
-        /* Initialize our DBTs. */
-        memset(&db_key, 0, sizeof(DBT));
-        memset(&db_data, 0, sizeof(DBT));
     }
     assert(ret == DB_NOTFOUND);
 
     /* Cursors must be closed */
     if (cursorp != NULL)
         cursorp->c_close(cursorp);
+    free(db_key.data);
+    free(db_data.data);
 
     m_db->sync(m_db, 0);
 
@@ -573,8 +684,10 @@ int ChewingLargeTable2::search_suggestion
     db_key1.data = (void *) index;
     db_key1.size = prefix_len * sizeof(ChewingKey);
 
+    /* only check the existence of the prefix entry. */
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
     /* Get the prefix entry */
     ret = cursorp->c_get(cursorp, &db_key1, &db_data, DB_SET);
     if (ret != 0) {
@@ -582,30 +695,24 @@ int ChewingLargeTable2::search_suggestion
         return result;
     }
 
-    /* Get the next entry */
+    /* Get the next entry, the buffers are re-used by each entry. */
     DBT db_key2;
     memset(&db_key2, 0, sizeof(DBT));
+    db_key2.flags = DB_DBT_REALLOC;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_REALLOC;
     ret = cursorp->c_get(cursorp, &db_key2, &db_data, DB_NEXT);
-    if (ret != 0) {
-        cursorp->c_close(cursorp);
-        return result;
-    }
 
-    while(bdb_chewing_continue_search(&db_key1, &db_key2)) {
+    while(0 == ret && bdb_chewing_continue_search(&db_key1, &db_key2)) {
         int phrase_length = db_key2.size / sizeof(ChewingKey);
         result = search_suggestion_internal
             (phrase_length, db_data, prefix_len, prefix_keys, tokens) | result;
 
-        memset(&db_key2, 0, sizeof(DBT));
-        memset(&db_data, 0, sizeof(DBT));
         ret = cursorp->c_get(cursorp, &db_key2, &db_data, DB_NEXT);
-        if (ret != 0) {
-            cursorp->c_close(cursorp);
-            return result;
-        }
     }
 
+    free(db_key2.data);
+    free(db_data.data);
     cursorp->c_close(cursorp);
     return result;
 }
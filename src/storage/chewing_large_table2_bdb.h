@@ -25,6 +25,7 @@
 #include <db.h>
 #include <glib.h>
 #include "table_info.h"
+#include "bloom_filter.h"
 
 namespace pinyin{
 
@@ -45,15 +46,38 @@ protected:
 
     void fini_entries();
 
+    /* Bloom filters of the chewing indexes in the DBM,
+       indexed by the phrase length. */
+    BloomFilter m_filters[MAX_PHRASE_LENGTH + 1];
+
+    void init_filters();
+
+    void fini_filters();
+
+    void add_filters(int phrase_length, /* in */ const ChewingKey index[]);
+
+    /* the filters are built on the first search, so the system table
+       replaced by the compact table never scans the DBM. */
+    mutable gint m_filters_ready;
+    mutable GMutex m_filters_lock;
+
+    void ensure_filters() const;
+
     void reset();
 
 protected:
     template<int phrase_length>
-    int search_internal(/* in */ const ChewingKey index[],
+    int search_internal(pinyin_option_t options,
+                        /* in */ const MemoryChunk & chunk,
                         /* in */ const ChewingKey keys[],
                         /* out */ PhraseIndexRanges ranges) const;
 
-    int search_internal(int phrase_length,
+    int search_internal(pinyin_option_t options, int phrase_length,
+                        /* in */ const MemoryChunk & chunk,
+                        /* in */ const ChewingKey keys[],
+                        /* out */ PhraseIndexRanges ranges) const;
+
+    int search_internal(pinyin_option_t options, int phrase_length,
                         /* in */ const ChewingKey index[],
                         /* in */ const ChewingKey keys[],
                         /* out */ PhraseIndexRanges ranges) const;
@@ -96,6 +120,7 @@ public:
 
     ~ChewingLargeTable2() {
         reset();
+        g_mutex_clear(&m_filters_lock);
     }
 
     /* attach method */
@@ -113,6 +138,11 @@ public:
     int search(int phrase_length, /* in */ const ChewingKey keys[],
                /* out */ PhraseIndexRanges ranges) const;
 
+    /* search_fuzzy method */
+    int search_fuzzy(pinyin_option_t options, int phrase_length,
+                     /* in */ const ChewingKey keys[],
+                     /* out */ PhraseIndexRanges ranges) const;
+
     /* search_suggesion method */
     int search_suggestion(int prefix_len,
                           /* in */ const ChewingKey prefix_keys[],
@@ -127,6 +157,9 @@ public:
 
     /* mask out method */
     bool mask_out(phrase_token_t mask, phrase_token_t value);
+
+    /* get the number of the DBM lookups rejected by the Bloom filters. */
+    guint32 get_filter_rejects() const;
 };
 
 };
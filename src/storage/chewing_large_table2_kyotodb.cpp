@@ -60,6 +60,9 @@ ChewingLargeTable2::ChewingLargeTable2() {
 
     m_entries = NULL;
     init_entries();
+
+    m_filters_ready = FALSE;
+    g_mutex_init(&m_filters_lock);
 }
 
 void ChewingLargeTable2::reset() {
@@ -71,6 +74,48 @@ void ChewingLargeTable2::reset() {
     }
 
     fini_entries();
+    fini_filters();
+}
+
+/* filter methods */
+void ChewingLargeTable2::init_filters() {
+    fini_filters();
+
+    if (NULL == m_db)
+        return;
+
+    guint32 counts[MAX_PHRASE_LENGTH + 1] = {0};
+
+    /* the first pass counts the keys, the second pass adds the keys. */
+    for (int pass = 0; pass < 2; ++pass) {
+        BasicDB::Cursor * cursor = m_db->cursor();
+        cursor->jump();
+
+        while (true) {
+            size_t ksiz = 0;
+            /* step to the next record after the key is retrieved. */
+            char * kbuf = cursor->get_key(&ksiz, true);
+            if (NULL == kbuf)
+                break;
+
+            int phrase_length = ksiz / sizeof(ChewingKey);
+            assert(0 < phrase_length && phrase_length <= MAX_PHRASE_LENGTH);
+
+            if (0 == pass)
+                ++counts[phrase_length];
+            else
+                m_filters[phrase_length].add(kbuf, ksiz);
+
+            delete [] kbuf;
+        }
+
+        delete cursor;
+
+        if (0 == pass) {
+            for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+                m_filters[len].init(counts[len]);
+        }
+    }
 }
 
 /* attach method */
@@ -86,7 +131,10 @@ bool ChewingLargeTable2::attach(const char * dbfile, guint32 flags) {
 
     m_db = new TreeDB;
 
-    return m_db->open(dbfile, mode);
+    if (!m_db->open(dbfile, mode))
+        return false;
+
+    return true;
 }
 
 /* load/store method */
@@ -146,45 +194,29 @@ bool ChewingLargeTable2::save_db(const char * new_filename) {
 }
 
 template<int phrase_length>
-int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        /* in */ const MemoryChunk & chunk,
                                         /* in */ const ChewingKey keys[],
                                         /* out */ PhraseIndexRanges ranges) const {
-    int result = SEARCH_NONE;
-
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
-
-    const char * kbuf = (char *) index;
-    const int32_t vsiz = m_db->check(kbuf, phrase_length * sizeof(ChewingKey));
-    /* -1 on failure. */
-    if (-1 == vsiz)
-        return result;
-
-    /* continue searching. */
-    result |= SEARCH_CONTINUED;
-    if (0 == vsiz)
-        return result;
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    entry->m_chunk.set_size(vsiz);
-    /* m_chunk may re-allocate here. */
-    char * vbuf = (char *) entry->m_chunk.begin();
-    check_result(vsiz == m_db->get(kbuf, phrase_length * sizeof(ChewingKey),
-                                   vbuf, vsiz));
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
 
-    result = entry->search(keys, ranges) | result;
+    if (options & PINYIN_AMB_ALL)
+        return entry.search_fuzzy(options, keys, ranges);
 
-    return result;
+    return entry.search(keys, ranges);
 }
 
-int ChewingLargeTable2::search_internal(int phrase_length,
-                                        /* in */ const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        /* in */ const MemoryChunk & chunk,
                                         /* in */ const ChewingKey keys[],
                                         /* out */ PhraseIndexRanges ranges) const {
-#define CASE(len) case len:                                 \
-    {                                                       \
-        return search_internal<len>(index, keys, ranges);   \
+#define CASE(len) case len:                                         \
+    {                                                               \
+        return search_internal<len>(options, chunk, keys, ranges);  \
     }
 
     switch(phrase_length) {
@@ -213,6 +245,63 @@ int ChewingLargeTable2::search_internal(int phrase_length,
     return SEARCH_NONE;
 }
 
+/* search the value in place under the read lock of kyoto cabinet,
+   to avoid copying the value out of the db. */
+class SearchVisitor2 : public DB::Visitor {
+private:
+    const ChewingLargeTable2 * m_table;
+    pinyin_option_t m_options;
+    int m_phrase_length;
+    const ChewingKey * m_keys;
+    GArray ** m_ranges;
+    int m_result;
+
+public:
+    SearchVisitor2(const ChewingLargeTable2 * table, pinyin_option_t options,
+                   int phrase_length, const ChewingKey keys[],
+                   PhraseIndexRanges ranges) :
+        m_table(table), m_options(options), m_phrase_length(phrase_length),
+        m_keys(keys), m_ranges(ranges), m_result(SEARCH_NONE) {
+    }
+
+    int get_result() const {
+        return m_result;
+    }
+
+    virtual const char* visit_full(const char* kbuf, size_t ksiz,
+                                   const char* vbuf, size_t vsiz, size_t* sp) {
+        /* continue searching. */
+        m_result |= SEARCH_CONTINUED;
+        if (0 == vsiz)
+            return NOP;
+
+        MemoryChunk chunk;
+        chunk.set_chunk((char *) vbuf, vsiz, NULL);
+        m_result = m_table->search_internal
+            (m_options, m_phrase_length, chunk, m_keys, m_ranges) | m_result;
+        return NOP;
+    }
+
+    virtual const char* visit_empty(const char* kbuf, size_t ksiz, size_t* sp) {
+        return NOP;
+    }
+};
+
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        /* in */ const ChewingKey index[],
+                                        /* in */ const ChewingKey keys[],
+                                        /* out */ PhraseIndexRanges ranges) const {
+    const char * kbuf = (char *) index;
+    SearchVisitor2 visitor(this, options, phrase_length, keys, ranges);
+
+    if (!m_db->accept(kbuf, phrase_length * sizeof(ChewingKey),
+                      &visitor, false))
+        return SEARCH_NONE;
+
+    return visitor.get_result();
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::search_suggestion_internal
 (/* in */ const MemoryChunk & chunk,
@@ -221,16 +310,12 @@ int ChewingLargeTable2::search_suggestion_internal
  /* out */ PhraseTokens tokens) const {
     int result = SEARCH_NONE;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
-
-    entry->m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    result = entry->search_suggestion(prefix_len, prefix_keys, tokens) | result;
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
 
-    entry->m_chunk.set_size(0);
+    result = entry.search_suggestion(prefix_len, prefix_keys, tokens) | result;
 
     return result;
 }
@@ -58,6 +58,9 @@ ChewingLargeTable2::ChewingLargeTable2() {
 
     m_entries = NULL;
     init_entries();
+
+    m_filters_ready = FALSE;
+    g_mutex_init(&m_filters_lock);
 }
 
 void ChewingLargeTable2::reset() {
@@ -69,6 +72,41 @@ void ChewingLargeTable2::reset() {
     }
 
     fini_entries();
+    fini_filters();
+}
+
+/* filter methods */
+void ChewingLargeTable2::init_filters() {
+    fini_filters();
+
+    if (NULL == m_db)
+        return;
+
+    guint32 counts[MAX_PHRASE_LENGTH + 1] = {0};
+
+    /* the first pass counts the keys, the second pass adds the keys. */
+    for (int pass = 0; pass < 2; ++pass) {
+        std::unique_ptr<DBM::Iterator> iter = m_db->MakeIterator();
+        iter->First();
+
+        std::string key;
+        while (iter->Get(&key, nullptr).IsOK()) {
+            int phrase_length = key.size() / sizeof(ChewingKey);
+            assert(0 < phrase_length && phrase_length <= MAX_PHRASE_LENGTH);
+
+            if (0 == pass)
+                ++counts[phrase_length];
+            else
+                m_filters[phrase_length].add(key.data(), key.size());
+
+            iter->Next();
+        }
+
+        if (0 == pass) {
+            for (int len = 1; len <= MAX_PHRASE_LENGTH; ++len)
+                m_filters[len].init(counts[len]);
+        }
+    }
 }
 
 /* attach method */
@@ -85,7 +123,10 @@ bool ChewingLargeTable2::attach(const char * dbfile, guint32 flags) {
         return false;
 
     m_db = new TreeDBM;
-    return m_db->Open(dbfile, writable, options).IsOK();
+    if (!m_db->Open(dbfile, writable, options).IsOK())
+        return false;
+
+    return true;
 }
 
 /* load_db/save_db method */
@@ -130,44 +171,29 @@ bool ChewingLargeTable2::save_db(const char * new_filename) {
 }
 
 template<int phrase_length>
-int ChewingLargeTable2::search_internal(/* in */ const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        /* in */ const MemoryChunk & chunk,
                                         /* in */ const ChewingKey keys[],
                                         /* out */ PhraseIndexRanges ranges) const {
-    int result = SEARCH_NONE;
-
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
-
-    std::string_view key(reinterpret_cast<const char*>(index), phrase_length * sizeof(ChewingKey));
-    std::string value;
-
-    Status status = m_db->Get(key, &value);
-
-    if (!status.IsOK())
-        return result;
-
-    /* continue searching. */
-    result |= SEARCH_CONTINUED;
-    if (value.empty())
-        return result;
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    entry->m_chunk.set_size(value.size());
-    memcpy(entry->m_chunk.begin(), value.data(), value.size());
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
 
-    result = entry->search(keys, ranges) | result;
+    if (options & PINYIN_AMB_ALL)
+        return entry.search_fuzzy(options, keys, ranges);
 
-    return result;
+    return entry.search(keys, ranges);
 }
 
-int ChewingLargeTable2::search_internal(int phrase_length,
-                                        const ChewingKey index[],
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        const MemoryChunk & chunk,
                                         const ChewingKey keys[],
                                         PhraseIndexRanges ranges) const {
-#define CASE(len) case len:                                 \
-    {                                                       \
-        return search_internal<len>(index, keys, ranges);   \
+#define CASE(len) case len:                                         \
+    {                                                               \
+        return search_internal<len>(options, chunk, keys, ranges);  \
     }
 
     switch(phrase_length) {
@@ -196,6 +222,59 @@ int ChewingLargeTable2::search_internal(int phrase_length,
     return SEARCH_NONE;
 }
 
+/* search the value in place inside the record processor,
+   to avoid copying the value into a std::string. */
+class SearchProcessor2 : public DBM::RecordProcessor {
+    const ChewingLargeTable2 * m_table;
+    pinyin_option_t m_options;
+    int m_phrase_length;
+    const ChewingKey * m_keys;
+    GArray ** m_ranges;
+    int m_result;
+
+public:
+    SearchProcessor2(const ChewingLargeTable2 * table, pinyin_option_t options,
+                     int phrase_length, const ChewingKey keys[],
+                     PhraseIndexRanges ranges)
+        : m_table(table), m_options(options), m_phrase_length(phrase_length),
+          m_keys(keys), m_ranges(ranges), m_result(SEARCH_NONE) {}
+
+    int get_result() const {
+        return m_result;
+    }
+
+    std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+        /* continue searching. */
+        m_result |= SEARCH_CONTINUED;
+        if (value.empty())
+            return NOOP;
+
+        MemoryChunk chunk;
+        chunk.set_chunk(const_cast<char*>(value.data()), value.size(), NULL);
+        m_result = m_table->search_internal
+            (m_options, m_phrase_length, chunk, m_keys, m_ranges) | m_result;
+        return NOOP;
+    }
+
+    std::string_view ProcessEmpty(std::string_view key) override {
+        return NOOP;
+    }
+};
+
+int ChewingLargeTable2::search_internal(pinyin_option_t options,
+                                        int phrase_length,
+                                        const ChewingKey index[],
+                                        const ChewingKey keys[],
+                                        PhraseIndexRanges ranges) const {
+    std::string_view key(reinterpret_cast<const char*>(index), phrase_length * sizeof(ChewingKey));
+    SearchProcessor2 processor(this, options, phrase_length, keys, ranges);
+
+    if (!m_db->Process(key, &processor, false).IsOK())
+        return SEARCH_NONE;
+
+    return processor.get_result();
+}
+
 template<int phrase_length>
 int ChewingLargeTable2::search_suggestion_internal
 (/* in */ const MemoryChunk & chunk,
@@ -204,16 +283,12 @@ int ChewingLargeTable2::search_suggestion_internal
  /* out */ PhraseTokens tokens) const {
     int result = SEARCH_NONE;
 
-    ChewingTableEntry<phrase_length> * entry =
-        (ChewingTableEntry<phrase_length> *)
-        g_ptr_array_index(m_entries, phrase_length);
-    assert(NULL != entry);
-
-    entry->m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
+    /* use a local entry, as this method may be called concurrently. */
+    ChewingTableEntry<phrase_length> entry;
 
-    result = entry->search_suggestion(prefix_len, prefix_keys, tokens) | result;
+    entry.m_chunk.set_chunk(chunk.begin(), chunk.size(), NULL);
 
-    entry->m_chunk.set_size(0);
+    result = entry.search_suggestion(prefix_len, prefix_keys, tokens) | result;
 
     return result;
 }
@@ -0,0 +1,111 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEWING_TABLE_TEXT_H
+#define CHEWING_TABLE_TEXT_H
+
+#include <stdio.h>
+#include <string.h>
+#include "novel_types.h"
+#include "chewing_key.h"
+#include "table_info.h"
+#include "pinyin_parser2.h"
+#include "zhuyin_parser2.h"
+
+namespace pinyin{
+
+/**
+ * load_chewing_table_text:
+ * @table: the chewing table to add the indexes.
+ * @infile: the table text file.
+ * @type: the phonetic type of the table.
+ * @returns: whether the load operation is successful.
+ *
+ * Parse the pinyin or zhuyin table text, and add the indexes into
+ *   the chewing table, which provides the add_index method.
+ *
+ */
+template<class Table>
+bool load_chewing_table_text(Table * table, FILE * infile,
+                             TABLE_PHONETIC_TYPE type) {
+    char pinyin[256];
+    char phrase[256];
+    phrase_token_t token;
+    size_t freq;
+
+    while (!feof(infile)) {
+#ifdef __APPLE__
+        int num = fscanf(infile, "%255s %255[^ \t] %u %ld",
+                         pinyin, phrase, &token, &freq);
+#else
+        int num = fscanf(infile, "%255s %255s %u %ld",
+                         pinyin, phrase, &token, &freq);
+#endif
+
+        if (4 != num)
+            continue;
+
+        if(feof(infile))
+            break;
+
+        glong len = g_utf8_strlen(phrase, -1);
+
+        ChewingKeyVector keys;
+        ChewingKeyRestVector key_rests;
+
+        keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+        key_rests = g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+
+        switch (type) {
+        case PINYIN_TABLE: {
+            PinyinDirectParser2 parser;
+            pinyin_option_t options = USE_TONE;
+            parser.parse(options, keys, key_rests, pinyin, strlen(pinyin));
+            break;
+        }
+
+        case ZHUYIN_TABLE: {
+            ZhuyinDirectParser2 parser;
+            pinyin_option_t options = USE_TONE | FORCE_TONE;
+            parser.parse(options, keys, key_rests, pinyin, strlen(pinyin));
+            break;
+        }
+        };
+
+        if (len != keys->len) {
+            fprintf(stderr, "load_chewing_table_text:%s\t%s\t%u\t%ld\n",
+                    pinyin, phrase, token, freq);
+            g_array_free(keys, TRUE);
+            g_array_free(key_rests, TRUE);
+            continue;
+        }
+
+        table->add_index(keys->len, (ChewingKey *)keys->data, token);
+
+        g_array_free(keys, TRUE);
+        g_array_free(key_rests, TRUE);
+    }
+
+    return true;
+}
+
+};
+
+#endif
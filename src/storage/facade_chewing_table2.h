@@ -23,6 +23,7 @@
 
 #include "novel_types.h"
 #include "chewing_large_table2.h"
+#include "chewing_compact_table.h"
 
 namespace pinyin{
 
@@ -36,6 +37,7 @@ namespace pinyin{
 class FacadeChewingTable2{
 private:
     ChewingLargeTable2 * m_system_chewing_table;
+    ChewingCompactTable * m_system_compact_table;
     ChewingLargeTable2 * m_user_chewing_table;
 
     void reset() {
@@ -44,6 +46,11 @@ private:
             m_system_chewing_table = NULL;
         }
 
+        if (m_system_compact_table) {
+            delete m_system_compact_table;
+            m_system_compact_table = NULL;
+        }
+
         if (m_user_chewing_table) {
             delete m_user_chewing_table;
             m_user_chewing_table = NULL;
@@ -59,6 +66,7 @@ public:
      */
     FacadeChewingTable2() {
         m_system_chewing_table = NULL;
+        m_system_compact_table = NULL;
         m_user_chewing_table = NULL;
     }
 
@@ -90,6 +98,35 @@ public:
         return result;
     }
 
+    /**
+     * FacadeChewingTable2::load_compact:
+     * @compact_filename: the compact system chewing table file.
+     * @returns: whether the load operation is successful.
+     *
+     * Replace the system chewing table with the compact one,
+     * the user chewing table is kept.
+     *
+     * Note: call this method after the load method.
+     *
+     */
+    bool load_compact(const char * compact_filename) {
+        ChewingCompactTable * table = new ChewingCompactTable;
+        if (!table->attach(compact_filename)) {
+            delete table;
+            return false;
+        }
+
+        if (m_system_compact_table)
+            delete m_system_compact_table;
+        m_system_compact_table = table;
+
+        if (m_system_chewing_table) {
+            delete m_system_chewing_table;
+            m_system_chewing_table = NULL;
+        }
+        return true;
+    }
+
     bool store(const char * new_user_filename) {
         if (NULL == m_user_chewing_table)
             return false;
@@ -105,6 +142,9 @@ public:
      *
      * Search the phrase tokens according to the pinyin keys.
      *
+     * Note: concurrent readers are safe when no writer is active,
+     *   the Berkeley DB handles are opened with DB_THREAD.
+     *
      */
     int search(int phrase_length, /* in */ const ChewingKey keys[],
                /* out */ PhraseIndexRanges ranges) const {
@@ -121,6 +161,10 @@ public:
             result |= m_system_chewing_table->search
                 (phrase_length, keys, ranges);
 
+        if (NULL != m_system_compact_table)
+            result |= m_system_compact_table->search
+                (phrase_length, keys, ranges);
+
         if (NULL != m_user_chewing_table)
             result |= m_user_chewing_table->search
                 (phrase_length, keys, ranges);
@@ -128,6 +172,41 @@ public:
         return result;
     }
 
+    /**
+     * FacadeChewingTable2::search_fuzzy:
+     * @options: the fuzzy pinyin options.
+     * @phrase_length: the length of the phrase to be searched.
+     * @keys: the pinyin key of the phrase to be searched.
+     * @ranges: the array of GArrays to store the matched phrase token.
+     * @returns: the search result of enum SearchResult.
+     *
+     * Search the phrase tokens of all the fuzzy pinyin keys in one lookup,
+     * the pinyin keys of the phrases are verified with the options.
+     *
+     */
+    int search_fuzzy(pinyin_option_t options, int phrase_length,
+                     /* in */ const ChewingKey keys[],
+                     /* out */ PhraseIndexRanges ranges) const {
+        if (!(options & PINYIN_AMB_ALL))
+            return search(phrase_length, keys, ranges);
+
+        int result = SEARCH_NONE;
+
+        if (NULL != m_system_chewing_table)
+            result |= m_system_chewing_table->search_fuzzy
+                (options, phrase_length, keys, ranges);
+
+        if (NULL != m_system_compact_table)
+            result |= m_system_compact_table->search_fuzzy
+                (options, phrase_length, keys, ranges);
+
+        if (NULL != m_user_chewing_table)
+            result |= m_user_chewing_table->search_fuzzy
+                (options, phrase_length, keys, ranges);
+
+        return result;
+    }
+
     /**
      * FacadeChewingTable2::search_suggestion:
      * @prefix_len: the length of the prefix to be searched.
@@ -147,6 +226,10 @@ public:
             result |= m_system_chewing_table->search_suggestion
                 (prefix_len, prefix_keys, tokens);
 
+        if (NULL != m_system_compact_table)
+            result |= m_system_compact_table->search_suggestion
+                (prefix_len, prefix_keys, tokens);
+
         if (NULL != m_user_chewing_table)
             result |= m_user_chewing_table->search_suggestion
                 (prefix_len, prefix_keys, tokens);
@@ -203,6 +286,29 @@ public:
         return m_user_chewing_table->mask_out(mask, value);
     }
 
+    /**
+     * FacadeChewingTable2::get_filter_rejects:
+     * @returns: the number of rejected lookups.
+     *
+     * Get the number of the DBM lookups skipped by the filters of
+     * the system and user chewing tables.
+     *
+     * Note: the compact system table has no filter, and the rejects
+     *   of the bi-gram filter are counted by Bigram::get_filter_rejects.
+     *
+     */
+    guint32 get_filter_rejects() const {
+        guint32 rejects = 0;
+
+        if (NULL != m_system_chewing_table)
+            rejects += m_system_chewing_table->get_filter_rejects();
+
+        if (NULL != m_user_chewing_table)
+            rejects += m_user_chewing_table->get_filter_rejects();
+
+        return rejects;
+    }
+
 };
 
 };
@@ -25,13 +25,20 @@
 #include "memory_chunk.h"
 #include "novel_types.h"
 #include "ngram.h"
+#include "ngram_mmap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace pinyin;
 
-struct SingleGramItem{
-    phrase_token_t m_token;
-    guint32 m_freq;
-};
+/* SingleGramItem and BigramPhraseItem share the layout,
+   the SIMD kernels convert the freq in place. */
+G_STATIC_ASSERT(sizeof(SingleGramItem) == sizeof(BigramPhraseItem));
+G_STATIC_ASSERT(sizeof(guint32) == sizeof(gfloat));
 
 SingleGram::SingleGram(){
     m_chunk.set_size(sizeof(guint32));
@@ -150,6 +157,118 @@ bool SingleGram::retrieve_all(/* out */ BigramPhraseWithCountArray array)
     return true;
 }
 
+namespace pinyin{
+
+size_t single_gram_scan_range(const SingleGramItem * items, size_t num,
+                              phrase_token_t range_end,
+                              bool vectorized){
+    size_t i = 0;
+
+    /* compare the tokens in blocks, and finish with the scalar loop
+       when some token in the block reaches the range end. */
+#if defined(__AVX2__)
+    if (vectorized) {
+        const __m256i sign = _mm256_set1_epi32(0x80000000);
+        const __m256i bound = _mm256_xor_si256
+            (_mm256_set1_epi32(range_end), sign);
+
+        for (; i + 8 <= num; i += 8) {
+            const __m256 lo = _mm256_loadu_ps((const float *)(items + i));
+            const __m256 hi = _mm256_loadu_ps((const float *)(items + i + 4));
+            /* the tokens are out of order here, but all of them are
+               checked against the range end. */
+            const __m256i tokens = _mm256_castps_si256
+                (_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            /* unsigned compare by flipping the sign bits. */
+            const __m256i less = _mm256_cmpgt_epi32
+                (bound, _mm256_xor_si256(tokens, sign));
+            if (0xFF != _mm256_movemask_ps(_mm256_castsi256_ps(less)))
+                break;
+        }
+    }
+#elif defined(__SSE2__)
+    if (vectorized) {
+        const __m128i sign = _mm_set1_epi32(0x80000000);
+        const __m128i bound = _mm_xor_si128(_mm_set1_epi32(range_end), sign);
+
+        for (; i + 4 <= num; i += 4) {
+            const __m128 lo = _mm_loadu_ps((const float *)(items + i));
+            const __m128 hi = _mm_loadu_ps((const float *)(items + i + 2));
+            const __m128i tokens = _mm_castps_si128
+                (_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            /* unsigned compare by flipping the sign bits. */
+            const __m128i less = _mm_cmpgt_epi32
+                (bound, _mm_xor_si128(tokens, sign));
+            if (0xF != _mm_movemask_ps(_mm_castsi128_ps(less)))
+                break;
+        }
+    }
+#endif
+
+    for (; i < num; ++i) {
+        if (items[i].m_token >= range_end)
+            break;
+    }
+
+    return i;
+}
+
+void single_gram_normalize(const SingleGramItem * items, size_t num,
+                           guint32 total_freq, BigramPhraseItem * out,
+                           bool vectorized){
+    size_t i = 0;
+
+    /* the freqs are converted as signed integers, which matches the
+       scalar conversion until the sign bit of some freq is set,
+       then finish with the scalar loop. */
+#if defined(__AVX2__)
+    if (vectorized) {
+        const __m256 total = _mm256_set1_ps((gfloat)total_freq);
+
+        for (; i + 4 <= num; i += 4) {
+            const __m256i packed = _mm256_loadu_si256
+                ((const __m256i *)(items + i));
+            const __m256 value = _mm256_castsi256_ps(packed);
+            if (_mm256_movemask_ps(value) & 0xAA)
+                break;
+
+            const __m256 freqs = _mm256_div_ps
+                (_mm256_cvtepi32_ps(packed), total);
+            /* keep the tokens, and replace the freqs. */
+            _mm256_storeu_ps((float *)(out + i),
+                             _mm256_blend_ps(value, freqs, 0xAA));
+        }
+    }
+#elif defined(__SSE2__)
+    if (vectorized) {
+        const __m128 total = _mm_set1_ps((gfloat)total_freq);
+        const __m128i freq_mask = _mm_set_epi32(-1, 0, -1, 0);
+
+        for (; i + 2 <= num; i += 2) {
+            const __m128i packed = _mm_loadu_si128
+                ((const __m128i *)(items + i));
+            if (_mm_movemask_ps(_mm_castsi128_ps(packed)) & 0xA)
+                break;
+
+            const __m128i freqs = _mm_castps_si128
+                (_mm_div_ps(_mm_cvtepi32_ps(packed), total));
+            /* keep the tokens, and replace the freqs. */
+            const __m128i merged = _mm_or_si128
+                (_mm_andnot_si128(freq_mask, packed),
+                 _mm_and_si128(freq_mask, freqs));
+            _mm_storeu_si128((__m128i *)(out + i), merged);
+        }
+    }
+#endif
+
+    for (; i < num; ++i) {
+        out[i].m_token = items[i].m_token;
+        out[i].m_freq = items[i].m_freq / (gfloat)total_freq;
+    }
+}
+
+};
+
 bool SingleGram::search(/* in */ PhraseIndexRange * range,
 			/* out */ BigramPhraseArray array) const {
     const SingleGramItem * begin = (const SingleGramItem *)
@@ -161,16 +280,18 @@ bool SingleGram::search(/* in */ PhraseIndexRange * range,
     const SingleGramItem * cur_item = std_lite::lower_bound(begin, end, compare_item, token_less_than);
 
     guint32 total_freq;
-    BigramPhraseItem bigram_item;
     check_result(get_total_freq(total_freq));
 
-    for ( ; cur_item != end; ++cur_item){
-        if ( cur_item->m_token >= range->m_range_end )
-            break;
-        bigram_item.m_token = cur_item->m_token;
-        bigram_item.m_freq = cur_item->m_freq / (gfloat)total_freq;
-        g_array_append_val(array, bigram_item);
-    }
+    const size_t num = single_gram_scan_range
+        (cur_item, end - cur_item, range->m_range_end);
+    if (0 == num)
+        return true;
+
+    /* write the items in place. */
+    const guint len = array->len;
+    g_array_set_size(array, len + num);
+    single_gram_normalize(cur_item, num, total_freq,
+                          &g_array_index(array, BigramPhraseItem, len));
 
     return true;
 }
@@ -270,6 +391,26 @@ bool SingleGram::set_freq( /* in */ phrase_token_t token,
     return false;
 }
 
+/* build the filter from all the previous tokens in the db. */
+bool Bigram::init_filter(){
+    m_filter.disable();
+
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    if (!get_all_items(items)) {
+        g_array_free(items, TRUE);
+        return false;
+    }
+
+    bool retval = m_filter.init(items->len);
+    for (size_t i = 0; retval && i < items->len; ++i) {
+        phrase_token_t token = g_array_index(items, phrase_token_t, i);
+        m_filter.add(&token, sizeof(phrase_token_t));
+    }
+
+    g_array_free(items, TRUE);
+    return retval;
+}
+
 
 namespace pinyin{
 
@@ -295,15 +436,10 @@ bool merge_single_gram(SingleGram * merged, const SingleGram * system,
         return true;
     }
 
-    /* clear merged. */
-    merged_chunk.set_size(sizeof(guint32));
-
-    /* merge the origin info and delta info */
     guint32 system_total, user_total;
     check_result(system->get_total_freq(system_total));
     check_result(user->get_total_freq(user_total));
     const guint32 merged_total = system_total + user_total;
-    merged_chunk.set_content(0, &merged_total, sizeof(guint32));
 
     const SingleGramItem * cur_system = (const SingleGramItem *)
         (((const char *)(system->m_chunk.begin())) + sizeof(guint32));
@@ -315,39 +451,177 @@ bool merge_single_gram(SingleGram * merged, const SingleGram * system,
     const SingleGramItem * user_end = (const SingleGramItem *)
         user->m_chunk.end();
 
-    while (cur_system < system_end && cur_user < user_end) {
+    /* copy the other single gram once when one of them has no items. */
+    if (cur_user == user_end || cur_system == system_end) {
+        const SingleGram * single_gram =
+            cur_user == user_end ? system : user;
+        merged_chunk.set_content(0, single_gram->m_chunk.begin(),
+                                 single_gram->m_chunk.size());
+        merged_chunk.set_content(0, &merged_total, sizeof(guint32));
+        return true;
+    }
 
-        if (cur_system->m_token < cur_user->m_token) {
-            /* do append operation here */
-            merged_chunk.append_content(cur_system, sizeof(SingleGramItem));
-            cur_system++;
-        } else if (cur_system->m_token > cur_user->m_token) {
-            /* do append operation here */
-            merged_chunk.append_content(cur_user, sizeof(SingleGramItem));
-            cur_user++;
-        } else {
-            assert(cur_system->m_token == cur_user->m_token);
+    /* reserve the space for the worst case, then clear merged. */
+    merged_chunk.set_size(system->m_chunk.size() + user->m_chunk.size());
+    merged_chunk.set_size(sizeof(guint32));
+
+    /* merge the origin info and delta info */
+    merged_chunk.set_content(0, &merged_total, sizeof(guint32));
 
+    while (cur_system < system_end && cur_user < user_end) {
+        /* copy the system items before the user item at once. */
+        const SingleGramItem * run_end = std_lite::lower_bound
+            (cur_system, system_end, *cur_user, token_less_than);
+        if (run_end != cur_system) {
+            merged_chunk.append_content
+                (cur_system, sizeof(SingleGramItem) * (run_end - cur_system));
+            cur_system = run_end;
+        }
+
+        if (cur_system < system_end &&
+            cur_system->m_token == cur_user->m_token) {
             SingleGramItem merged_item;
             merged_item.m_token = cur_system->m_token;
             merged_item.m_freq = cur_system->m_freq + cur_user->m_freq;
 
             merged_chunk.append_content(&merged_item, sizeof(SingleGramItem));
             cur_system++; cur_user++;
+        } else {
+            /* do append operation here */
+            merged_chunk.append_content(cur_user, sizeof(SingleGramItem));
+            cur_user++;
         }
     }
 
     /* add remained items. */
-    while (cur_system < system_end) {
-        merged_chunk.append_content(cur_system, sizeof(SingleGramItem));
-        cur_system++;
+    if (cur_system < system_end)
+        merged_chunk.append_content
+            (cur_system, sizeof(SingleGramItem) * (system_end - cur_system));
+
+    if (cur_user < user_end)
+        merged_chunk.append_content
+            (cur_user, sizeof(SingleGramItem) * (user_end - cur_user));
+
+    return true;
+}
+
+struct merged_single_gram_item_t{
+    phrase_token_t m_token;
+    /* NULL when neither system nor user single gram exists. */
+    SingleGram * m_merged;
+};
+
+static void free_merged_single_gram_item(merged_single_gram_item_t * item) {
+    if (item->m_merged)
+        delete item->m_merged;
+    delete item;
+}
+
+MergedSingleGramCache::MergedSingleGramCache(Bigram * system_bigram,
+                                             Bigram * user_bigram,
+                                             size_t capacity){
+    assert(capacity > 0);
+
+    m_system_bigram = system_bigram;
+    m_user_bigram = user_bigram;
+    m_mmap_system_bigram = NULL;
+    m_capacity = capacity;
+
+    m_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_queue_init(&m_lru);
+}
+
+MergedSingleGramCache::~MergedSingleGramCache(){
+    clear();
+
+    g_hash_table_destroy(m_index);
+    m_index = NULL;
+}
+
+bool MergedSingleGramCache::set_mmap_system_bigram
+(const MmapBigram * mmap_bigram){
+    m_mmap_system_bigram = mmap_bigram;
+    return clear();
+}
+
+bool MergedSingleGramCache::load(phrase_token_t index,
+                                 const SingleGram * & merged){
+    merged = NULL;
+
+    GList * link = (GList *) g_hash_table_lookup
+        (m_index, GUINT_TO_POINTER(index));
+
+    if (link) {
+        /* move to the head. */
+        g_queue_unlink(&m_lru, link);
+        g_queue_push_head_link(&m_lru, link);
+
+        merged_single_gram_item_t * item =
+            (merged_single_gram_item_t *) link->data;
+        merged = item->m_merged;
+        return NULL != merged;
+    }
+
+    /* evict the least recently used item. */
+    if (m_lru.length >= m_capacity) {
+        merged_single_gram_item_t * item =
+            (merged_single_gram_item_t *) g_queue_pop_tail(&m_lru);
+        g_hash_table_remove(m_index, GUINT_TO_POINTER(item->m_token));
+        free_merged_single_gram_item(item);
     }
 
-    while (cur_user < user_end) {
-        merged_chunk.append_content(cur_user, sizeof(SingleGramItem));
-        cur_user++;
+    SingleGram * system = NULL, * user = NULL;
+    /* the view points into the read-only mapping. */
+    SingleGram system_view;
+    if (m_mmap_system_bigram) {
+        if (m_mmap_system_bigram->load_view(index, system_view))
+            system = &system_view;
+    } else if (m_system_bigram)
+        m_system_bigram->load(index, system);
+    if (m_user_bigram)
+        m_user_bigram->load(index, user);
+
+    merged_single_gram_item_t * item = new merged_single_gram_item_t;
+    item->m_token = index;
+    item->m_merged = new SingleGram;
+
+    if (!merge_single_gram(item->m_merged, system, user)) {
+        delete item->m_merged;
+        item->m_merged = NULL;
     }
 
+    if (system && system != &system_view)
+        delete system;
+    if (user)
+        delete user;
+
+    g_queue_push_head(&m_lru, item);
+    g_hash_table_insert(m_index, GUINT_TO_POINTER(index), m_lru.head);
+
+    merged = item->m_merged;
+    return NULL != merged;
+}
+
+bool MergedSingleGramCache::invalidate(phrase_token_t index){
+    GList * link = (GList *) g_hash_table_lookup
+        (m_index, GUINT_TO_POINTER(index));
+
+    if (NULL == link)
+        return false;
+
+    g_hash_table_remove(m_index, GUINT_TO_POINTER(index));
+    free_merged_single_gram_item((merged_single_gram_item_t *) link->data);
+    g_queue_delete_link(&m_lru, link);
+    return true;
+}
+
+bool MergedSingleGramCache::clear(){
+    g_hash_table_remove_all(m_index);
+
+    merged_single_gram_item_t * item = NULL;
+    while ((item = (merged_single_gram_item_t *) g_queue_pop_head(&m_lru)))
+        free_merged_single_gram_item(item);
+
     return true;
 }
 
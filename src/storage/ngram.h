@@ -41,6 +41,7 @@
 namespace pinyin{
 
 class Bigram;
+class MmapBigram;
 
 /** Note:
  *  The system single gram contains the trained freqs.
@@ -50,6 +51,18 @@ class Bigram;
  */
 
 
+/**
+ * SingleGramItem:
+ *
+ * The item stored in the single gram, sorted by the token.
+ *
+ */
+struct SingleGramItem{
+    phrase_token_t m_token;
+    guint32 m_freq;
+};
+
+
 /**
  * SingleGram:
  *
@@ -58,6 +71,7 @@ class Bigram;
  */
 class SingleGram{
     friend class Bigram;
+    friend class MmapBigram;
     friend bool merge_single_gram(SingleGram * merged,
                                   const SingleGram * system,
                                   const SingleGram * user);
@@ -212,6 +226,150 @@ public:
 bool merge_single_gram(SingleGram * merged, const SingleGram * system,
                        const SingleGram * user);
 
+
+/**
+ * single_gram_scan_range:
+ * @items: the sorted single gram items.
+ * @num: the number of the items.
+ * @range_end: the end of the token range.
+ * @vectorized: whether to use the SIMD kernel when available.
+ * @returns: the number of the leading items before the range end.
+ *
+ * Count the items in the token range, used by SingleGram::search.
+ *
+ */
+size_t single_gram_scan_range(const SingleGramItem * items, size_t num,
+                              phrase_token_t range_end,
+                              bool vectorized = true);
+
+/**
+ * single_gram_normalize:
+ * @items: the single gram items.
+ * @num: the number of the items.
+ * @total_freq: the total freq of the single gram.
+ * @out: the bigram phrase items to be written.
+ * @vectorized: whether to use the SIMD kernel when available.
+ *
+ * Convert the freqs of the items into P(W2|W1),
+ *   used by SingleGram::search.
+ *
+ * Note: the SIMD kernel gives the same results as the scalar one.
+ *
+ */
+void single_gram_normalize(const SingleGramItem * items, size_t num,
+                           guint32 total_freq, BigramPhraseItem * out,
+                           bool vectorized = true);
+
+
+/**
+ * MergedSingleGramCache:
+ *
+ * The bounded LRU cache of the merged system and user single grams,
+ *   keyed by the previous token.
+ *
+ * Note: the cache is not shared, each PhoneticLookup owns one,
+ *   invalidate it when the user bi-gram is changed.
+ *
+ */
+class MergedSingleGramCache{
+private:
+    Bigram * m_system_bigram;
+    Bigram * m_user_bigram;
+    /* when set, load the system single grams from it instead. */
+    const MmapBigram * m_mmap_system_bigram;
+    size_t m_capacity;
+
+    /* Key: phrase_token_t, Value: GList * in m_lru. */
+    GHashTable * m_index;
+    /* Queue of merged_single_gram_item_t *,
+       the recently used item first. */
+    GQueue m_lru;
+
+    /* no copy. */
+    MergedSingleGramCache(const MergedSingleGramCache & other);
+    MergedSingleGramCache & operator=(const MergedSingleGramCache & other);
+
+public:
+    /**
+     * MergedSingleGramCache::MergedSingleGramCache:
+     * @system_bigram: the system bi-gram.
+     * @user_bigram: the user bi-gram.
+     * @capacity: the maximum number of the cached single grams.
+     *
+     * The constructor of the MergedSingleGramCache.
+     *
+     */
+    MergedSingleGramCache(Bigram * system_bigram, Bigram * user_bigram,
+                          size_t capacity = 256);
+
+    /**
+     * MergedSingleGramCache::~MergedSingleGramCache:
+     *
+     * The destructor of the MergedSingleGramCache.
+     *
+     */
+    ~MergedSingleGramCache();
+
+    /**
+     * MergedSingleGramCache::set_mmap_system_bigram:
+     * @mmap_bigram: the read-only system bi-gram, or NULL.
+     * @returns: whether the set operation is successful.
+     *
+     * Use the read-only system bi-gram instead of the system bi-gram,
+     * the system single grams are not copied before merging.
+     *
+     */
+    bool set_mmap_system_bigram(const MmapBigram * mmap_bigram);
+
+    /**
+     * MergedSingleGramCache::get_capacity:
+     * @returns: the maximum number of the cached single grams.
+     *
+     * Get the capacity of the cache, the merged single grams of
+     * the last capacity loads of the different tokens are all valid.
+     *
+     */
+    size_t get_capacity() const {
+        return m_capacity;
+    }
+
+    /**
+     * MergedSingleGramCache::load:
+     * @index: the previous token in the bi-gram.
+     * @merged: the merged single gram of the previous token.
+     * @returns: whether the single gram exists.
+     *
+     * Load the merged single gram from the cache or the bi-grams.
+     *
+     * Note: the merged single gram is owned by the cache, and is valid
+     *   until it is evicted by the loads of capacity other tokens,
+     *   or removed by the invalidate or clear call. One expansion step
+     *   loads at most capacity tokens, so they stay valid in the step.
+     *
+     */
+    bool load(/* in */ phrase_token_t index,
+              /* out */ const SingleGram * & merged);
+
+    /**
+     * MergedSingleGramCache::invalidate:
+     * @index: the previous token in the bi-gram.
+     * @returns: whether the single gram was cached.
+     *
+     * Remove the merged single gram of the previous token.
+     *
+     */
+    bool invalidate(/* in */ phrase_token_t index);
+
+    /**
+     * MergedSingleGramCache::clear:
+     * @returns: whether the clear operation is successful.
+     *
+     * Remove all merged single grams.
+     *
+     */
+    bool clear();
+};
+
 };
 
 #endif
@@ -42,6 +42,8 @@ void Bigram::reset(){
         m_db->close(m_db, 0);
         m_db = NULL;
     }
+
+    m_filter.disable();
 }
 
 bool Bigram::load_db(const char * dbfile){
@@ -52,7 +54,7 @@ bool Bigram::load_db(const char * dbfile){
     assert(ret == 0);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_HASH, DB_CREATE, 0600);
+                     DB_HASH, DB_CREATE | DB_THREAD, 0600);
     if ( ret != 0 )
         return false;
 
@@ -66,16 +68,19 @@ bool Bigram::load_db(const char * dbfile){
 
     ret = tmp_db->open(tmp_db, NULL, dbfile, NULL,
                        DB_HASH, DB_RDONLY, 0600);
-    if ( ret != 0 )
+    if ( ret != 0 ) {
+        /* the empty db is still used. */
+        init_filter();
         return false;
+    }
 
-    if ( !copy_bdb(tmp_db, m_db) )
-        return false;
+    bool retval = copy_bdb(tmp_db, m_db);
 
     if ( tmp_db != NULL )
         tmp_db->close(tmp_db, 0);
 
-    return true;
+    init_filter();
+    return retval;
 }
 
 bool Bigram::save_db(const char * dbfile){
@@ -109,7 +114,7 @@ bool Bigram::save_db(const char * dbfile){
 
 bool Bigram::attach(const char * dbfile, guint32 flags){
     reset();
-    u_int32_t db_flags = attach_options(flags);
+    u_int32_t db_flags = attach_thread_options(flags);
 
     if ( !dbfile )
         return false;
@@ -121,6 +126,7 @@ bool Bigram::attach(const char * dbfile, guint32 flags){
     if ( ret != 0)
         return false;
 
+    init_filter();
     return true;
 }
 
@@ -130,18 +136,26 @@ bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
     if ( !m_db )
         return false;
 
+    /* skip the DBM lookup of the absent previous token. */
+    if (!m_filter.may_contain(&index, sizeof(phrase_token_t)))
+        return false;
+
     DBT db_key;
     memset(&db_key, 0, sizeof(DBT));
     db_key.data = &index;
     db_key.size = sizeof(phrase_token_t);
 
+    /* let Berkeley DB malloc the returned data,
+       the internal buffer of the DB handle is shared by all readers. */
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
     if ( ret != 0 )
         return false;
 
-    single_gram = new SingleGram(db_data.data, db_data.size, copy);
+    single_gram = new SingleGram(db_data.data, db_data.size, true);
+    free(db_data.data);
     return true;
 }
 
@@ -159,7 +173,14 @@ bool Bigram::store(phrase_token_t index, SingleGram * single_gram){
     db_data.size = single_gram->m_chunk.size();
     
     int ret = m_db->put(m_db, NULL, &db_key, &db_data, 0);
-    return ret == 0;
+    if ( ret != 0 )
+        return false;
+
+    /* re-build the saturated filter with the current keys. */
+    if (m_filter.is_enabled() &&
+        !m_filter.add(&index, sizeof(phrase_token_t)))
+        init_filter();
+    return true;
 }
 
 bool Bigram::remove(/* in */ phrase_token_t index){
@@ -190,19 +211,17 @@ bool Bigram::get_all_items(GArray * items){
     if (NULL == cursorp)
         return false;
 
-    /* Initialize our DBTs. */
+    /* Initialize our DBTs, only the keys are retrieved. */
     memset(&key, 0, sizeof(DBT));
     memset(&data, 0, sizeof(DBT));
+    key.flags = DB_DBT_REALLOC;
+    data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
 	
     /* Iterate over the database, retrieving each record in turn. */
     while ((ret = cursorp->c_get(cursorp, &key, &data, DB_NEXT)) == 0) {
         assert(key.size == sizeof(phrase_token_t));
         phrase_token_t * token = (phrase_token_t *)key.data;
         g_array_append_val(items, *token);
-
-        /* Initialize our DBTs. */
-        memset(&key, 0, sizeof(DBT));
-        memset(&data, 0, sizeof(DBT));
     }
 
     assert (ret == DB_NOTFOUND);
@@ -210,6 +229,7 @@ bool Bigram::get_all_items(GArray * items){
     /* Cursors must be closed */
     if (cursorp != NULL) 
         cursorp->c_close(cursorp); 
+    free(key.data);
 
     return true;
 }
@@ -22,6 +22,7 @@
 #define NGRAM_BDB_H
 
 #include <db.h>
+#include "bloom_filter.h"
 
 namespace pinyin{
 
@@ -37,7 +38,11 @@ class Bigram{
 private:
     DB * m_db;
 
+    /* the filter of the previous tokens. */
+    BloomFilter m_filter;
+
     void reset();
+    bool init_filter();
 
 public:
     /**
@@ -96,6 +101,10 @@ public:
      *
      * Load the single gram of the previous token.
      *
+     * Note: the single gram always owns its content now,
+     *   and the DB handle is opened with DB_THREAD,
+     *   so concurrent readers are safe when no writer is active.
+     *
      */
     bool load(/* in */ phrase_token_t index,
               /* out */ SingleGram * & single_gram, bool copy=false);
@@ -142,6 +151,18 @@ public:
      *
      */
     bool mask_out(phrase_token_t mask, phrase_token_t value);
+
+    /**
+     * Bigram::get_filter_rejects:
+     * @returns: the number of rejected lookups.
+     *
+     * Get the number of the single gram loads skipped by the filter
+     *   of the previous tokens.
+     *
+     */
+    guint32 get_filter_rejects() const {
+        return m_filter.get_rejects();
+    }
 };
 
 };
@@ -47,6 +47,8 @@ void Bigram::reset(){
         delete m_db;
         m_db = NULL;
     }
+
+    m_filter.disable();
 }
 
 
@@ -60,8 +62,11 @@ bool Bigram::load_db(const char * dbfile){
     if ( !m_db->open("-", BasicDB::OREADER|BasicDB::OWRITER|BasicDB::OCREATE) )
         return false;
 
-    if (!m_db->load_snapshot(dbfile, NULL))
+    if (!m_db->load_snapshot(dbfile, NULL)) {
+        /* the empty db is still used. */
+        init_filter();
         return false;
+    }
 
 #if 0
     /* load db into memory. */
@@ -76,6 +81,7 @@ bool Bigram::load_db(const char * dbfile){
     delete tmp_db;
 #endif
 
+    init_filter();
     return true;
 }
 
@@ -116,29 +122,43 @@ bool Bigram::attach(const char * dbfile, guint32 flags){
 
     m_db = new HashDB;
 
-    return m_db->open(dbfile, mode);
+    if (!m_db->open(dbfile, mode))
+        return false;
+
+    init_filter();
+    return true;
 }
 
-/* Use DB interface, first check, second reserve the memory chunk,
-   third get value into the chunk. */
+/* Use DB interface, first check, second reserve the memory chunk
+   of the returned single gram, third get value into the chunk.
+   No member is touched here, so concurrent readers are safe. */
 bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
                   bool copy){
     single_gram = NULL;
     if ( !m_db )
         return false;
 
+    /* skip the DBM lookup of the absent previous token. */
+    if (!m_filter.may_contain(&index, sizeof(phrase_token_t)))
+        return false;
+
     const char * kbuf = (char *) &index;
     const int32_t vsiz = m_db->check(kbuf, sizeof(phrase_token_t));
     /* -1 on failure. */
     if (-1 == vsiz)
         return false;
 
-    m_chunk.set_size(vsiz);
-    char * vbuf = (char *) m_chunk.begin();
-    check_result (vsiz == m_db->get(kbuf, sizeof(phrase_token_t),
-                              vbuf, vsiz));
+    /* the single gram always owns the memory chunk. */
+    SingleGram * gram = new SingleGram;
+    gram->m_chunk.set_size(vsiz);
+    char * vbuf = (char *) gram->m_chunk.begin();
+    if (vsiz != m_db->get(kbuf, sizeof(phrase_token_t), vbuf, vsiz)) {
+        /* the record is removed or resized by a writer. */
+        delete gram;
+        return false;
+    }
 
-    single_gram = new SingleGram(m_chunk.begin(), vsiz, copy);
+    single_gram = gram;
     return true;
 }
 
@@ -149,7 +169,14 @@ bool Bigram::store(phrase_token_t index, SingleGram * single_gram){
     const char * kbuf = (char *) &index;
     char * vbuf = (char *) single_gram->m_chunk.begin();
     size_t vsiz = single_gram->m_chunk.size();
-    return m_db->set(kbuf, sizeof(phrase_token_t), vbuf, vsiz);
+    if (!m_db->set(kbuf, sizeof(phrase_token_t), vbuf, vsiz))
+        return false;
+
+    /* re-build the saturated filter with the current keys. */
+    if (m_filter.is_enabled() &&
+        !m_filter.add(&index, sizeof(phrase_token_t)))
+        init_filter();
+    return true;
 }
 
 bool Bigram::remove(/* in */ phrase_token_t index){
@@ -23,6 +23,7 @@
 
 #include <kcdb.h>
 #include "memory_chunk.h"
+#include "bloom_filter.h"
 
 namespace pinyin{
 
@@ -38,10 +39,11 @@ class Bigram{
 private:
     kyotocabinet::BasicDB * m_db;
 
-    /* memory chunk for Kyoto Cabinet. */
-    MemoryChunk m_chunk;
+    /* the filter of the previous tokens. */
+    BloomFilter m_filter;
 
     void reset();
+    bool init_filter();
 
 public:
     /**
@@ -100,6 +102,9 @@ public:
      *
      * Load the single gram of the previous token.
      *
+     * Note: the single gram always owns its content now,
+     *   so concurrent readers are safe when no writer is active.
+     *
      */
     bool load(/* in */ phrase_token_t index,
               /* out */ SingleGram * & single_gram,
@@ -147,6 +152,18 @@ public:
      *
      */
     bool mask_out(phrase_token_t mask, phrase_token_t value);
+
+    /**
+     * Bigram::get_filter_rejects:
+     * @returns: the number of rejected lookups.
+     *
+     * Get the number of the single gram loads skipped by the filter
+     *   of the previous tokens.
+     *
+     */
+    guint32 get_filter_rejects() const {
+        return m_filter.get_rejects();
+    }
 };
 
 };
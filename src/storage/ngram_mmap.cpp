@@ -0,0 +1,204 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ngram_mmap.h"
+#include <assert.h>
+#include "ngram.h"
+
+using namespace pinyin;
+
+static gint compare_token(gconstpointer lhs, gconstpointer rhs) {
+    phrase_token_t token_lhs = *((const phrase_token_t *) lhs);
+    phrase_token_t token_rhs = *((const phrase_token_t *) rhs);
+    if (token_lhs < token_rhs)
+        return -1;
+    if (token_lhs > token_rhs)
+        return 1;
+    return 0;
+}
+
+MmapBigram::MmapBigram(){
+    m_begin = NULL;
+    m_end = NULL;
+}
+
+MmapBigram::~MmapBigram(){
+    reset();
+}
+
+void MmapBigram::reset(){
+    /* release the mapping. */
+    m_chunk.set_chunk(NULL, 0, NULL);
+    m_begin = NULL;
+    m_end = NULL;
+}
+
+bool MmapBigram::attach(const char * filename){
+    reset();
+
+#ifdef LIBPINYIN_USE_MMAP
+    if (!m_chunk.mmap(filename)) {
+        reset();
+        return false;
+    }
+#else
+    if (!m_chunk.load(filename)) {
+        reset();
+        return false;
+    }
+#endif
+
+    const size_t size = m_chunk.size();
+    if (size < sizeof(guint32)) {
+        reset();
+        return false;
+    }
+
+    /* check the number before the multiplication wraps around. */
+    const guint32 num = m_chunk.get_content<guint32>(0);
+    if (num > (size - sizeof(guint32)) / sizeof(mmap_bigram_index_item_t)) {
+        reset();
+        return false;
+    }
+    const size_t directory_end = sizeof(guint32) +
+        num * sizeof(mmap_bigram_index_item_t);
+
+    m_begin = (const mmap_bigram_index_item_t *)
+        ((const char *) m_chunk.begin() + sizeof(guint32));
+    m_end = m_begin + num;
+
+    /* validate the directory, find() needs the sorted tokens. */
+    for (const mmap_bigram_index_item_t * item = m_begin;
+         item < m_end; ++item) {
+        if (item > m_begin && item->m_token <= (item - 1)->m_token) {
+            reset();
+            return false;
+        }
+
+        /* compare without adding the guint32 offset and length,
+           the sum may wrap around. */
+        if (item->m_offset < directory_end ||
+            item->m_offset > size ||
+            item->m_length > size - item->m_offset ||
+            item->m_length < sizeof(guint32)) {
+            reset();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const mmap_bigram_index_item_t * MmapBigram::find(phrase_token_t index)
+    const {
+    const mmap_bigram_index_item_t * begin = m_begin, * end = m_end;
+
+    /* binary search. */
+    while (begin < end) {
+        const mmap_bigram_index_item_t * middle = begin + (end - begin) / 2;
+        if (middle->m_token < index)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    if (begin == m_end || begin->m_token != index)
+        return NULL;
+
+    return begin;
+}
+
+bool MmapBigram::load(phrase_token_t index, SingleGram * & single_gram,
+                      bool copy) const {
+    single_gram = NULL;
+
+    const mmap_bigram_index_item_t * item = find(index);
+    if (NULL == item)
+        return false;
+
+    char * data = (char *) m_chunk.begin() + item->m_offset;
+    single_gram = new SingleGram(data, item->m_length, copy);
+    return true;
+}
+
+bool MmapBigram::load_view(phrase_token_t index,
+                           SingleGram & single_gram) const {
+    const mmap_bigram_index_item_t * item = find(index);
+    if (NULL == item)
+        return false;
+
+    char * data = (char *) m_chunk.begin() + item->m_offset;
+    single_gram.m_chunk.set_chunk(data, item->m_length, NULL);
+    return true;
+}
+
+bool MmapBigram::get_all_items(GArray * items) const {
+    g_array_set_size(items, 0);
+
+    for (const mmap_bigram_index_item_t * item = m_begin;
+         item < m_end; ++item)
+        g_array_append_val(items, item->m_token);
+
+    return true;
+}
+
+bool MmapBigram::save(Bigram * bigram, const char * filename){
+    GArray * items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    bigram->get_all_items(items);
+    g_array_sort(items, compare_token);
+
+    MemoryChunk chunk;
+    const guint32 num = items->len;
+    chunk.set_content(0, &num, sizeof(guint32));
+
+    /* the single grams follow the directory. */
+    guint32 offset = sizeof(guint32) +
+        num * sizeof(mmap_bigram_index_item_t);
+    chunk.set_size(offset);
+
+    for (size_t i = 0; i < items->len; ++i) {
+        phrase_token_t token = g_array_index(items, phrase_token_t, i);
+
+        SingleGram * single_gram = NULL;
+        if (!bigram->load(token, single_gram, true)) {
+            g_array_free(items, TRUE);
+            return false;
+        }
+
+        const MemoryChunk & content = single_gram->m_chunk;
+
+        mmap_bigram_index_item_t item;
+        item.m_token = token;
+        item.m_offset = offset;
+        item.m_length = content.size();
+        chunk.set_content(sizeof(guint32) +
+                          i * sizeof(mmap_bigram_index_item_t),
+                          &item, sizeof(mmap_bigram_index_item_t));
+
+        chunk.set_content(offset, content.begin(), content.size());
+        offset += content.size();
+
+        delete single_gram;
+    }
+
+    g_array_free(items, TRUE);
+
+    return chunk.save(filename);
+}
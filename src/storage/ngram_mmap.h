@@ -0,0 +1,146 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NGRAM_MMAP_H
+#define NGRAM_MMAP_H
+
+#include <glib.h>
+#include "novel_types.h"
+#include "memory_chunk.h"
+
+namespace pinyin{
+
+class SingleGram;
+class Bigram;
+
+/** Note:
+ *  The file layout of the read-only bi-gram:
+ *    guint32 the number of single grams;
+ *    the sorted directory of mmap_bigram_index_item_t;
+ *    the contiguous single grams, each is the total freq and
+ *      the sorted array of SingleGramItem, same as SingleGram.
+ */
+
+struct mmap_bigram_index_item_t{
+    phrase_token_t m_token;
+    /* the offset of the single gram in the chunk. */
+    guint32 m_offset;
+    /* the length of the single gram in bytes. */
+    guint32 m_length;
+};
+
+/**
+ * MmapBigram:
+ *
+ * The read-only bi-gram, which is memory mapped from one file.
+ *
+ */
+class MmapBigram{
+private:
+    MemoryChunk m_chunk;
+
+    const mmap_bigram_index_item_t * m_begin;
+    const mmap_bigram_index_item_t * m_end;
+
+    void reset();
+
+    const mmap_bigram_index_item_t * find(phrase_token_t index) const;
+
+public:
+    /**
+     * MmapBigram::MmapBigram:
+     *
+     * The constructor of the MmapBigram.
+     *
+     */
+    MmapBigram();
+
+    /**
+     * MmapBigram::~MmapBigram:
+     *
+     * The destructor of the MmapBigram.
+     *
+     */
+    ~MmapBigram();
+
+    /**
+     * MmapBigram::attach:
+     * @filename: the read-only bi-gram file.
+     * @returns: whether the attach operation is successful.
+     *
+     * Map the read-only bi-gram file.
+     *
+     */
+    bool attach(const char * filename);
+
+    /**
+     * MmapBigram::load:
+     * @index: the previous token in the bi-gram.
+     * @single_gram: the single gram of the previous token.
+     * @copy: whether copy the content of the single gram.
+     * @returns: whether the load operation is successful.
+     *
+     * Load the single gram of the previous token,
+     * the single gram points into the mapping when not copied.
+     *
+     */
+    bool load(/* in */ phrase_token_t index,
+              /* out */ SingleGram * & single_gram,
+              bool copy=false) const;
+
+    /**
+     * MmapBigram::load_view:
+     * @index: the previous token in the bi-gram.
+     * @single_gram: the single gram to point into the mapping.
+     * @returns: whether the single gram exists.
+     *
+     * Point the single gram into the mapping without any allocation.
+     *
+     * Note: the single gram must not be modified.
+     *
+     */
+    bool load_view(/* in */ phrase_token_t index,
+                   /* out */ SingleGram & single_gram) const;
+
+    /**
+     * MmapBigram::get_all_items:
+     * @items: the GArray to store all previous tokens.
+     * @returns: whether the get operation is successful.
+     *
+     * Get the array of all previous tokens for parameter estimation.
+     *
+     */
+    bool get_all_items(/* out */ GArray * items) const;
+
+    /**
+     * MmapBigram::save:
+     * @bigram: the bi-gram to be saved.
+     * @filename: the read-only bi-gram file.
+     * @returns: whether the save operation is successful.
+     *
+     * Save the bi-gram into the read-only bi-gram file.
+     *
+     */
+    static bool save(Bigram * bigram, const char * filename);
+};
+
+};
+
+#endif
@@ -43,6 +43,8 @@ void Bigram::reset(){
         delete m_db;
         m_db = NULL;
     }
+
+    m_filter.disable();
 }
 
 bool Bigram::load_db(const char * dbfile){
@@ -52,13 +54,17 @@ bool Bigram::load_db(const char * dbfile){
     m_db = new TinyDBM;
 
     HashDBM tmp_db;
-    if (tmp_db.Open(dbfile, false, File::OPEN_NO_CREATE) != Status::SUCCESS)
+    if (tmp_db.Open(dbfile, false, File::OPEN_NO_CREATE) != Status::SUCCESS) {
+        /* the empty db is still used. */
+        init_filter();
         return false;
+    }
 
     copy_tkrzwdb(&tmp_db, m_db);
 
     tmp_db.Close();
 
+    init_filter();
     return true;
 }
 
@@ -95,7 +101,11 @@ bool Bigram::attach(const char * dbfile, guint32 flags){
 
     m_db = new HashDBM;
 
-    return m_db->Open(dbfile, writable, options).IsOK();
+    if (!m_db->Open(dbfile, writable, options).IsOK())
+        return false;
+
+    init_filter();
+    return true;
 }
 
 /* Use DB interface. */
@@ -105,6 +115,10 @@ bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
     if ( !m_db )
         return false;
 
+    /* skip the DBM lookup of the absent previous token. */
+    if (!m_filter.may_contain(&index, sizeof(phrase_token_t)))
+        return false;
+
     std::string_view key(reinterpret_cast<const char*>(&index), sizeof(phrase_token_t));
     std::string value;
 
@@ -113,11 +127,9 @@ bool Bigram::load(phrase_token_t index, SingleGram * & single_gram,
     if (!status.IsOK())
         return false;
 
-    size_t vsiz = value.size();
-    m_chunk.set_size(vsiz);
-    memcpy(m_chunk.begin(), value.data(), vsiz);
-
-    single_gram = new SingleGram(m_chunk.begin(), vsiz, copy);
+    /* the single gram always owns the memory chunk,
+       no member is touched here. */
+    single_gram = new SingleGram((void *) value.data(), value.size(), true);
     return true;
 }
 
@@ -129,7 +141,14 @@ bool Bigram::store(phrase_token_t index, SingleGram * single_gram){
     std::string_view value(reinterpret_cast<const char*>(single_gram->m_chunk.begin()),
                            single_gram->m_chunk.size());
 
-    return m_db->Set(key, value).IsOK();
+    if (!m_db->Set(key, value).IsOK())
+        return false;
+
+    /* re-build the saturated filter with the current keys. */
+    if (m_filter.is_enabled() &&
+        !m_filter.add(&index, sizeof(phrase_token_t)))
+        init_filter();
+    return true;
 }
 
 bool Bigram::remove(/* in */ phrase_token_t index){
@@ -37,53 +37,62 @@ bool fill_matrix(PhoneticKeyMatrix * matrix,
     if (0 == keys->len)
         return false;
 
-    const ChewingKey * key = NULL;
-    const ChewingKeyRest * key_rest = NULL;
-
-    /* last key rest. */
-    key_rest = &g_array_index(key_rests, ChewingKeyRest, key_rests->len - 1);
+    const ChewingKey zero_key;
+    ChewingKeyRest zero_key_rest;
 
     /* one extra slot for the last key. */
     size_t length = parsed_len + 1;
-    matrix->set_size(length);
-
-    /* fill keys and key rests. */
-    size_t i;
-    for (i = 0; i < keys->len; ++i) {
-        key = &g_array_index(keys, ChewingKey, i);
-        key_rest = &g_array_index(key_rests, ChewingKeyRest, i);
-        matrix->append(key_rest->m_raw_begin, *key, *key_rest);
-    }
 
-    const ChewingKey zero_key;
-    ChewingKeyRest zero_key_rest;
-    /* fill zero keys for the last key. */
-    zero_key_rest.m_raw_begin = length - 1;
-    zero_key_rest.m_raw_end = length;
-    matrix->append(length - 1, zero_key, zero_key_rest);
-
-    /* append the last key to key_rests. */
-    g_array_append_val(key_rests, zero_key_rest);
-
-    /* fill zero keys for "'". */
-    ChewingKeyRest * next_key_rest = NULL;
-    for (i = 0; i < key_rests->len - 1; ++i) {
-        key_rest = &g_array_index(key_rests, ChewingKeyRest, i);
-        next_key_rest = &g_array_index(key_rests, ChewingKeyRest, i + 1);
-
-        for (size_t fill = key_rest->m_raw_end;
-             fill < next_key_rest->m_raw_begin; ++fill) {
-            zero_key_rest.m_raw_begin = fill;
-            zero_key_rest.m_raw_end = fill + 1;
-            matrix->append(fill, zero_key, zero_key_rest);
+    /* the keys are sorted by the raw begin,
+       so the columns are built one by one. */
+    matrix->begin_build();
+
+    size_t i = 0;
+    /* the raw end of the previous key, -1 before the first key. */
+    gint last_end = -1;
+    for (size_t index = 0; index < length; ++index) {
+        matrix->add_column();
+
+        /* fill keys and key rests. */
+        const size_t first = i;
+        for (; i < keys->len; ++i) {
+            const ChewingKeyRest * key_rest =
+                &g_array_index(key_rests, ChewingKeyRest, i);
+            if (index != key_rest->m_raw_begin)
+                break;
+
+            matrix->add_item(g_array_index(keys, ChewingKey, i), *key_rest);
+            last_end = key_rest->m_raw_end;
+        }
+
+        /* fill zero keys for the last key. */
+        if (length - 1 == index) {
+            zero_key_rest.m_raw_begin = length - 1;
+            zero_key_rest.m_raw_end = length;
+            matrix->add_item(zero_key, zero_key_rest);
+            continue;
+        }
+
+        /* fill zero keys for "'" between the keys. */
+        if (first == i && -1 != last_end && (gint) index >= last_end) {
+            zero_key_rest.m_raw_begin = index;
+            zero_key_rest.m_raw_end = index + 1;
+            matrix->add_item(zero_key, zero_key_rest);
         }
     }
 
-    /* remove the last key from key_rests. */
-    g_array_set_size(key_rests, key_rests->len - 1);
+    /* all the keys are in the parsed input. */
+    assert(keys->len == i);
+
+    matrix->end_build();
     return true;
 }
 
+/* Note: the steps only append keys to the current column and the columns
+   after it, the keys of the current column are added to the built column,
+   and the keys of the columns after it are appended to the matrix,
+   which are built when their columns are reached. */
+
 bool resplit_step(pinyin_option_t options,
                   PhoneticKeyMatrix * matrix) {
     if (!(options & USE_RESPLIT_TABLE))
@@ -93,34 +102,35 @@ bool resplit_step(pinyin_option_t options,
     if (0 == length)
         return false;
 
-    GArray * keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    GArray * key_rests = g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+    matrix->begin_build();
+
+    ChewingKey key, next_key;
+    ChewingKeyRest key_rest, next_key_rest;
+
+    for (size_t index = 0; index < length; ++index) {
+        matrix->add_column();
 
-    GArray * next_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    GArray * next_key_rests = g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+        const ChewingKey * keys = NULL;
+        const ChewingKeyRest * key_rests = NULL;
+        const size_t size = matrix->get_column(index, keys, key_rests);
+        matrix->add_items(keys, key_rests, size);
 
-    /* skip the last column */
-    for (size_t index = 0; index < length - 1; ++index) {
-        matrix->get_items(index, keys, key_rests);
-        if (0 == keys->len)
+        /* skip the last column */
+        if (length - 1 == index)
             continue;
 
-        for (size_t i = 0; i < keys->len; ++i) {
-            const ChewingKey key = g_array_index(keys, ChewingKey, i);
-            const ChewingKeyRest key_rest = g_array_index(key_rests,
-                                                      ChewingKeyRest, i);
+        /* the appended keys may move the column, use get_item here. */
+        for (size_t i = 0; i < size; ++i) {
+            matrix->get_item(index, i, key, key_rest);
 
             size_t midindex = key_rest.m_raw_end;
-            matrix->get_items(midindex, next_keys, next_key_rests);
-            assert(next_keys->len == next_key_rests->len);
-            if (0 == next_keys->len)
+            if (midindex >= length)
                 continue;
 
-            for (size_t j = 0; j < next_keys->len; ++j) {
-                const ChewingKey next_key = g_array_index
-                    (next_keys, ChewingKey, j);
-                const ChewingKeyRest next_key_rest = g_array_index
-                    (next_key_rests, ChewingKeyRest, j);
+            /* the keys appended to the next column are skipped. */
+            const size_t next_size = matrix->get_column_size(midindex);
+            for (size_t j = 0; j < next_size; ++j) {
+                matrix->get_item(midindex, j, next_key, next_key_rest);
 
                 /* lookup resplit table */
                 size_t k;
@@ -143,11 +153,12 @@ bool resplit_step(pinyin_option_t options,
                     item = resplit_table + k;
 
                     size_t newindex = index + strlen(item->m_new_keys[0]);
+                    assert(newindex > index);
 
                     ChewingKey newkey = item->m_new_structs[0];
                     ChewingKeyRest newkeyrest = key_rest;
                     newkeyrest.m_raw_end = newindex;
-                    matrix->append(index, newkey, newkeyrest);
+                    matrix->add_item(newkey, newkeyrest);
 
                     newkey = item->m_new_structs[1];
                     newkeyrest = next_key_rest;
@@ -158,11 +169,7 @@ bool resplit_step(pinyin_option_t options,
         }
     }
 
-    g_array_free(next_keys, TRUE);
-    g_array_free(next_key_rests, TRUE);
-
-    g_array_free(keys, TRUE);
-    g_array_free(key_rests, TRUE);
+    matrix->end_build();
     return true;
 }
 
@@ -175,18 +182,21 @@ bool inner_split_step(pinyin_option_t options,
     if (0 == length)
         return false;
 
-    GArray * keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    GArray * key_rests = g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+    matrix->begin_build();
+
+    ChewingKey key; ChewingKeyRest key_rest;
 
     for (size_t index = 0; index < length; ++index) {
-        matrix->get_items(index, keys, key_rests);
-        if (0 ==  keys->len)
-            continue;
+        matrix->add_column();
+
+        const ChewingKey * keys = NULL;
+        const ChewingKeyRest * key_rests = NULL;
+        const size_t size = matrix->get_column(index, keys, key_rests);
+        matrix->add_items(keys, key_rests, size);
 
-        for (size_t i = 0; i < keys->len; ++i) {
-            const ChewingKey key = g_array_index(keys, ChewingKey, i);
-            const ChewingKeyRest key_rest = g_array_index(key_rests,
-                                                          ChewingKeyRest, i);
+        /* the appended keys may move the column, use get_item here. */
+        for (size_t i = 0; i < size; ++i) {
+            matrix->get_item(index, i, key, key_rest);
 
             /* lookup divided table */
             size_t k;
@@ -204,11 +214,12 @@ bool inner_split_step(pinyin_option_t options,
                 item = divided_table + k;
 
                 size_t newindex = index + strlen(item->m_new_keys[0]);
+                assert(newindex > index);
 
                 ChewingKey newkey = item->m_new_structs[0];
                 ChewingKeyRest newkeyrest = key_rest;
                 newkeyrest.m_raw_end = newindex;
-                matrix->append(index, newkey, newkeyrest);
+                matrix->add_item(newkey, newkeyrest);
 
                 newkey = item->m_new_structs[1];
                 newkeyrest = key_rest;
@@ -218,8 +229,7 @@ bool inner_split_step(pinyin_option_t options,
         }
     }
 
-    g_array_free(keys, TRUE);
-    g_array_free(key_rests, TRUE);
+    matrix->end_build();
     return true;
 }
 
@@ -232,20 +242,28 @@ bool fuzzy_syllable_step(pinyin_option_t options,
     if (0 == length)
         return false;
 
-    GArray * keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    GArray * key_rests = g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
+    matrix->set_fuzzy_options(options);
+
+    /* the fuzzy keys are only appended to the current column. */
+    matrix->begin_build();
+
+    ChewingKey key; ChewingKeyRest key_rest;
 
     for (size_t index = 0; index < length; ++index) {
-        /* for pinyin initials. */
-        matrix->get_items(index, keys, key_rests);
-        if (0 == keys->len)
+        matrix->add_column();
+
+        const ChewingKey * keys = NULL;
+        const ChewingKeyRest * key_rests = NULL;
+        const size_t size = matrix->get_column(index, keys, key_rests);
+        if (0 == size)
             continue;
 
+        matrix->add_items(keys, key_rests, size);
+
+        /* for pinyin initials. */
         size_t i = 0;
-        for (i = 0; i < keys->len; ++i) {
-            const ChewingKey key = g_array_index(keys, ChewingKey, i);
-            const ChewingKeyRest key_rest = g_array_index(key_rests,
-                                                          ChewingKeyRest, i);
+        for (i = 0; i < size; ++i) {
+            key = keys[i]; key_rest = key_rests[i];
 
 #define MATCH(AMBIGUITY, ORIGIN, ANOTHER) do {                          \
                 if (options & AMBIGUITY) {                              \
@@ -253,7 +271,7 @@ bool fuzzy_syllable_step(pinyin_option_t options,
                         ChewingKey newkey = key;                        \
                         newkey.m_initial = ANOTHER;                     \
                         if (0 != newkey.get_table_index())              \
-                            matrix->append(index, newkey, key_rest);    \
+                            matrix->add_item(newkey, key_rest);         \
                     }                                                   \
                 }                                                       \
             } while (0)
@@ -278,21 +296,19 @@ bool fuzzy_syllable_step(pinyin_option_t options,
 
         }
 
-        /* for pinyin finals. */
-        matrix->get_items(index, keys, key_rests);
-        assert(0 != keys->len);
+        /* for pinyin finals, with the above fuzzy keys. */
+        const size_t built_size = matrix->get_built_column_size();
+        assert(0 != built_size);
 
-        for (i = 0; i < keys->len; ++i) {
-            const ChewingKey key = g_array_index(keys, ChewingKey, i);
-            const ChewingKeyRest key_rest = g_array_index(key_rests,
-                                                          ChewingKeyRest, i);
+        for (i = 0; i < built_size; ++i) {
+            matrix->get_built_item(i, key, key_rest);
 
 #define MATCH(AMBIGUITY, ORIGIN, ANOTHER) do {                     \
                 if (options & AMBIGUITY) {                         \
                     if (ORIGIN == key.m_final) {                   \
                         ChewingKey newkey = key;                   \
                         newkey.m_final = ANOTHER;                  \
-                        matrix->append(index, newkey, key_rest);   \
+                        matrix->add_item(newkey, key_rest);        \
                     }                                              \
                 }                                                  \
             } while (0)
@@ -310,29 +326,145 @@ bool fuzzy_syllable_step(pinyin_option_t options,
         }
     }
 
-    g_array_free(keys, TRUE);
-    g_array_free(key_rests, TRUE);
+    matrix->end_build();
+    return true;
+}
+
+/* whether the column of the two matrices are the same. */
+static bool equal_column(const PhoneticKeyMatrix * lhs,
+                         const PhoneticKeyMatrix * rhs,
+                         size_t index) {
+    const ChewingKey * lhs_keys = NULL, * rhs_keys = NULL;
+    const ChewingKeyRest * lhs_key_rests = NULL, * rhs_key_rests = NULL;
+
+    const size_t size = lhs->get_column(index, lhs_keys, lhs_key_rests);
+    if (size != rhs->get_column(index, rhs_keys, rhs_key_rests))
+        return false;
+
+    for (size_t i = 0; i < size; ++i) {
+        if (lhs_keys[i] != rhs_keys[i])
+            return false;
+
+        if (lhs_key_rests[i].m_raw_begin != rhs_key_rests[i].m_raw_begin ||
+            lhs_key_rests[i].m_raw_end != rhs_key_rests[i].m_raw_end)
+            return false;
+    }
+
     return true;
 }
 
+size_t refill_matrix(pinyin_option_t options,
+                     PhoneticKeyMatrix * matrix,
+                     ChewingKeyVector prev_keys,
+                     ChewingKeyRestVector prev_key_rests,
+                     ChewingKeyVector keys,
+                     ChewingKeyRestVector key_rests,
+                     size_t parsed_len) {
+    assert(prev_keys->len == prev_key_rests->len);
+    assert(keys->len == key_rests->len);
+
+    if (0 == keys->len) {
+        matrix->clear_all();
+        return 0;
+    }
+
+    /* find the first changed key. */
+    size_t changed = 0;
+    const size_t num = std_lite::min(prev_keys->len, keys->len);
+    for (; changed < num; ++changed) {
+        const ChewingKeyRest * prev_key_rest = &g_array_index
+            (prev_key_rests, ChewingKeyRest, changed);
+        const ChewingKeyRest * key_rest = &g_array_index
+            (key_rests, ChewingKeyRest, changed);
+
+        if (g_array_index(prev_keys, ChewingKey, changed) !=
+            g_array_index(keys, ChewingKey, changed))
+            break;
+
+        if (prev_key_rest->m_raw_begin != key_rest->m_raw_begin ||
+            prev_key_rest->m_raw_end != key_rest->m_raw_end)
+            break;
+    }
+
+    /* the keys before the changed key may be re-splitted with it,
+       and the re-splitted keys may be splitted again, so the columns
+       from the previous key of the changed key are re-filled by the
+       keys from two keys before it. */
+    size_t start = 0, first = 0;
+    if (changed >= 1 && matrix->size() > 0) {
+        start = g_array_index(key_rests, ChewingKeyRest,
+                              changed - 1).m_raw_begin;
+        first = changed >= 3 ? changed - 3 : 0;
+    }
+
+    ChewingKeyVector refill_keys = g_array_new
+        (TRUE, TRUE, sizeof(ChewingKey));
+    ChewingKeyRestVector refill_key_rests = g_array_new
+        (TRUE, TRUE, sizeof(ChewingKeyRest));
+    g_array_append_vals(refill_keys,
+                        &g_array_index(keys, ChewingKey, first),
+                        keys->len - first);
+    g_array_append_vals(refill_key_rests,
+                        &g_array_index(key_rests, ChewingKeyRest, first),
+                        key_rests->len - first);
+
+    /* the columns after start are the same as the full matrix. */
+    PhoneticKeyMatrix refilled;
+    fill_matrix(&refilled, refill_keys, refill_key_rests, parsed_len);
+    resplit_step(options, &refilled);
+    inner_split_step(options, &refilled);
+    fuzzy_syllable_step(options, &refilled);
+
+    g_array_free(refill_key_rests, TRUE);
+    g_array_free(refill_keys, TRUE);
+
+    /* the keys are searched with the different fuzzy options. */
+    if (matrix->get_fuzzy_options() != refilled.get_fuzzy_options())
+        start = 0;
+
+    /* keep the unchanged columns. */
+    const size_t length = refilled.size();
+    const size_t size = std_lite::min(length, matrix->size());
+    for (; start < size; ++start) {
+        if (!equal_column(matrix, &refilled, start))
+            break;
+    }
+
+    matrix->set_fuzzy_options(refilled.get_fuzzy_options());
+
+    /* build the unchanged columns and the re-filled columns. */
+    matrix->begin_build();
+    for (size_t index = 0; index < length; ++index) {
+        const PhoneticKeyMatrix * source = index < start ? matrix : &refilled;
+
+        const ChewingKey * column_keys = NULL;
+        const ChewingKeyRest * column_key_rests = NULL;
+        const size_t column_size = source->get_column
+            (index, column_keys, column_key_rests);
+
+        matrix->add_column();
+        matrix->add_items(column_keys, column_key_rests, column_size);
+    }
+    matrix->end_build();
+
+    return start;
+}
 
 bool dump_matrix(PhoneticKeyMatrix * matrix) {
     size_t length = matrix->size();
 
-    GArray * keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
-    GArray * key_rests = g_array_new(TRUE, TRUE, sizeof(ChewingKeyRest));
-
     for (size_t index = 0; index < length; ++index) {
-        matrix->get_items(index, keys, key_rests);
-        if (0 == keys->len)
+        const ChewingKey * keys = NULL;
+        const ChewingKeyRest * key_rests = NULL;
+        const size_t size = matrix->get_column(index, keys, key_rests);
+        if (0 == size)
             continue;
 
         printf("Column:%ld:\n", index);
 
-        for (size_t i = 0; i < keys->len; ++i) {
-            ChewingKey key = g_array_index(keys, ChewingKey, i);
-            ChewingKeyRest key_rest = g_array_index(key_rests,
-                                                    ChewingKeyRest, i);
+        for (size_t i = 0; i < size; ++i) {
+            ChewingKey key = keys[i];
+            ChewingKeyRest key_rest = key_rests[i];
 
             gchar * pinyin = key.get_pinyin_string();
             printf("ChewingKey:%s\n", pinyin);
@@ -342,11 +474,86 @@ bool dump_matrix(PhoneticKeyMatrix * matrix) {
         }
     }
 
-    g_array_free(keys, TRUE);
-    g_array_free(key_rests, TRUE);
     return true;
 }
 
+bool copy_matrix(PhoneticKeyMatrix * dest,
+                 const PhoneticKeyMatrix * src) {
+    const size_t length = src->size();
+    dest->set_fuzzy_options(src->get_fuzzy_options());
+
+    dest->begin_build();
+    for (size_t index = 0; index < length; ++index) {
+        const ChewingKey * keys = NULL;
+        const ChewingKeyRest * key_rests = NULL;
+        const size_t size = src->get_column(index, keys, key_rests);
+
+        dest->add_column();
+        dest->add_items(keys, key_rests, size);
+    }
+    dest->end_build();
+
+    return true;
+}
+
+size_t diff_matrix(const PhoneticKeyMatrix * lhs,
+                   const PhoneticKeyMatrix * rhs) {
+    const size_t length = std_lite::min(lhs->size(), rhs->size());
+
+    /* the keys are searched with the different fuzzy options. */
+    if (lhs->get_fuzzy_options() != rhs->get_fuzzy_options())
+        return 0;
+
+    for (size_t index = 0; index < length; ++index) {
+        if (!equal_column(lhs, rhs, index))
+            return index;
+    }
+
+    return length;
+}
+
+/* the fuzzy keys appended by fuzzy_syllable_step are matched by
+   the fuzzy search of the earlier key with the same end in the column,
+   returns the bit mask of the covered rows. */
+static guint64 compute_fuzzy_covered_rows(const PhoneticKeyMatrix * matrix,
+                                          size_t index) {
+    guint64 covered = 0;
+
+    const pinyin_option_t options = matrix->get_fuzzy_options();
+    if (!(options & PINYIN_AMB_ALL))
+        return covered;
+
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = std_lite::min
+        (matrix->get_column(index, keys, key_rests), (size_t) 64);
+
+    for (size_t row = 1; row < size; ++row) {
+        const ChewingKey * key = keys + row;
+        const bool incomplete = contains_incomplete_pinyin(key, 1);
+
+        for (size_t i = 0; i < row; ++i) {
+            if (covered & (G_GUINT64_CONSTANT(1) << i))
+                continue;
+
+            const ChewingKey * other_key = keys + i;
+            if (key_rests[i].m_raw_end != key_rests[row].m_raw_end)
+                continue;
+
+            /* the in-complete pinyin matches more phrases. */
+            if (incomplete != contains_incomplete_pinyin(other_key, 1))
+                continue;
+
+            if (pinyin_fuzzy_equal_with_tones(options, other_key, key, 1)) {
+                covered |= G_GUINT64_CONSTANT(1) << row;
+                break;
+            }
+        }
+    }
+
+    return covered;
+}
+
 int search_matrix_recur(GArray * cached_keys,
                         const FacadeChewingTable2 * table,
                         const PhoneticKeyMatrix * matrix,
@@ -369,19 +576,28 @@ int search_matrix_recur(GArray * cached_keys,
 #if 0
         printf("search table:%d\n", cached_keys->len);
 #endif
-        return table->search(cached_keys->len,
-                             (ChewingKey *)cached_keys->data, ranges);
+        /* search all the fuzzy pinyin keys in one lookup. */
+        return table->search_fuzzy(matrix->get_fuzzy_options(),
+                                   cached_keys->len,
+                                   (ChewingKey *)cached_keys->data, ranges);
     }
 
     int result = SEARCH_NONE;
 
-    const size_t size = matrix->get_column_size(start);
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = matrix->get_column(start, keys, key_rests);
     /* assume pinyin parsers will filter invalid keys. */
     assert(size > 0);
 
+    const guint64 covered = compute_fuzzy_covered_rows(matrix, start);
+
     for (size_t i = 0; i < size; ++i) {
-        ChewingKey key; ChewingKeyRest key_rest;
-        matrix->get_item(start, i, key, key_rest);
+        if (i < 64 && (covered & (G_GUINT64_CONSTANT(1) << i)))
+            continue;
+
+        const ChewingKey & key = keys[i];
+        const ChewingKeyRest & key_rest = key_rests[i];
 
         const size_t newstart = key_rest.m_raw_end;
 
@@ -437,6 +653,91 @@ int search_matrix(const FacadeChewingTable2 * table,
     return result;
 }
 
+static int search_matrix_all_recur(GArray * cached_keys,
+                                   const FacadeChewingTable2 * table,
+                                   const PhoneticKeyMatrix * matrix,
+                                   size_t start, size_t end,
+                                   MatrixSearchResults * results) {
+    int result = SEARCH_NONE;
+
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = matrix->get_column(start, keys, key_rests);
+    /* assume pinyin parsers will filter invalid keys. */
+    assert(size > 0);
+
+    const guint64 covered = compute_fuzzy_covered_rows(matrix, start);
+
+    for (size_t i = 0; i < size; ++i) {
+        if (i < 64 && (covered & (G_GUINT64_CONSTANT(1) << i)))
+            continue;
+
+        const ChewingKey & key = keys[i];
+        const ChewingKeyRest & key_rest = key_rests[i];
+
+        const size_t newstart = key_rest.m_raw_end;
+        if (newstart > end)
+            continue;
+
+        const ChewingKey zero_key;
+        if (zero_key == key) {
+            /* assume only one key here for "'" or the last key. */
+            assert(1 == size);
+        } else {
+            /* exceed the maximum phrase length.  */
+            if (cached_keys->len >= MAX_PHRASE_LENGTH)
+                continue;
+
+            /* push value */
+            g_array_append_val(cached_keys, key);
+        }
+
+        /* search the partial keys once, then share it with
+           all the longer keys. */
+        int retval = SEARCH_CONTINUED;
+        if (cached_keys->len > 0)
+            retval = table->search_fuzzy(matrix->get_fuzzy_options(),
+                                         cached_keys->len,
+                                         (ChewingKey *)cached_keys->data,
+                                         results->get_ranges(newstart));
+
+        results->add_result(newstart, retval);
+        result |= retval;
+
+        /* prune the partial keys without longer phrases. */
+        if ((retval & SEARCH_CONTINUED) && newstart < end)
+            result |= search_matrix_all_recur(cached_keys, table, matrix,
+                                              newstart, end, results);
+
+        /* pop value */
+        if (zero_key != key)
+            g_array_set_size(cached_keys, cached_keys->len - 1);
+    }
+
+    return result;
+}
+
+int search_matrix_all(const FacadeChewingTable2 * table,
+                      const PhoneticKeyMatrix * matrix,
+                      size_t start, size_t end,
+                      MatrixSearchResults * results) {
+    assert(end < matrix->size());
+
+    results->clear_all(matrix->size());
+
+    if (start >= end)
+        return SEARCH_NONE;
+
+    const size_t start_len = matrix->get_column_size(start);
+    if (0 == start_len)
+        return SEARCH_NONE;
+
+    GArray * cached_keys = results->get_cached_keys();
+
+    return search_matrix_all_recur(cached_keys, table, matrix,
+                                   start, end, results);
+}
+
 int search_suggestion_with_matrix_recur(GArray * cached_keys,
                                         const FacadeChewingTable2 * table,
                                         const PhoneticKeyMatrix * matrix,
@@ -470,13 +771,15 @@ int search_suggestion_with_matrix_recur(GArray * cached_keys,
 
     int result = SEARCH_NONE;
 
-    const size_t size = matrix->get_column_size(start);
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = matrix->get_column(start, keys, key_rests);
     /* assume pinyin parsers will filter invalid keys. */
     assert(size > 0);
 
     for (size_t i = 0; i < size; ++i) {
-        ChewingKey key; ChewingKeyRest key_rest;
-        matrix->get_item(start, i, key, key_rest);
+        const ChewingKey & key = keys[i];
+        const ChewingKeyRest & key_rest = key_rests[i];
 
         const size_t newstart = key_rest.m_raw_end;
 
@@ -553,13 +856,15 @@ gfloat compute_pronunciation_possibility_recur(const PhoneticKeyMatrix * matrix,
 
     gfloat result = 0.;
 
-    const size_t size = matrix->get_column_size(start);
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = matrix->get_column(start, keys, key_rests);
     /* assume pinyin parsers will filter invalid keys. */
     assert(size > 0);
 
     for (size_t i = 0; i < size; ++i) {
-        ChewingKey key; ChewingKeyRest key_rest;
-        matrix->get_item(start, i, key, key_rest);
+        const ChewingKey & key = keys[i];
+        const ChewingKeyRest & key_rest = key_rests[i];
 
         const size_t newstart = key_rest.m_raw_end;
 
@@ -623,13 +928,15 @@ bool increase_pronunciation_possibility_recur(const PhoneticKeyMatrix * matrix,
 
     bool result = false;
 
-    const size_t size = matrix->get_column_size(start);
+    const ChewingKey * keys = NULL;
+    const ChewingKeyRest * key_rests = NULL;
+    const size_t size = matrix->get_column(start, keys, key_rests);
     /* assume pinyin parsers will filter invalid keys. */
     assert(size > 0);
 
     for (size_t i = 0; i < size; ++i) {
-        ChewingKey key; ChewingKeyRest key_rest;
-        matrix->get_item(start, i, key, key_rest);
+        const ChewingKey & key = keys[i];
+        const ChewingKeyRest & key_rest = key_rests[i];
 
         const size_t newstart = key_rest.m_raw_end;
 
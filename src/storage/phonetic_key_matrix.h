@@ -29,107 +29,223 @@
 
 namespace pinyin {
 
+/**
+ * PhoneticTable:
+ *
+ * The columns of the items, stored in one contiguous array with
+ *   the column offsets, like the compressed sparse rows.
+ *
+ * Note: the steps build the columns one by one in the build buffers,
+ *   then swap them with the table by end_build.
+ *
+ */
 template<typename Item>
 class PhoneticTable {
 protected:
-    /* Pointer Array of Array of Item. */
-    GPtrArray * m_table_content;
+    /* Array of Item, all the columns one after another. */
+    GArray * m_items;
+    /* Array of guint32, the column i is from m_offsets[i]
+       to m_offsets[i + 1] in m_items. */
+    GArray * m_offsets;
+
+    /* the items and offsets of the bulk build, kept for re-use. */
+    GArray * m_build_items;
+    GArray * m_build_offsets;
+
+    /* no copy. */
+    PhoneticTable(const PhoneticTable & other);
+    PhoneticTable & operator=(const PhoneticTable & other);
+
+    static void clear_columns(GArray * items, GArray * offsets) {
+        const guint32 zero = 0;
+        g_array_set_size(items, 0);
+        g_array_set_size(offsets, 0);
+        g_array_append_val(offsets, zero);
+    }
 
 public:
     PhoneticTable() {
-        m_table_content = g_ptr_array_new();
+        m_items = g_array_new(FALSE, FALSE, sizeof(Item));
+        m_offsets = g_array_new(FALSE, TRUE, sizeof(guint32));
+        m_build_items = g_array_new(FALSE, FALSE, sizeof(Item));
+        m_build_offsets = g_array_new(FALSE, TRUE, sizeof(guint32));
+
+        clear_columns(m_items, m_offsets);
+        clear_columns(m_build_items, m_build_offsets);
     }
 
     ~PhoneticTable() {
-        clear_all();
-
-        g_ptr_array_free(m_table_content, TRUE);
-        m_table_content = NULL;
+        g_array_free(m_items, TRUE);
+        m_items = NULL;
+        g_array_free(m_offsets, TRUE);
+        m_offsets = NULL;
+        g_array_free(m_build_items, TRUE);
+        m_build_items = NULL;
+        g_array_free(m_build_offsets, TRUE);
+        m_build_offsets = NULL;
     }
 
     bool clear_all() {
-        for (size_t i = 0; i < m_table_content->len; ++i) {
-            GArray * column = (GArray *)
-                g_ptr_array_index(m_table_content, i);
-            g_array_free(column, TRUE);
-        }
-
-        g_ptr_array_set_size(m_table_content, 0);
+        clear_columns(m_items, m_offsets);
         return true;
     }
 
     size_t size() const {
-        return m_table_content->len;
+        return m_offsets->len - 1;
     }
 
     /* when call this function,
        reserve one extra slot for the end slot. */
     bool set_size(size_t size) {
-        clear_all();
+        g_array_set_size(m_items, 0);
+        /* the new offsets are zero. */
+        g_array_set_size(m_offsets, 0);
+        g_array_set_size(m_offsets, size + 1);
+        return true;
+    }
 
-        g_ptr_array_set_size(m_table_content, size);
-        for (size_t i = 0; i < m_table_content->len; ++i) {
-            g_ptr_array_index(m_table_content, i) =
-                g_array_new(TRUE, TRUE, sizeof(Item));
+    /* keep the first columns, and clear the other columns. */
+    bool resize(size_t size) {
+        if (size <= this->size()) {
+            g_array_set_size(m_items, g_array_index(m_offsets, guint32, size));
+            g_array_set_size(m_offsets, size + 1);
+            return true;
         }
 
+        const guint32 end = m_items->len;
+        for (size_t i = this->size(); i < size; ++i)
+            g_array_append_val(m_offsets, end);
         return true;
     }
 
-    /* Array of Item. */
-    bool get_items(size_t index, GArray * items) const {
-        g_array_set_size(items, 0);
-
-        if (index >= m_table_content->len)
-            return false;
+    /* the read-only items of the column, valid until the table is changed. */
+    const Item * get_column(size_t index, size_t & size) const {
+        assert(index < this->size());
 
-        GArray * column = (GArray *)
-            g_ptr_array_index(m_table_content, index);
-        g_array_append_vals(items, column->data, column->len);
-        return true;
+        const guint32 begin = g_array_index(m_offsets, guint32, index);
+        size = g_array_index(m_offsets, guint32, index + 1) - begin;
+        return &g_array_index(m_items, Item, begin);
     }
 
+    /* insert the item after the column. */
     bool append(size_t index, const Item & item) {
-        if (index >= m_table_content->len)
+        if (index >= size())
             return false;
 
-        GArray * column = (GArray *)
-            g_ptr_array_index(m_table_content, index);
-        g_array_append_val(column, item);
+        guint32 * offsets = (guint32 *) m_offsets->data;
+        g_array_insert_val(m_items, offsets[index + 1], item);
+        for (size_t i = index + 1; i < m_offsets->len; ++i)
+            ++offsets[i];
         return true;
     }
 
     size_t get_column_size(size_t index) const {
-        assert(index < m_table_content->len);
+        assert(index < size());
 
-        GArray * column = (GArray *)
-            g_ptr_array_index(m_table_content, index);
-        return column->len;
+        return g_array_index(m_offsets, guint32, index + 1) -
+            g_array_index(m_offsets, guint32, index);
     }
 
     bool get_item(size_t index, size_t row, Item & item) const {
-        assert(index < m_table_content->len);
+        assert(row < get_column_size(index));
 
-        GArray * column = (GArray *)
-            g_ptr_array_index(m_table_content, index);
-        assert(row < column->len);
+        const guint32 begin = g_array_index(m_offsets, guint32, index);
+        item = g_array_index(m_items, Item, begin + row);
+        return true;
+    }
 
-        item = g_array_index(column, Item, row);
+    /* start to build the columns one by one. */
+    bool begin_build() {
+        clear_columns(m_build_items, m_build_offsets);
+        return true;
+    }
+
+    /* add the empty column after the built columns. */
+    size_t add_column() {
+        const guint32 end = m_build_items->len;
+        g_array_append_val(m_build_offsets, end);
+        return m_build_offsets->len - 2;
+    }
+
+    /* add the items to the last built column. */
+    bool add_items(const Item * items, size_t num) {
+        assert(m_build_offsets->len > 1);
+
+        g_array_append_vals(m_build_items, items, num);
+        g_array_index(m_build_offsets, guint32,
+                      m_build_offsets->len - 1) += num;
+        return true;
+    }
+
+    size_t get_built_column_size() const {
+        assert(m_build_offsets->len > 1);
+
+        return g_array_index(m_build_offsets, guint32,
+                             m_build_offsets->len - 1) -
+            g_array_index(m_build_offsets, guint32,
+                          m_build_offsets->len - 2);
+    }
+
+    bool get_built_item(size_t row, Item & item) const {
+        assert(row < get_built_column_size());
+
+        const guint32 begin = g_array_index(m_build_offsets, guint32,
+                                            m_build_offsets->len - 2);
+        item = g_array_index(m_build_items, Item, begin + row);
+        return true;
+    }
+
+    /* replace the columns with the built columns. */
+    bool end_build() {
+        GArray * items = m_items;
+        m_items = m_build_items;
+        m_build_items = items;
+
+        GArray * offsets = m_offsets;
+        m_offsets = m_build_offsets;
+        m_build_offsets = offsets;
         return true;
     }
 
 };
 
+/**
+ * PhoneticKeyMatrix:
+ *
+ * The keys and key rests of the user input, the column i contains
+ *   the keys which start from the i-th char of the input.
+ *
+ * Note: the columns are only read through the spans of get_column,
+ *   the steps build the new columns with begin_build and end_build.
+ *
+ */
 class PhoneticKeyMatrix {
 protected:
     PhoneticTable<ChewingKey> m_keys;
     PhoneticTable<ChewingKeyRest> m_key_rests;
 
+    /* the fuzzy pinyin options filled by fuzzy_syllable_step. */
+    pinyin_option_t m_fuzzy_options;
+
 public:
+    PhoneticKeyMatrix() {
+        m_fuzzy_options = 0;
+    }
+
     bool clear_all() {
+        m_fuzzy_options = 0;
         return m_keys.clear_all() && m_key_rests.clear_all();
     }
 
+    pinyin_option_t get_fuzzy_options() const {
+        return m_fuzzy_options;
+    }
+
+    bool set_fuzzy_options(pinyin_option_t options) {
+        m_fuzzy_options = options & PINYIN_AMB_ALL;
+        return true;
+    }
+
     size_t size() const {
         assert(m_keys.size() == m_key_rests.size());
         return m_keys.size();
@@ -140,13 +256,19 @@ public:
         return m_keys.set_size(size) && m_key_rests.set_size(size);
     }
 
-    /* Array of keys and key rests. */
-    bool get_items(size_t index, GArray * keys, GArray * key_rests) const {
-        bool result = m_keys.get_items(index, keys) &&
-            m_key_rests.get_items(index, key_rests);
+    /* keep the first columns, same as PhoneticTable. */
+    bool resize(size_t size) {
+        return m_keys.resize(size) && m_key_rests.resize(size);
+    }
 
-        assert(keys->len == key_rests->len);
-        return result;
+    /* the keys and key rests of the column, returns the column size. */
+    size_t get_column(size_t index, const ChewingKey * & keys,
+                      const ChewingKeyRest * & key_rests) const {
+        size_t size = 0, rest_size = 0;
+        keys = m_keys.get_column(index, size);
+        key_rests = m_key_rests.get_column(index, rest_size);
+        assert(size == rest_size);
+        return size;
     }
 
     bool append(size_t index, const ChewingKey & key,
@@ -167,6 +289,155 @@ public:
             m_key_rests.get_item(index, row, key_rest);
     }
 
+    /* the bulk build, same as PhoneticTable,
+       the fuzzy options are kept. */
+    bool begin_build() {
+        return m_keys.begin_build() && m_key_rests.begin_build();
+    }
+
+    size_t add_column() {
+        const size_t index = m_keys.add_column();
+        check_result(index == m_key_rests.add_column());
+        return index;
+    }
+
+    bool add_item(const ChewingKey & key, const ChewingKeyRest & key_rest) {
+        return m_keys.add_items(&key, 1) &&
+            m_key_rests.add_items(&key_rest, 1);
+    }
+
+    bool add_items(const ChewingKey * keys, const ChewingKeyRest * key_rests,
+                   size_t num) {
+        return m_keys.add_items(keys, num) &&
+            m_key_rests.add_items(key_rests, num);
+    }
+
+    size_t get_built_column_size() const {
+        const size_t size = m_keys.get_built_column_size();
+        assert(size == m_key_rests.get_built_column_size());
+        return size;
+    }
+
+    bool get_built_item(size_t row, ChewingKey & key,
+                        ChewingKeyRest & key_rest) const {
+        return m_keys.get_built_item(row, key) &&
+            m_key_rests.get_built_item(row, key_rest);
+    }
+
+    bool end_build() {
+        return m_keys.end_build() && m_key_rests.end_build();
+    }
+
+};
+
+/**
+ * MatrixSearchResults:
+ * The search results of all end columns from one start column,
+ * filled by search_matrix_all.
+ */
+class MatrixSearchResults {
+protected:
+    FacadePhraseIndex * m_phrase_index;
+
+    /* Array of int, the search result of every end column. */
+    GArray * m_results;
+    /* Pointer Array of PhraseIndexRanges, prepared on demand. */
+    GPtrArray * m_ranges;
+    /* the number of the prepared ranges since created. */
+    guint32 m_num_allocations;
+    /* the pinyin keys of the search_matrix_all call. */
+    GArray * m_cached_keys;
+
+public:
+    MatrixSearchResults(FacadePhraseIndex * phrase_index) {
+        m_phrase_index = phrase_index;
+        m_results = g_array_new(TRUE, TRUE, sizeof(int));
+        m_ranges = g_ptr_array_new();
+        m_num_allocations = 0;
+        m_cached_keys = g_array_new(TRUE, TRUE, sizeof(ChewingKey));
+    }
+
+    ~MatrixSearchResults() {
+        for (size_t i = 0; i < m_ranges->len; ++i) {
+            GArray ** ranges = (GArray **) g_ptr_array_index(m_ranges, i);
+            if (NULL == ranges)
+                continue;
+
+            m_phrase_index->destroy_ranges(ranges);
+            g_free(ranges);
+        }
+
+        g_array_free(m_cached_keys, TRUE);
+        m_cached_keys = NULL;
+        g_ptr_array_free(m_ranges, TRUE);
+        m_ranges = NULL;
+        g_array_free(m_results, TRUE);
+        m_results = NULL;
+    }
+
+    /* clear the results, keep the prepared ranges for re-use. */
+    bool clear_all(size_t size) {
+        g_array_set_size(m_results, 0);
+        g_array_set_size(m_results, size);
+
+        if (m_ranges->len < size)
+            g_ptr_array_set_size(m_ranges, size);
+
+        for (size_t i = 0; i < m_ranges->len; ++i) {
+            GArray ** ranges = (GArray **) g_ptr_array_index(m_ranges, i);
+            if (NULL == ranges)
+                continue;
+
+            /* the sub phrase indices may be loaded or unloaded. */
+            if (m_phrase_index->update_ranges(ranges))
+                ++m_num_allocations;
+            m_phrase_index->clear_ranges(ranges);
+        }
+        return true;
+    }
+
+    size_t size() const {
+        return m_results->len;
+    }
+
+    int get_result(size_t end) const {
+        if (end >= m_results->len)
+            return SEARCH_NONE;
+
+        return g_array_index(m_results, int, end);
+    }
+
+    bool add_result(size_t end, int result) {
+        assert(end < m_results->len);
+
+        g_array_index(m_results, int, end) |= result;
+        return true;
+    }
+
+    /* the returned ranges are owned by this class. */
+    GArray ** get_ranges(size_t end) {
+        assert(end < m_ranges->len);
+
+        GArray ** ranges = (GArray **) g_ptr_array_index(m_ranges, end);
+        if (NULL == ranges) {
+            ranges = g_new0(GArray *, PHRASE_INDEX_LIBRARY_COUNT);
+            m_phrase_index->prepare_ranges(ranges);
+            g_ptr_array_index(m_ranges, end) = ranges;
+            ++m_num_allocations;
+        }
+
+        return ranges;
+    }
+
+    guint32 get_num_scratch_allocations() const {
+        return m_num_allocations;
+    }
+
+    /* the scratch keys, cleared before returned. */
+    GArray * get_cached_keys() {
+        g_array_set_size(m_cached_keys, 0);
+        return m_cached_keys;
+    }
 };
 
 /**
@@ -201,17 +472,62 @@ bool inner_split_step(pinyin_option_t options,
  * For "an" <=> "ang", fill the fuzzy pinyins into the matrix.
  * Supported nearly in all pinyin parsers.
  * At most 3 * 2 entries will be added.
+ * The search_matrix* functions search the fuzzy pinyins
+ * with the fuzzy chewing index in one lookup.
  */
 bool fuzzy_syllable_step(pinyin_option_t options,
                          PhoneticKeyMatrix * matrix);
 
+/**
+ * refill_matrix:
+ * Update the PhoneticKeyMatrix filled from the previous keys by
+ * fill_matrix and the above steps, to the matrix of the new keys.
+ * Only the columns after the common prefix of the keys are re-filled.
+ * Returns the index of the first changed column.
+ */
+size_t refill_matrix(pinyin_option_t options,
+                     PhoneticKeyMatrix * matrix,
+                     ChewingKeyVector prev_keys,
+                     ChewingKeyRestVector prev_key_rests,
+                     ChewingKeyVector keys,
+                     ChewingKeyRestVector key_rests,
+                     size_t parsed_len);
+
 bool dump_matrix(PhoneticKeyMatrix * matrix);
 
+/**
+ * copy_matrix:
+ * Copy all the keys and key rests from src to dest.
+ */
+bool copy_matrix(PhoneticKeyMatrix * dest,
+                 const PhoneticKeyMatrix * src);
+
+/**
+ * diff_matrix:
+ * Returns the index of the first different column,
+ * or the smaller size when one matrix is the prefix of the other.
+ */
+size_t diff_matrix(const PhoneticKeyMatrix * lhs,
+                   const PhoneticKeyMatrix * rhs);
+
 int search_matrix(const FacadeChewingTable2 * table,
                   const PhoneticKeyMatrix * matrix,
                   size_t start, size_t end,
                   PhraseIndexRanges ranges);
 
+/**
+ * search_matrix_all:
+ * Search the phrases from the 'start' column to all end columns
+ * until the 'end' column in one pass.
+ * Extend the partial keys column by column,
+ * and prune the partial keys which are not found in the table.
+ * Returns the combined search result of all end columns.
+ */
+int search_matrix_all(const FacadeChewingTable2 * table,
+                      const PhoneticKeyMatrix * matrix,
+                      size_t start, size_t end,
+                      MatrixSearchResults * results);
+
 int search_suggestion_with_matrix(const FacadeChewingTable2 * table,
                                   const PhoneticKeyMatrix * matrix,
                                   size_t prefix_len,
@@ -18,6 +18,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
 #include "phrase_index.h"
 #include "pinyin_custom2.h"
 #include "unaligned_memory.h"
@@ -142,28 +143,56 @@ void PhraseItem::increase_pronunciation_possibility(ChewingKey * keys,
 }
 
 
-guint32 SubPhraseIndex::get_phrase_index_total_freq(){
-    return m_total_freq;
+void SubPhraseIndex::free_overlay_item(gpointer data){
+    MemoryChunk * chunk = (MemoryChunk *) data;
+    delete chunk;
 }
 
-int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
-    table_offset_t offset;
-    guint32 freq;
-    bool result = m_phrase_index.get_content
-        ((token & PHRASE_MASK) 
-         * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
+void SubPhraseIndex::update_unigram_item(phrase_token_t token){
+    const guint32 index = token & PHRASE_MASK;
 
-    if ( !result )
-        return ERROR_OUT_OF_RANGE;
+    PhraseItem item;
+    if ( get_phrase_item(token, item) != ERROR_OK ){
+        /* clear the removed phrase item. */
+        if ( index < m_unigram_table->len )
+            memset(&g_array_index(m_unigram_table, PhraseUnigramItem, index),
+                   0, sizeof(PhraseUnigramItem));
+        return;
+    }
 
-    if ( 0 == offset )
-        return ERROR_NO_ITEM;
+    if ( index >= m_unigram_table->len )
+        g_array_set_size(m_unigram_table, index + 1);
 
-    result = m_phrase_content.get_content
-        (offset + sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
+    PhraseUnigramItem * unigram = &g_array_index
+        (m_unigram_table, PhraseUnigramItem, index);
+    unigram->m_freq = item.get_unigram_frequency();
+    unigram->m_length = item.get_phrase_length();
+    unigram->m_log_freq = unigram->m_freq ? log(unigram->m_freq) : 0.;
+}
 
-    if ( !result )
-        return ERROR_FILE_CORRUPTION;
+void SubPhraseIndex::init_unigram_table(){
+    g_array_set_size(m_unigram_table, 0);
+
+    PhraseIndexRange range;
+    if ( get_range(range) != ERROR_OK )
+        return;
+
+    for ( phrase_token_t token = range.m_range_begin;
+          token < range.m_range_end; ++token )
+        update_unigram_item(token);
+}
+
+guint32 SubPhraseIndex::get_phrase_index_total_freq(){
+    return m_total_freq;
+}
+
+int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
+    PhraseItem item;
+    int result = get_phrase_item(token, item);
+    if ( result != ERROR_OK )
+        return result;
+
+    guint32 freq = item.get_unigram_frequency();
 
     //protect total_freq overflow
     if ( delta > 0 && m_total_freq > m_total_freq + delta )
@@ -171,8 +200,10 @@ int SubPhraseIndex::add_unigram_frequency(phrase_token_t token, guint32 delta){
 
     freq += delta;
     m_total_freq += delta;
-    m_phrase_content.set_content(offset + sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
+    /* in place editing, the item points to the actual data position. */
+    item.m_chunk.set_content(sizeof(guint8) + sizeof(guint8), &freq, sizeof(guint32));
 
+    update_unigram_item(token);
     return ERROR_OK;
 }
 
@@ -180,7 +211,14 @@ int SubPhraseIndex::get_phrase_item(phrase_token_t token, PhraseItem & item){
     table_offset_t offset;
     guint8 phrase_length;
     guint8 n_prons;
-    
+
+    MemoryChunk * overlay_item = (MemoryChunk *) g_hash_table_lookup
+        (m_overlay, GUINT_TO_POINTER(token & PHRASE_MASK));
+    if ( overlay_item ){
+        item.m_chunk.set_chunk(overlay_item->begin(), overlay_item->size(), NULL);
+        return ERROR_OK;
+    }
+
     bool result = m_phrase_index.get_content
         ((token & PHRASE_MASK) 
          * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
@@ -205,6 +243,17 @@ int SubPhraseIndex::get_phrase_item(phrase_token_t token, PhraseItem & item){
 }
 
 int SubPhraseIndex::add_phrase_item(phrase_token_t token, PhraseItem * item){
+    if ( m_chunk ){
+        /* keep the loaded memory chunk unchanged. */
+        MemoryChunk * overlay_item = new MemoryChunk;
+        overlay_item->set_content(0, item->m_chunk.begin(), item->m_chunk.size());
+        g_hash_table_replace(m_overlay, GUINT_TO_POINTER(token & PHRASE_MASK),
+                             overlay_item);
+        m_total_freq += item->get_unigram_frequency();
+        update_unigram_item(token);
+        return ERROR_OK;
+    }
+
     table_offset_t offset = m_phrase_content.size();
     if ( 0 == offset )
         offset = 8;
@@ -212,6 +261,7 @@ int SubPhraseIndex::add_phrase_item(phrase_token_t token, PhraseItem * item){
     m_phrase_index.set_content((token & PHRASE_MASK) 
                                * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
     m_total_freq += item->get_unigram_frequency();
+    update_unigram_item(token);
     return ERROR_OK;
 }
 
@@ -226,10 +276,20 @@ int SubPhraseIndex::remove_phrase_item(phrase_token_t token, PhraseItem * & item
     //implictly copy data from m_chunk_content.
     item->m_chunk.set_content(0, (char *) old_item.m_chunk.begin() , old_item.m_chunk.size());
 
-    const table_offset_t zero_const = 0;
-    m_phrase_index.set_content((token & PHRASE_MASK)
-                               * sizeof(table_offset_t), &zero_const, sizeof(table_offset_t));
+    /* the old item is freed here when in the overlay. */
+    g_hash_table_remove(m_overlay, GUINT_TO_POINTER(token & PHRASE_MASK));
+
+    table_offset_t offset = 0;
+    bool retval = m_phrase_index.get_content
+        ((token & PHRASE_MASK)
+         * sizeof(table_offset_t), &offset, sizeof(table_offset_t));
+    if ( retval && 0 != offset ){
+        const table_offset_t zero_const = 0;
+        m_phrase_index.set_content((token & PHRASE_MASK)
+                                   * sizeof(table_offset_t), &zero_const, sizeof(table_offset_t));
+    }
     m_total_freq -= item->get_unigram_frequency();
+    update_unigram_item(token);
     return ERROR_OK;
 }
 
@@ -339,6 +399,7 @@ bool SubPhraseIndex::load(MemoryChunk * chunk,
         m_chunk = NULL;
     }
     m_chunk = chunk;
+    g_hash_table_remove_all(m_overlay);
     
     char * buf_begin = (char *)chunk->begin();
     chunk->get_content(offset, &m_total_freq, sizeof(guint32));
@@ -358,11 +419,41 @@ bool SubPhraseIndex::load(MemoryChunk * chunk,
     m_phrase_content.set_chunk(buf_begin + index_two, 
                                index_three - 1 - index_two, NULL);
     g_return_val_if_fail( index_three <= end, FALSE);
+
+    init_unigram_table();
     return true;
 }
 
 bool SubPhraseIndex::store(MemoryChunk * new_chunk, 
                            table_offset_t offset, table_offset_t& end){
+    const MemoryChunk * phrase_index = &m_phrase_index;
+    const MemoryChunk * phrase_content = &m_phrase_content;
+
+    /* merge the overlay with the loaded memory chunk. */
+    MemoryChunk merged_index, merged_content;
+    if ( g_hash_table_size(m_overlay) ){
+        PhraseIndexRange range;
+        get_range(range);
+
+        PhraseItem item;
+        for ( phrase_token_t token = range.m_range_begin;
+              token < range.m_range_end; ++token ){
+            if ( get_phrase_item(token, item) != ERROR_OK )
+                continue;
+
+            table_offset_t item_offset = merged_content.size();
+            if ( 0 == item_offset )
+                item_offset = 8;
+            merged_content.set_content(item_offset, item.m_chunk.begin(),
+                                       item.m_chunk.size());
+            merged_index.set_content(token * sizeof(table_offset_t),
+                                     &item_offset, sizeof(table_offset_t));
+        }
+
+        phrase_index = &merged_index;
+        phrase_content = &merged_content;
+    }
+
     new_chunk->set_content(offset, &m_total_freq, sizeof(guint32));
     table_offset_t index = offset + sizeof(guint32);
         
@@ -372,16 +463,16 @@ bool SubPhraseIndex::store(MemoryChunk * new_chunk,
     
     new_chunk->set_content(index, &offset, sizeof(table_offset_t));
     index += sizeof(table_offset_t);
-    new_chunk->set_content(offset, m_phrase_index.begin(), m_phrase_index.size());
-    offset += m_phrase_index.size();
+    new_chunk->set_content(offset, phrase_index->begin(), phrase_index->size());
+    offset += phrase_index->size();
     new_chunk->set_content(offset, &c_separate, sizeof(char));
     offset += sizeof(char);
 
     new_chunk->set_content(index, &offset, sizeof(table_offset_t));
     index += sizeof(table_offset_t);
     
-    new_chunk->set_content(offset, m_phrase_content.begin(), m_phrase_content.size());
-    offset += m_phrase_content.size();
+    new_chunk->set_content(offset, phrase_content->begin(), phrase_content->size());
+    offset += phrase_content->size();
     new_chunk->set_content(offset, &c_separate, sizeof(char));
     offset += sizeof(char);
     new_chunk->set_content(index, &offset, sizeof(table_offset_t));
@@ -496,6 +587,7 @@ bool SubPhraseIndex::merge(PhraseIndexLogger * logger){
                  */
                 memmove(item.m_chunk.begin(), newchunk.begin(),
                         newchunk.size());
+                update_unigram_item(token);
             }
             break;
         }
@@ -637,22 +729,29 @@ int SubPhraseIndex::get_range(/* out */ PhraseIndexRange & range){
     const table_offset_t * begin = (const table_offset_t *)m_phrase_index.begin();
     const table_offset_t * end = (const table_offset_t *)m_phrase_index.end();
 
-    if (begin == end) {
-        /* skip empty sub phrase index. */
-        range.m_range_begin = 1;
-        range.m_range_end = 1;
-        return ERROR_OK;
-    }
+    range.m_range_begin = 1; /* token starts with 1 in gen_pinyin_table. */
+    range.m_range_end = 1;
+
+    /* skip empty sub phrase index. */
+    if (begin != end) {
+        /* remove trailing zeros. */
+        const table_offset_t * poffset = NULL;
+        for (poffset = end; poffset > begin + 1; --poffset) {
+            if (0 !=  UnalignedMemory<table_offset_t>::load(poffset - 1))
+                break;
+        }
 
-    /* remove trailing zeros. */
-    const table_offset_t * poffset = NULL;
-    for (poffset = end; poffset > begin + 1; --poffset) {
-        if (0 !=  UnalignedMemory<table_offset_t>::load(poffset - 1))
-            break;
+        range.m_range_end = poffset - begin; /* removed zeros. */
     }
 
-    range.m_range_begin = 1; /* token starts with 1 in gen_pinyin_table. */
-    range.m_range_end = poffset - begin; /* removed zeros. */
+    /* the added phrase items in the overlay. */
+    GHashTableIter iter;
+    gpointer key = NULL;
+    g_hash_table_iter_init(&iter, m_overlay);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        phrase_token_t token = GPOINTER_TO_UINT(key);
+        range.m_range_end = std_lite::max(range.m_range_end, token + 1);
+    }
 
     return ERROR_OK;
 }
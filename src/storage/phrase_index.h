@@ -244,6 +244,22 @@ public:
     }
 };
 
+/**
+ * PhraseUnigramItem:
+ *
+ * The unigram information of one phrase token, stored densely
+ * to avoid decoding the phrase item in the lookup.
+ *
+ */
+struct PhraseUnigramItem{
+    /* the unigram frequency of the phrase. */
+    guint32 m_freq;
+    /* the phrase length, zero when the phrase item doesn't exist. */
+    guint8 m_length;
+    /* log(m_freq), zero when m_freq is zero. */
+    gdouble m_log_freq;
+};
+
 /*
  *  In Sub Phrase Index, token == (token & PHRASE_MASK).
  */
@@ -261,10 +277,25 @@ private:
     MemoryChunk m_phrase_content;
     MemoryChunk * m_chunk;
 
+    /* When loaded from the memory chunk, the added phrase items are
+       stored in the overlay, to avoid copying the whole memory chunk.
+       Key: phrase_token_t, Value: MemoryChunk * of the phrase item. */
+    GHashTable * m_overlay;
+
+    /* Array of PhraseUnigramItem, indexed by the phrase token. */
+    GArray * m_unigram_table;
+
+    static void free_overlay_item(gpointer data);
+
+    void update_unigram_item(phrase_token_t token);
+    void init_unigram_table();
+
     void reset(){
         m_total_freq = 0;
         m_phrase_index.set_size(0);
         m_phrase_content.set_size(0);
+        g_hash_table_remove_all(m_overlay);
+        g_array_set_size(m_unigram_table, 0);
         if ( m_chunk ){
             delete m_chunk;
             m_chunk = NULL;
@@ -280,6 +311,10 @@ public:
      */
     SubPhraseIndex():m_total_freq(0){
         m_chunk = NULL;
+        m_overlay = g_hash_table_new_full
+            (g_direct_hash, g_direct_equal, NULL, free_overlay_item);
+        m_unigram_table = g_array_new
+            (FALSE, TRUE, sizeof(PhraseUnigramItem));
     }
 
     /**
@@ -290,6 +325,10 @@ public:
      */
     ~SubPhraseIndex(){
         reset();
+        g_hash_table_unref(m_overlay);
+        m_overlay = NULL;
+        g_array_free(m_unigram_table, TRUE);
+        m_unigram_table = NULL;
     }
     
     /**
@@ -389,9 +428,34 @@ public:
      * but can increment the freq of the special pronunciation,
      * or change the content without size increasing.
      *
+     * The phrase items in the overlay take precedence.
+     *
      */
     int get_phrase_item(phrase_token_t token, PhraseItem & item);
 
+    /**
+     * SubPhraseIndex::get_unigram_item:
+     * @token: the phrase token.
+     * @item: the unigram item of the token.
+     * @returns: the status of the get operation.
+     *
+     * Get the unigram item from this sub phrase index.
+     *
+     * Note: the item is valid until this sub phrase index is modified.
+     *
+     */
+    int get_unigram_item(phrase_token_t token,
+                         const PhraseUnigramItem * & item) const {
+        const guint32 index = token & PHRASE_MASK;
+        if ( index >= m_unigram_table->len )
+            return ERROR_OUT_OF_RANGE;
+
+        item = &g_array_index(m_unigram_table, PhraseUnigramItem, index);
+        if ( 0 == item->m_length )
+            return ERROR_NO_ITEM;
+        return ERROR_OK;
+    }
+
     /**
      * SubPhraseIndex::add_phrase_item:
      * @token: the phrase token.
@@ -400,6 +464,9 @@ public:
      *
      * Add the phrase item to this sub phrase index.
      *
+     * Note: when loaded from the memory chunk, the phrase item is
+     * stored in the overlay, and the memory chunk is kept unchanged.
+     *
      */
     int add_phrase_item(phrase_token_t token, PhraseItem * item);
 
@@ -642,6 +709,9 @@ public:
      *
      * Get the phrase item from the facade phrase index.
      *
+     * Note: the item only points into the phrase index without copy,
+     *   concurrent readers are safe when no writer is active.
+     *
      */
     int get_phrase_item(phrase_token_t token, PhraseItem & item){
         guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
@@ -651,6 +721,28 @@ public:
         return sub_phrase->get_phrase_item(token, item);
     }
 
+    /**
+     * FacadePhraseIndex::get_unigram_item:
+     * @token: the phrase token.
+     * @item: the unigram item of the token.
+     * @returns: the status of the get operation.
+     *
+     * Get the phrase length and unigram frequency of the token,
+     * without decoding the phrase item.
+     *
+     * Note: the unigram log possibility is
+     *   item->m_log_freq - log(get_phrase_index_total_freq()).
+     *
+     */
+    int get_unigram_item(phrase_token_t token,
+                         const PhraseUnigramItem * & item){
+        guint8 index = PHRASE_INDEX_LIBRARY_INDEX(token);
+        SubPhraseIndex * sub_phrase = m_sub_phrase_indices[index];
+        if ( !sub_phrase )
+            return ERROR_NO_SUB_PHRASE_INDEX;
+        return sub_phrase->get_unigram_item(token, item);
+    }
+
     /**
      * FacadePhraseIndex::add_phrase_item:
      * @token: the phrase token.
@@ -714,6 +806,36 @@ public:
         return true;
     }
 
+    /**
+     * FacadePhraseIndex::update_ranges:
+     * @ranges: the ranges to be updated.
+     * @returns: whether the ranges are changed.
+     *
+     * Prepare the ranges of the loaded sub phrase indices,
+     * and destroy the ranges of the unloaded sub phrase indices,
+     * the other ranges are kept.
+     *
+     */
+    bool update_ranges(PhraseIndexRanges ranges) {
+        bool changed = false;
+        for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+            GArray * & range = ranges[i];
+            SubPhraseIndex * sub_phrase = m_sub_phrase_indices[i];
+
+            if (sub_phrase && NULL == range) {
+                range = g_array_new(FALSE, FALSE, sizeof(PhraseIndexRange));
+                changed = true;
+            }
+
+            if (NULL == sub_phrase && range) {
+                g_array_free(range, TRUE);
+                range = NULL;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
     /**
      * FacadePhraseIndex::clear_ranges:
      * @ranges: the ranges to be cleared.
@@ -69,7 +69,7 @@ PhraseLargeTable3::PhraseLargeTable3() {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     assert(0 == ret);
 
     m_entry = new PhraseTableEntry;
@@ -94,7 +94,7 @@ bool PhraseLargeTable3::attach(const char * dbfile, guint32 flags) {
 
     m_entry = new PhraseTableEntry;
 
-    u_int32_t db_flags = attach_options(flags);
+    u_int32_t db_flags = attach_thread_options(flags);
 
     if (!dbfile)
         return false;
@@ -121,7 +121,7 @@ bool PhraseLargeTable3::load_db(const char * filename) {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     if (ret != 0)
         return false;
 
@@ -184,15 +184,17 @@ int PhraseLargeTable3::search(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     DBT db_key;
     memset(&db_key, 0, sizeof(DBT));
     db_key.data = (void *) phrase;
     db_key.size = phrase_length * sizeof(ucs4_t);
 
+    /* let Berkeley DB malloc the returned data,
+       the concurrent readers never share the entry. */
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
     if (ret != 0)
         return result;
@@ -200,10 +202,13 @@ int PhraseLargeTable3::search(int phrase_length,
     /* continue searching. */
     result |= SEARCH_CONTINUED;
 
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    PhraseTableEntry entry;
+    entry.m_chunk.set_chunk(db_data.data, db_data.size, NULL);
 
-    result = m_entry->search(tokens) | result;
+    result = entry.search(tokens) | result;
 
+    entry.m_chunk.set_size(0);
+    free(db_data.data);
     return result;
 }
 
@@ -214,7 +219,6 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     DBC * cursorp = NULL;
     /* Get a cursor */
@@ -227,8 +231,10 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
     db_key1.data = (void *) phrase;
     db_key1.size = phrase_length * sizeof(ucs4_t);
 
+    /* only check the existence of the prefix entry. */
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
     /* Get the prefix entry */
     ret = cursorp->c_get(cursorp, &db_key1, &db_data, DB_SET);
     if (ret != 0) {
@@ -236,31 +242,27 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
         return result;
     }
 
-    /* Get the next entry */
+    /* Get the next entry, the buffers are re-used by each entry. */
     DBT db_key2;
     memset(&db_key2, 0, sizeof(DBT));
+    db_key2.flags = DB_DBT_REALLOC;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_REALLOC;
     ret = cursorp->c_get(cursorp, &db_key2, &db_data, DB_NEXT);
-    if (ret != 0) {
-        cursorp->c_close(cursorp);
-        return result;
-    }
 
-    while(bdb_phrase_continue_search(&db_key1, &db_key2)) {
+    /* the concurrent readers never share the entry. */
+    PhraseTableEntry entry;
+    while(0 == ret && bdb_phrase_continue_search(&db_key1, &db_key2)) {
 
-        m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
-        result = m_entry->search(tokens) | result;
-        m_entry->m_chunk.set_size(0);
+        entry.m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+        result = entry.search(tokens) | result;
+        entry.m_chunk.set_size(0);
 
-        memset(&db_key2, 0, sizeof(DBT));
-        memset(&db_data, 0, sizeof(DBT));
         ret = cursorp->c_get(cursorp, &db_key2, &db_data, DB_NEXT);
-        if (ret != 0) {
-            cursorp->c_close(cursorp);
-            return result;
-        }
     }
 
+    free(db_key2.data);
+    free(db_data.data);
     cursorp->c_close(cursorp);
     return result;
 }
@@ -280,6 +282,7 @@ int PhraseLargeTable3::add_index(int phrase_length,
 
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
 
     if (ret != 0) {
@@ -300,7 +303,9 @@ int PhraseLargeTable3::add_index(int phrase_length,
             db_key.data = (void *) phrase;
             db_key.size = len * sizeof(ucs4_t);
 
+            /* only check the existence of the entry. */
             memset(&db_data, 0, sizeof(DBT));
+            db_data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
 
             ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
             /* found entry. */
@@ -318,8 +323,10 @@ int PhraseLargeTable3::add_index(int phrase_length,
         return ERROR_OK;
     }
 
-    /* already have keys. */
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    /* already have keys, copy the returned data. */
+    m_entry->m_chunk.set_size(0);
+    m_entry->m_chunk.set_content(0, db_data.data, db_data.size);
+    free(db_data.data);
     int result = m_entry->add_index(token);
 
     /* store the entry. */
@@ -346,11 +353,15 @@ int PhraseLargeTable3::remove_index(int phrase_length,
 
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
     if (ret != 0)
         return ERROR_REMOVE_ITEM_DONOT_EXISTS;
 
-    m_entry->m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+    /* copy the returned data. */
+    m_entry->m_chunk.set_size(0);
+    m_entry->m_chunk.set_content(0, db_data.data, db_data.size);
+    free(db_data.data);
 
     int result = m_entry->remove_index(token);
     if (ERROR_OK != result)
@@ -382,32 +393,34 @@ bool PhraseLargeTable3::mask_out(phrase_token_t mask,
     if (NULL == cursorp)
         return false;
 
-    /* Initialize our DBTs. */
+    /* Initialize our DBTs, the buffers are re-used by each record. */
     memset(&db_key, 0, sizeof(DBT));
     memset(&db_data, 0, sizeof(DBT));
+    db_key.flags = DB_DBT_REALLOC;
+    db_data.flags = DB_DBT_REALLOC;
 
     /* Iterate over the database, retrieving each record in turn. */
     int ret = 0;
     while((ret = cursorp->c_get(cursorp, &db_key, &db_data, DB_NEXT)) == 0) {
-        entry.m_chunk.set_chunk(db_data.data, db_data.size, NULL);
+        entry.m_chunk.set_size(0);
+        entry.m_chunk.set_content(0, db_data.data, db_data.size);
 
         entry.mask_out(mask, value);
 
-        memset(&db_data, 0, sizeof(DBT));
-        db_data.data = entry.m_chunk.begin();
-        db_data.size = entry.m_chunk.size();
-        int ret = cursorp->put(cursorp, &db_key, &db_data,  DB_CURRENT);
+        DBT db_entry;
+        memset(&db_entry, 0, sizeof(DBT));
+        db_entry.data = entry.m_chunk.begin();
+        db_entry.size = entry.m_chunk.size();
+        int ret = cursorp->put(cursorp, &db_key, &db_entry,  DB_CURRENT);
         assert(ret == 0);
-
-        /* Initialize our DBTs. */
-        memset(&db_key, 0, sizeof(DBT));
-        memset(&db_data, 0, sizeof(DBT));
     }
     assert(ret == DB_NOTFOUND);
 
     /* Cursors must be closed */
     if (cursorp != NULL)
         cursorp->c_close(cursorp);
+    free(db_key.data);
+    free(db_data.data);
 
     m_db->sync(m_db, 0);
 
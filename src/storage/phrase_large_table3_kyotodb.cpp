@@ -168,7 +168,6 @@ int PhraseLargeTable3::search(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     const char * kbuf = (char *) phrase;
     const int32_t vsiz = m_db->check(kbuf, phrase_length * sizeof(ucs4_t));
@@ -181,13 +180,15 @@ int PhraseLargeTable3::search(int phrase_length,
     if (0 == vsiz)
         return result;
 
-    m_entry->m_chunk.set_size(vsiz);
+    /* the concurrent readers never share the entry. */
+    PhraseTableEntry entry;
+    entry.m_chunk.set_size(vsiz);
     /* m_chunk may re-allocate here. */
-    char * vbuf = (char *) m_entry->m_chunk.begin();
+    char * vbuf = (char *) entry.m_chunk.begin();
     check_result(vsiz == m_db->get(kbuf, phrase_length * sizeof(ucs4_t),
                                    vbuf, vsiz));
 
-    result = m_entry->search(tokens) | result;
+    result = entry.search(tokens) | result;
 
     return result;
 }
@@ -199,7 +200,6 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     const char * akbuf = (char *) phrase;
     const size_t aksiz = phrase_length * sizeof(ucs4_t);
@@ -222,14 +222,16 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
         return result;
     }
 
+    /* the concurrent readers never share the entry. */
+    PhraseTableEntry entry;
     size_t bksiz = 0;
     const char * bkbuf = cursor->get_key(&bksiz);
     while(kyotodb_phrase_continue_search(akbuf, aksiz, bkbuf, bksiz)) {
         size_t bvsiz = 0;
         char * bvbuf = cursor->get_value(&bvsiz);
-        m_entry->m_chunk.set_chunk(bvbuf, bvsiz, NULL);
-        result = m_entry->search(tokens) | result;
-        m_entry->m_chunk.set_size(0);
+        entry.m_chunk.set_chunk(bvbuf, bvsiz, NULL);
+        result = entry.search(tokens) | result;
+        entry.m_chunk.set_size(0);
         delete [] bkbuf;
         delete [] bvbuf;
 
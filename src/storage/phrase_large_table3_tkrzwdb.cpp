@@ -128,7 +128,6 @@ int PhraseLargeTable3::search(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     std::string_view key(reinterpret_cast<const char*>(phrase), phrase_length * sizeof(ucs4_t));
     std::string value;
@@ -143,11 +142,12 @@ int PhraseLargeTable3::search(int phrase_length,
     if (value.empty())
         return result;
 
-    /* Update entry chunk */
-    m_entry->m_chunk.set_size(value.size());
-    memcpy(m_entry->m_chunk.begin(), value.data(), value.size());
+    /* the concurrent readers never share the entry. */
+    PhraseTableEntry entry;
+    entry.m_chunk.set_chunk((void *) value.data(), value.size(), NULL);
 
-    result = m_entry->search(tokens) | result;
+    result = entry.search(tokens) | result;
+    entry.m_chunk.set_size(0);
 
     return result;
 }
@@ -159,7 +159,6 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
 
     if (NULL == m_db)
         return result;
-    assert(NULL != m_entry);
 
     std::string_view query_key(reinterpret_cast<const char*>(phrase), phrase_length * sizeof(ucs4_t));
 
@@ -174,14 +173,16 @@ int PhraseLargeTable3::search_suggestion(int phrase_length,
     if (!iter->Next().IsOK())
         return result;
 
+    /* the concurrent readers never share the entry. */
+    PhraseTableEntry entry;
     std::string key, value;
     while (iter->Get(&key, &value).IsOK()) {
         if (!tkrzw_phrase_continue_search(query_key, key))
             break;
 
-        m_entry->m_chunk.set_chunk(value.data(), value.size(), NULL);
-        result = m_entry->search(tokens) | result;
-        m_entry->m_chunk.set_size(0);
+        entry.m_chunk.set_chunk((void *) value.data(), value.size(), NULL);
+        result = entry.search(tokens) | result;
+        entry.m_chunk.set_size(0);
 
         iter->Next();
     }
@@ -119,125 +119,284 @@ static inline bool search_pinyin_index(pinyin_option_t options,
     return false;
 }
 
-static inline bool search_pinyin_index2(pinyin_option_t options,
-                                        const pinyin_index_item_t * index,
-                                        size_t len,
-                                        const char * pinyin,
-                                        ChewingKey & key,
-                                        gint16 & distance){
-    pinyin_index_item_t item;
-    memset(&item, 0, sizeof(item));
-    item.m_pinyin_input = pinyin;
+/* compare the next char of the pinyin index items after the prefix. */
+struct compare_pinyin_char_t{
+    size_t m_depth;
 
-    std_lite::pair<const pinyin_index_item_t *,
-                   const pinyin_index_item_t *> range;
-    range = std_lite::equal_range
-        (index, index + len,
-         item, compare_pinyin_less_than);
+    bool operator()(const pinyin_index_item_t & lhs, guchar rhs) const {
+        return (guchar) lhs.m_pinyin_input[m_depth] < rhs;
+    }
 
-    guint16 range_len = range.second - range.first;
-    assert(range_len <= 1);
-    if (range_len == 1) {
-        const pinyin_index_item_t * index = range.first;
+    bool operator()(guchar lhs, const pinyin_index_item_t & rhs) const {
+        return lhs < (guchar) rhs.m_pinyin_input[m_depth];
+    }
+};
 
-        if (!check_pinyin_options(options, index))
+/* the cursor of the sorted pinyin index, the items in the range
+   share the same prefix of m_depth chars.
+   As the index is sorted by strcmp, the items with the same next char
+   are consecutive, so the range is narrowed one char at a time. */
+struct pinyin_index_cursor_t{
+    const pinyin_index_item_t * m_begin;
+    const pinyin_index_item_t * m_end;
+    size_t m_depth;
+
+public:
+    pinyin_index_cursor_t(const pinyin_index_item_t * index, size_t len){
+        m_begin = index; m_end = index + len;
+        m_depth = 0;
+    }
+
+    /* returns false when no item has the new prefix. */
+    bool step(char chr){
+        if ('\0' == chr) {
+            m_begin = m_end;
             return false;
+        }
 
-        key = content_table[index->m_table_index].m_chewing_key;
-        distance = index->m_distance;
-        assert(key.get_table_index() == index->m_table_index);
-        return true;
+        compare_pinyin_char_t compare;
+        compare.m_depth = m_depth;
+
+        const guchar value = chr;
+        m_begin = std_lite::lower_bound(m_begin, m_end, value, compare);
+        m_end = std_lite::upper_bound(m_begin, m_end, value, compare);
+        ++m_depth;
+        return m_begin != m_end;
     }
 
-    return false;
+    /* the item equals to the prefix, which is sorted first. */
+    const pinyin_index_item_t * get_item() const{
+        if (m_begin != m_end && '\0' == m_begin->m_pinyin_input[m_depth])
+            return m_begin;
+        return NULL;
+    }
+};
+
+static inline bool get_pinyin_key(pinyin_option_t options,
+                                  const pinyin_index_item_t * index,
+                                  ChewingKey & key,
+                                  gint16 & distance){
+    if (NULL == index)
+        return false;
+
+    if (!check_pinyin_options(options, index))
+        return false;
+
+    key = content_table[index->m_table_index].m_chewing_key;
+    distance = index->m_distance;
+    assert(key.get_table_index() == index->m_table_index);
+    return true;
 }
 
+static inline bool search_pinyin_index2(pinyin_option_t options,
+                                        const pinyin_index_item_t * index,
+                                        size_t len,
+                                        const char * pinyin,
+                                        int pinyin_len,
+                                        ChewingKey & key,
+                                        gint16 & distance){
+    pinyin_index_cursor_t cursor(index, len);
 
-/* Full Pinyin Parser */
-FullPinyinParser2::FullPinyinParser2 (){
-    m_pinyin_index = NULL; m_pinyin_index_len = 0;
-    m_parse_steps = g_array_new(TRUE, FALSE, sizeof(parse_value_t));
+    for (int i = 0; i < pinyin_len; ++i) {
+        if (!cursor.step(pinyin[i]))
+            return false;
+    }
 
-    set_scheme(FULL_PINYIN_DEFAULT);
+    return get_pinyin_key(options, cursor.get_item(), key, distance);
 }
 
-bool FullPinyinParser2::parse_one_key (pinyin_option_t options,
-                                       ChewingKey & key,
-                                       gint16 & distance,
-                                       const char * pinyin, int len) const {
+/* parse one pinyin with the optional tone. */
+static bool parse_one_pinyin(pinyin_option_t options,
+                             const pinyin_index_item_t * index,
+                             size_t index_len,
+                             ChewingKey & key,
+                             gint16 & distance,
+                             const char * pinyin, int len){
     /* "'" are not accepted in parse_one_key. */
-    gchar * input = g_strndup(pinyin, len);
-    assert(NULL == strchr(input, '\''));
+    assert(NULL == memchr(pinyin, '\'', len));
 
-    guint16 tone = CHEWING_ZERO_TONE; guint16 tone_pos = 0;
-    guint16 parsed_len = len;
+    guint16 tone = CHEWING_ZERO_TONE;
+    int parsed_len = len;
     key = ChewingKey();
 
+    if (0 == len)
+        return false;
+
     if (options & USE_TONE) {
         /* find the tone in the last character. */
-        char chr = input[parsed_len - 1];
+        char chr = pinyin[parsed_len - 1];
         if ( '0' < chr && chr <= '5' ) {
             tone = chr - '0';
             parsed_len --;
-            tone_pos = parsed_len;
         }
 
         /* check the force tone option. */
-        if (options & FORCE_TONE && CHEWING_ZERO_TONE == tone) {
-            g_free(input);
+        if (options & FORCE_TONE && CHEWING_ZERO_TONE == tone)
             return false;
-        }
     }
 
     /* parse pinyin core staff here. */
-
-    /* Note: optimize here? */
-    input[parsed_len] = '\0';
-    if (!search_pinyin_index2(options, m_pinyin_index, m_pinyin_index_len,
-                              input, key, distance)) {
-        g_free(input);
+    if (!search_pinyin_index2(options, index, index_len,
+                              pinyin, parsed_len, key, distance))
         return false;
-    }
 
-    if (options & USE_TONE) {
-        /* post processing tone. */
-        if ( parsed_len == tone_pos ) {
-            if (tone != CHEWING_ZERO_TONE) {
-                key.m_tone = tone;
-                parsed_len ++;
-            }
-        }
+    /* post processing tone. */
+    if (tone != CHEWING_ZERO_TONE)
+        key.m_tone = tone;
+
+    return true;
+}
+
+
+/* Parse Scratch */
+PhoneticParseScratch::PhoneticParseScratch (){
+    m_steps = g_array_new(TRUE, FALSE, sizeof(parse_value_t));
+    m_input = g_string_new(NULL);
+    m_options = 0;
+    m_index = NULL;
+}
+
+PhoneticParseScratch::~PhoneticParseScratch (){
+    g_string_free(m_input, TRUE);
+    m_input = NULL;
+    g_array_free(m_steps, TRUE);
+    m_steps = NULL;
+}
+
+/* the per-thread parse steps of the parse method,
+   only grows, to avoid the allocation per parse. */
+static void free_parse_scratch(gpointer data) {
+    delete (PhoneticParseScratch *) data;
+}
+
+static GPrivate parse_scratch_key = G_PRIVATE_INIT(free_parse_scratch);
+
+static PhoneticParseScratch * get_parse_scratch() {
+    PhoneticParseScratch * scratch = (PhoneticParseScratch *)
+        g_private_get(&parse_scratch_key);
+    if (NULL == scratch) {
+        scratch = new PhoneticParseScratch;
+        g_private_set(&parse_scratch_key, scratch);
     }
+    return scratch;
+}
+
+
+/* Full Pinyin Parser */
+FullPinyinParser2::FullPinyinParser2 (){
+    m_pinyin_index = NULL; m_pinyin_index_len = 0;
 
-    g_free(input);
-    return parsed_len == len;
+    set_scheme(FULL_PINYIN_DEFAULT);
+}
+
+bool FullPinyinParser2::parse_one_key (pinyin_option_t options,
+                                       ChewingKey & key,
+                                       gint16 & distance,
+                                       const char * pinyin, int len) const {
+    return parse_one_pinyin(options, m_pinyin_index, m_pinyin_index_len,
+                            key, distance, pinyin, len);
 }
 
 
 int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
                               ChewingKeyRestVector & key_rests,
                               const char *str, int len) const {
-    int i;
+    return parse(options, get_parse_scratch(), keys, key_rests, str, len);
+}
+
+int FullPinyinParser2::parse (pinyin_option_t options,
+                              PhoneticParseScratch * scratch,
+                              ChewingKeyVector & keys,
+                              ChewingKeyRestVector & key_rests,
+                              const char *str, int len) const {
     /* clear arrays. */
     g_array_set_size(keys, 0);
     g_array_set_size(key_rests, 0);
 
-    /* init m_parse_steps, and prepare dynamic programming. */
+    /* the parse steps are overwritten here. */
+    scratch->clear();
+
+    compute_steps(scratch, options, str, len, 0);
+
+    /* final step for back tracing. */
+    gint16 parsed_len = final_step(scratch, len + 1, keys, key_rests);
+
+#if 0
+    /* post processing for re-split table. */
+    if (options & USE_RESPLIT_TABLE) {
+        post_process2(options, keys, key_rests, str, len);
+    }
+#endif
+
+    return parsed_len;
+}
+
+int FullPinyinParser2::parse_incremental (pinyin_option_t options,
+                                          PhoneticParseScratch * scratch,
+                                          ChewingKeyVector & keys,
+                                          ChewingKeyRestVector & key_rests,
+                                          const char *str, int len) const {
+    /* clear arrays. */
+    g_array_set_size(keys, 0);
+    g_array_set_size(key_rests, 0);
+
+    /* find the common prefix with the previous input,
+       the parse steps depend on the options and the scheme. */
+    int start = 0;
+    if (options == scratch->m_options && m_pinyin_index == scratch->m_index) {
+        GString * input = scratch->m_input;
+        const int length = std_lite::min(len, (int) input->len);
+        while (start < length && str[start] == input->str[start])
+            ++start;
+    }
+
+    compute_steps(scratch, options, str, len, start);
+
+    /* save the input of the parse steps. */
+    g_string_truncate(scratch->m_input, 0);
+    g_string_append_len(scratch->m_input, str, len);
+    scratch->m_options = options;
+    scratch->m_index = m_pinyin_index;
+
+    /* final step for back tracing. */
+    return final_step(scratch, len + 1, keys, key_rests);
+}
+
+/* the parse steps until the 'start' step are kept. */
+void FullPinyinParser2::compute_steps (PhoneticParseScratch * scratch,
+                                       pinyin_option_t options,
+                                       const char *str, int len,
+                                       int start) const {
+    int i;
+    ParseValueVector parse_steps = scratch->m_steps;
+
+    /* init parse steps, and prepare dynamic programming. */
     int step_len = len + 1;
-    g_array_set_size(m_parse_steps, 0);
+    assert(start < step_len);
+    assert(0 == start || start < (int) parse_steps->len);
+    g_array_set_size(parse_steps, 0 == start ? 0 : start + 1);
     parse_value_t value;
-    for (i = 0; i < step_len; ++i) {
-        g_array_append_val(m_parse_steps, value);
+    for (i = parse_steps->len; i < step_len; ++i) {
+        g_array_append_val(parse_steps, value);
     }
 
     size_t next_sep = 0;
-    gchar * input = g_strndup(str, len);
+    const gchar * input = str;
     parse_value_t * curstep = NULL, * nextstep = NULL;
 
-    for (i = 0; i < len; ++i) {
+    /* the steps after 'start' are reached from the previous
+       max_full_pinyin_length chars at most. */
+    i = std_lite::max(0, start + 1 - (int) max_full_pinyin_length);
+    for (; i < len; ++i) {
         if (input[i] == '\'') {
-            curstep = &g_array_index(m_parse_steps, parse_value_t, i);
-            nextstep = &g_array_index(m_parse_steps, parse_value_t, i + 1);
+            next_sep = 0;
+
+            /* the step after "'" is kept. */
+            if (i + 1 <= start)
+                continue;
+
+            curstep = &g_array_index(parse_steps, parse_value_t, i);
+            nextstep = &g_array_index(parse_steps, parse_value_t, i + 1);
 
             /* propagate current step into next step. */
             nextstep->m_key = ChewingKey();
@@ -246,7 +405,6 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
             nextstep->m_parsed_len = curstep->m_parsed_len + 1;
             nextstep->m_distance = curstep->m_distance;
             nextstep->m_last_step = i;
-            next_sep = 0;
             continue;
         }
 
@@ -264,24 +422,57 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
         /* for (size_t m = i; m < next_sep; ++m) */
         {
             size_t m = i;
-            curstep = &g_array_index(m_parse_steps, parse_value_t, m);
+            curstep = &g_array_index(parse_steps, parse_value_t, m);
             size_t try_len = std_lite::min
                 (m + max_full_pinyin_length, next_sep);
+
+            /* extend all the pinyins from m in one scan,
+               the cursor is at the prefix before the char n - 1. */
+            pinyin_index_cursor_t cursor(m_pinyin_index, m_pinyin_index_len);
             for (size_t n = m + 1; n < try_len + 1; ++n) {
-                nextstep = &g_array_index(m_parse_steps, parse_value_t, n);
+                const char chr = input[n - 1];
+
+                /* the tone ends the pinyin, same as parse_one_key. */
+                const bool has_tone = (options & USE_TONE) &&
+                    '0' < chr && chr <= '5';
+
+                const pinyin_index_item_t * item = NULL;
+                if (has_tone) {
+                    item = cursor.get_item();
+                } else {
+                    if (!cursor.step(chr))
+                        break;
+
+                    if (!((options & USE_TONE) && (options & FORCE_TONE)))
+                        item = cursor.get_item();
+                }
+
+                /* only the steps after 'start' are re-computed. */
+                if ((int) n <= start) {
+                    if (has_tone)
+                        break;
+                    continue;
+                }
+
+                nextstep = &g_array_index(parse_steps, parse_value_t, n);
 
                 /* gen next step */
                 gint16 distance = 0;
-                const char * onepinyin = input + m;
                 gint16 onepinyinlen = n - m;
                 value = parse_value_t();
 
                 ChewingKey key; ChewingKeyRest rest;
-                bool parsed = parse_one_key
-                    (options, key, distance, onepinyin, onepinyinlen);
+                bool parsed = get_pinyin_key(options, item, key, distance);
+                if (parsed && has_tone)
+                    key.m_tone = chr - '0';
                 rest.m_raw_begin = m; rest.m_raw_end = n;
-                if (!parsed)
+
+                if (!parsed) {
+                    /* no more chars after the tone. */
+                    if (has_tone)
+                        break;
                     continue;
+                }
 
                 //printf("onepinyin:%s len:%d\n", onepinyin, onepinyinlen);
 
@@ -325,33 +516,26 @@ int FullPinyinParser2::parse (pinyin_option_t options, ChewingKeyVector & keys,
                      value.m_key.m_final == CHEWING_A))
                     *nextstep = value;
 #endif
+
+                /* no more chars after the tone. */
+                if (has_tone)
+                    break;
             }
         }
     }
-
-    /* final step for back tracing. */
-    gint16 parsed_len = final_step(step_len, keys, key_rests);
-
-#if 0
-    /* post processing for re-split table. */
-    if (options & USE_RESPLIT_TABLE) {
-        post_process2(options, keys, key_rests, str, len);
-    }
-#endif
-
-    g_free(input);
-    return parsed_len;
 }
 
-int FullPinyinParser2::final_step(size_t step_len, ChewingKeyVector & keys,
+int FullPinyinParser2::final_step(PhoneticParseScratch * scratch,
+                                  size_t step_len, ChewingKeyVector & keys,
                                   ChewingKeyRestVector & key_rests) const{
     int i;
+    ParseValueVector parse_steps = scratch->m_steps;
     gint16 parsed_len = 0;
     parse_value_t * curstep = NULL;
 
     /* find longest match, which starts from the beginning of input. */
     for (i = step_len - 1; i >= 0; --i) {
-        curstep = &g_array_index(m_parse_steps, parse_value_t, i);
+        curstep = &g_array_index(parse_steps, parse_value_t, i);
         if (i == curstep->m_parsed_len)
             break;
     }
@@ -374,7 +558,7 @@ int FullPinyinParser2::final_step(size_t step_len, ChewingKeyVector & keys,
         }
 
         /* back ward */
-        curstep = &g_array_index(m_parse_steps, parse_value_t,
+        curstep = &g_array_index(parse_steps, parse_value_t,
                                  curstep->m_last_step);
     }
     return parsed_len;
@@ -624,52 +808,8 @@ bool PinyinDirectParser2::parse_one_key(pinyin_option_t options,
                                         ChewingKey & key,
                                         gint16 & distance,
                                         const char *str, int len) const {
-    /* "'" are not accepted in parse_one_key. */
-    gchar * input = g_strndup(str, len);
-    assert(NULL == strchr(input, '\''));
-
-    guint16 tone = CHEWING_ZERO_TONE; guint16 tone_pos = 0;
-    guint16 parsed_len = len;
-    key = ChewingKey();
-
-    if (options & USE_TONE) {
-        /* find the tone in the last character. */
-        char chr = input[parsed_len - 1];
-        if ( '0' < chr && chr <= '5' ) {
-            tone = chr - '0';
-            parsed_len --;
-            tone_pos = parsed_len;
-        }
-
-        /* check the force tone option. */
-        if (options & FORCE_TONE && CHEWING_ZERO_TONE == tone) {
-            g_free(input);
-            return false;
-        }
-    }
-
-    /* parse pinyin core staff here. */
-
-    /* Note: optimize here? */
-    input[parsed_len] = '\0';
-    if (!search_pinyin_index2(options, m_pinyin_index, m_pinyin_index_len,
-                              input, key, distance)) {
-        g_free(input);
-        return false;
-    }
-
-    if (options & USE_TONE) {
-        /* post processing tone. */
-        if ( parsed_len == tone_pos ) {
-            if (tone != CHEWING_ZERO_TONE) {
-                key.m_tone = tone;
-                parsed_len ++;
-            }
-        }
-    }
-
-    g_free(input);
-    return parsed_len == len;
+    return parse_one_pinyin(options, m_pinyin_index, m_pinyin_index_len,
+                            key, distance, str, len);
 }
 
 int PinyinDirectParser2::parse(pinyin_option_t options,
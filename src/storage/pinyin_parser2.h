@@ -133,11 +133,56 @@ public:
 };
 
 
+/**
+ * PhoneticParseScratch:
+ *
+ * The dynamic programming steps of FullPinyinParser2, owned by the caller,
+ *   so one parser can be shared by the threads.
+ *
+ * Note: the steps of the previous input are kept for parse_incremental.
+ *
+ */
+class PhoneticParseScratch
+{
+public:
+    ParseValueVector m_steps;
+
+    /* the input, options and pinyin index of the parse steps,
+       the input is empty when the parse steps can't be re-used. */
+    GString * m_input;
+    pinyin_option_t m_options;
+    const pinyin_index_item_t * m_index;
+
+private:
+    /* no copy. */
+    PhoneticParseScratch(const PhoneticParseScratch & other);
+    PhoneticParseScratch & operator=(const PhoneticParseScratch & other);
+
+public:
+    PhoneticParseScratch();
+    ~PhoneticParseScratch();
+
+    /**
+     * PhoneticParseScratch::clear:
+     *
+     * Drop the saved input, the next parse_incremental call re-computes
+     * all the parse steps.
+     *
+     */
+    void clear() {
+        g_string_truncate(m_input, 0);
+    }
+};
+
+
 /**
  * FullPinyinParser2:
  *
  * Parses the full pinyin string into an array of struct ChewingKeys.
  *
+ * Note: the parser itself is read-only after set_scheme, the parse steps
+ *   live in the PhoneticParseScratch.
+ *
  */
 class FullPinyinParser2 : public PhoneticParser2
 {
@@ -146,24 +191,61 @@ class FullPinyinParser2 : public PhoneticParser2
     size_t m_pinyin_index_len;
 
 protected:
-    ParseValueVector m_parse_steps;
+    void compute_steps(PhoneticParseScratch * scratch,
+                       pinyin_option_t options, const char *str, int len,
+                       int start) const;
 
-    int final_step(size_t step_len, ChewingKeyVector & keys,
+    int final_step(PhoneticParseScratch * scratch, size_t step_len,
+                   ChewingKeyVector & keys,
                    ChewingKeyRestVector & key_rests) const;
 
 public:
     FullPinyinParser2();
-    virtual ~FullPinyinParser2() {
-        g_array_free(m_parse_steps, TRUE);
-    }
+    virtual ~FullPinyinParser2() {}
 
     virtual bool parse_one_key(pinyin_option_t options, ChewingKey & key, gint16 & distance, const char *str, int len) const;
 
     /* Note:
-     *   the parse method will use dynamic programming to drive parse_one_key.
+     *   the parse method will use dynamic programming to drive parse_one_key,
+     *   the parse steps are kept in a per-thread scratch.
      */
     virtual int parse(pinyin_option_t options, ChewingKeyVector & keys, ChewingKeyRestVector & key_rests, const char *str, int len) const;
 
+    /**
+     * FullPinyinParser2::parse:
+     * @options: the pinyin options from pinyin_custom2.h.
+     * @scratch: the parse steps owned by the caller.
+     * @keys: the parsed result of struct ChewingKeys.
+     * @key_rests: the parsed result of struct ChewingKeyRests.
+     * @str: the input of the ascii string.
+     * @len: the length of the str.
+     * @returns: the number of chars were actually used.
+     *
+     * Parse the ascii string with the parse steps in the scratch.
+     *
+     */
+    int parse(pinyin_option_t options, PhoneticParseScratch * scratch, ChewingKeyVector & keys, ChewingKeyRestVector & key_rests, const char *str, int len) const;
+
+    /**
+     * FullPinyinParser2::parse_incremental:
+     * @options: the pinyin options from pinyin_custom2.h.
+     * @scratch: the parse steps owned by the caller.
+     * @keys: the parsed result of struct ChewingKeys.
+     * @key_rests: the parsed result of struct ChewingKeyRests.
+     * @str: the input of the ascii string.
+     * @len: the length of the str.
+     * @returns: the number of chars were actually used.
+     *
+     * Parse the ascii string as the parse method, and re-use the parse
+     * steps of the common prefix with the previous parse_incremental call
+     * with the same scratch.
+     *
+     * Note: the parse step after some chars only depends on these chars,
+     *   so only the steps after the common prefix are re-computed.
+     *
+     */
+    int parse_incremental(pinyin_option_t options, PhoneticParseScratch * scratch, ChewingKeyVector & keys, ChewingKeyRestVector & key_rests, const char *str, int len) const;
+
 public:
     bool set_scheme(FullPinyinScheme scheme);
 };
@@ -24,6 +24,7 @@
 #include <assert.h>
 #include "novel_types.h"
 #include "chewing_key.h"
+#include "pinyin_custom2.h"
 
 /* All compare function should be symmetric for the lhs and rhs operands.
    URL: http://en.cppreference.com/w/cpp/algorithm/equal_range . */
@@ -177,6 +178,169 @@ inline void compute_incomplete_chewing_index(const ChewingKey * in_keys,
     }
 }
 
+/* collapse the ambiguous initials into one fuzzy class,
+   regardless of the fuzzy pinyin options. */
+inline ChewingInitial compute_fuzzy_initial(ChewingInitial initial) {
+    switch (initial) {
+    case CHEWING_CH:
+        return CHEWING_C;
+    case CHEWING_SH:
+        return CHEWING_S;
+    case CHEWING_ZH:
+        return CHEWING_Z;
+    case CHEWING_H:
+        return CHEWING_F;
+    case CHEWING_K:
+        return CHEWING_G;
+    case CHEWING_N:
+    case CHEWING_R:
+        return CHEWING_L;
+    default:
+        return initial;
+    }
+}
+
+/* collapse the ambiguous finals into one fuzzy class,
+   regardless of the fuzzy pinyin options. */
+inline ChewingFinal compute_fuzzy_final(ChewingFinal final) {
+    switch (final) {
+    case CHEWING_ANG:
+        return CHEWING_AN;
+    case CHEWING_ENG:
+        return CHEWING_EN;
+    case PINYIN_ING:
+        return PINYIN_IN;
+    default:
+        return final;
+    }
+}
+
+/* the fuzzy chewing index is marked by the zero padding bit,
+   to share the chewing table with the chewing index. */
+inline void compute_fuzzy_chewing_index(const ChewingKey * in_keys,
+                                        ChewingKey * out_keys,
+                                        int phrase_length) {
+    for (int i = 0; i < phrase_length; ++i) {
+        ChewingKey key = in_keys[i];
+        key.m_initial = compute_fuzzy_initial
+            ((ChewingInitial) key.m_initial);
+        key.m_final = compute_fuzzy_final((ChewingFinal) key.m_final);
+        key.m_tone = CHEWING_ZERO_TONE;
+        key.m_zero_padding = 1;
+        out_keys[i] = key;
+    }
+}
+
+inline void compute_incomplete_fuzzy_chewing_index(const ChewingKey * in_keys,
+                                                   ChewingKey * out_keys,
+                                                   int phrase_length) {
+    for (int i = 0; i < phrase_length; ++i) {
+        ChewingKey key;
+        key.m_initial = compute_fuzzy_initial
+            ((ChewingInitial) in_keys[i].m_initial);
+        key.m_zero_padding = 1;
+        out_keys[i] = key;
+    }
+}
+
+inline bool pinyin_fuzzy_initial_equal(pinyin_option_t options,
+                                       ChewingInitial lhs,
+                                       ChewingInitial rhs) {
+    if (lhs == rhs)
+        return true;
+
+#define MATCH(AMBIGUITY, ORIGIN, ANOTHER) do {                  \
+        if (options & AMBIGUITY) {                              \
+            if ((ORIGIN == lhs && ANOTHER == rhs) ||            \
+                (ANOTHER == lhs && ORIGIN == rhs))              \
+                return true;                                    \
+        }                                                       \
+    } while (0)
+
+    MATCH(PINYIN_AMB_C_CH, CHEWING_C, CHEWING_CH);
+    MATCH(PINYIN_AMB_Z_ZH, CHEWING_Z, CHEWING_ZH);
+    MATCH(PINYIN_AMB_S_SH, CHEWING_S, CHEWING_SH);
+    MATCH(PINYIN_AMB_L_R, CHEWING_L, CHEWING_R);
+    MATCH(PINYIN_AMB_L_N, CHEWING_L, CHEWING_N);
+    MATCH(PINYIN_AMB_F_H, CHEWING_F, CHEWING_H);
+    MATCH(PINYIN_AMB_G_K, CHEWING_G, CHEWING_K);
+
+#undef MATCH
+
+    return false;
+}
+
+inline bool pinyin_fuzzy_final_equal(pinyin_option_t options,
+                                     ChewingFinal lhs,
+                                     ChewingFinal rhs) {
+    if (lhs == rhs)
+        return true;
+
+#define MATCH(AMBIGUITY, ORIGIN, ANOTHER) do {                  \
+        if (options & AMBIGUITY) {                              \
+            if ((ORIGIN == lhs && ANOTHER == rhs) ||            \
+                (ANOTHER == lhs && ORIGIN == rhs))              \
+                return true;                                    \
+        }                                                       \
+    } while (0)
+
+    MATCH(PINYIN_AMB_AN_ANG, CHEWING_AN, CHEWING_ANG);
+    MATCH(PINYIN_AMB_EN_ENG, CHEWING_EN, CHEWING_ENG);
+    MATCH(PINYIN_AMB_IN_ING, PINYIN_IN, PINYIN_ING);
+
+#undef MATCH
+
+    return false;
+}
+
+/* compare with the fuzzy pinyin options, incomplete pinyin and zero tone,
+   matches the same keys as fuzzy_syllable_step appends for key_lhs. */
+inline bool pinyin_fuzzy_equal_with_tones(pinyin_option_t options,
+                                          const ChewingKey * key_lhs,
+                                          const ChewingKey * key_rhs,
+                                          int phrase_length) {
+    for (int i = 0; i < phrase_length; ++i) {
+        const ChewingKey lhs = key_lhs[i];
+        const ChewingKey rhs = key_rhs[i];
+
+        if (0 != pinyin_compare_tone3((ChewingTone) lhs.m_tone,
+                                      (ChewingTone) rhs.m_tone))
+            return false;
+
+        /* handle in-complete pinyin here. */
+        const bool incomplete =
+            (CHEWING_ZERO_MIDDLE == lhs.m_middle &&
+             CHEWING_ZERO_FINAL == lhs.m_final) ||
+            (CHEWING_ZERO_MIDDLE == rhs.m_middle &&
+             CHEWING_ZERO_FINAL == rhs.m_final);
+
+        if (!incomplete) {
+            if (lhs.m_middle != rhs.m_middle)
+                return false;
+            if (!pinyin_fuzzy_final_equal(options,
+                                          (ChewingFinal) lhs.m_final,
+                                          (ChewingFinal) rhs.m_final))
+                return false;
+        }
+
+        if (lhs.m_initial == rhs.m_initial)
+            continue;
+
+        if (!pinyin_fuzzy_initial_equal(options,
+                                        (ChewingInitial) lhs.m_initial,
+                                        (ChewingInitial) rhs.m_initial))
+            return false;
+
+        /* fuzzy_syllable_step only appends the valid pinyin initials. */
+        ChewingKey key = lhs;
+        key.m_initial = rhs.m_initial;
+        if (0 == key.get_table_index())
+            return false;
+    }
+
+    return true;
+}
+
 template<size_t phrase_length>
 struct PinyinIndexItem2{
     phrase_token_t m_token;
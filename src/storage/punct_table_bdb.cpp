@@ -32,7 +32,7 @@ PunctTable::PunctTable() {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     assert(0 == ret);
 
     m_entry = new PunctTableEntry();
@@ -56,7 +56,7 @@ bool PunctTable::attach(const char * dbfile, guint32 flags) {
 
     m_entry = new PunctTableEntry();
 
-    u_int32_t db_flags = attach_options(flags);
+    u_int32_t db_flags = attach_thread_options(flags);
 
     if (!dbfile)
         return false;
@@ -82,7 +82,7 @@ bool PunctTable::load_db(const char * dbfile) {
     assert(0 == ret);
 
     ret = m_db->open(m_db, NULL, NULL, NULL,
-                     DB_BTREE, DB_CREATE, 0600);
+                     DB_BTREE, DB_CREATE | DB_THREAD, 0600);
     if (ret != 0)
         return false;
 
@@ -151,11 +151,13 @@ bool PunctTable::load_entry(phrase_token_t index) {
 
     DBT db_data;
     memset(&db_data, 0, sizeof(DBT));
+    db_data.flags = DB_DBT_MALLOC;
     int ret = m_db->get(m_db, NULL, &db_key, &db_data, 0);
     if (ret != 0)
         return true;
 
     m_entry->m_chunk.set_content(0, db_data.data, db_data.size);
+    free(db_data.data);
     return true;
 }
 
@@ -209,20 +211,19 @@ bool PunctTable::get_all_items(/* out */ GArray * items) {
 
     /* Initialize our DBTs. */
     memset(&key, 0, sizeof(DBT));
+    key.flags = DB_DBT_REALLOC;
     memset(&data, 0, sizeof(DBT));
+    data.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
 
     /* Iterate over the database, retrieving each record in turn. */
     while ((ret = cursorp->c_get(cursorp, &key, &data, DB_NEXT)) == 0) {
         assert(key.size == sizeof(phrase_token_t));
         phrase_token_t * token = (phrase_token_t *)key.data;
         g_array_append_val(items, *token);
-
-        /* Initialize our DBTs. */
-        memset(&key, 0, sizeof(DBT));
-        memset(&data, 0, sizeof(DBT));
     }
 
     assert (ret == DB_NOTFOUND);
+    free(key.data);
 
     /* Cursors must be closed */
     if (cursorp != NULL)
@@ -44,15 +44,15 @@ struct _zhuyin_context_t{
     FacadePhraseTable3 * m_phrase_table;
     FacadePhraseIndex * m_phrase_index;
     Bigram * m_system_bigram;
+    /* the optional read-only copy of the system bi-gram. */
+    MmapBigram * m_mmap_system_bigram;
     Bigram * m_user_bigram;
 
-    /* lookups. */
-    PhoneticLookup<1, 1> * m_pinyin_lookup;
-    PhraseLookup * m_phrase_lookup;
-
     char * m_system_dir;
     char * m_user_dir;
     bool m_modified;
+    /* increased when the tables or bi-grams are changed. */
+    guint32 m_serial;
 
     SystemTableInfo2 m_system_table_info;
 };
@@ -68,6 +68,12 @@ struct _zhuyin_instance_t{
     PhoneticKeyMatrix m_matrix;
     size_t m_parsed_len;
 
+    /* per-instance lookups, the context is shared among instances. */
+    PhoneticLookup<1> * m_pinyin_lookup;
+    PhraseLookup * m_phrase_lookup;
+    /* the context serial of the last sentence guess. */
+    guint32 m_serial;
+
     /* cached pinyin lookup variables. */
     ForwardPhoneticConstraints * m_constraints;
     NBestMatchResults m_nbest_results;
@@ -275,6 +281,7 @@ zhuyin_context_t * zhuyin_init(const char * systemdir, const char * userdir){
     context->m_system_dir = g_strdup(systemdir);
     context->m_user_dir = g_strdup(userdir);
     context->m_modified = false;
+    context->m_serial = 0;
 
     gchar * filename = g_build_filename
         (context->m_system_dir, SYSTEM_TABLE_INFO, NULL);
@@ -302,6 +309,12 @@ zhuyin_context_t * zhuyin_init(const char * systemdir, const char * userdir){
     g_free(user_filename);
     g_free(system_filename);
 
+    /* prefer the compact system chewing table when available. */
+    system_filename = g_build_filename
+        (context->m_system_dir, SYSTEM_COMPACT_PINYIN_INDEX, NULL);
+    context->m_pinyin_table->load_compact(system_filename);
+    g_free(system_filename);
+
     /* load phrase table */
     context->m_phrase_table = new FacadePhraseTable3;
 
@@ -338,28 +351,27 @@ zhuyin_context_t * zhuyin_init(const char * systemdir, const char * userdir){
     context->m_system_bigram->attach(filename, ATTACH_READONLY);
     g_free(filename);
 
+    context->m_mmap_system_bigram = new MmapBigram;
+    filename = g_build_filename(context->m_system_dir,
+                                SYSTEM_MMAP_BIGRAM, NULL);
+    if (!context->m_mmap_system_bigram->attach(filename)) {
+        delete context->m_mmap_system_bigram;
+        context->m_mmap_system_bigram = NULL;
+    }
+    g_free(filename);
+
     context->m_user_bigram = new Bigram;
     filename = g_build_filename(context->m_user_dir, USER_BIGRAM, NULL);
     context->m_user_bigram->load_db(filename);
     g_free(filename);
 
-    gfloat lambda = context->m_system_table_info.get_lambda();
-
-    context->m_pinyin_lookup = new PhoneticLookup<1, 1>
-        ( lambda,
-          context->m_pinyin_table, context->m_phrase_index,
-          context->m_system_bigram, context->m_user_bigram);
-
-    context->m_phrase_lookup = new PhraseLookup
-        (lambda,
-         context->m_phrase_table, context->m_phrase_index,
-         context->m_system_bigram, context->m_user_bigram);
-
     return context;
 }
 
 bool zhuyin_load_phrase_library(zhuyin_context_t * context,
                                 guint8 index){
+    context->m_serial++;
+
     if (!(index < PHRASE_INDEX_LIBRARY_COUNT))
         return false;
 
@@ -378,6 +390,8 @@ bool zhuyin_load_phrase_library(zhuyin_context_t * context,
 
 bool zhuyin_unload_phrase_library(zhuyin_context_t * context,
                                   guint8 index){
+    context->m_serial++;
+
     assert(index < PHRASE_INDEX_LIBRARY_COUNT);
 
     /* default table. */
@@ -541,6 +555,7 @@ void zhuyin_end_add_phrases(import_iterator_t * iter){
     /* compact the content memory chunk of phrase index. */
     iter->m_context->m_phrase_index->compact();
     iter->m_context->m_modified = true;
+    iter->m_context->m_serial++;
     delete iter;
 }
 
@@ -745,9 +760,8 @@ void zhuyin_fini(zhuyin_context_t * context){
     delete context->m_phrase_table;
     delete context->m_phrase_index;
     delete context->m_system_bigram;
+    delete context->m_mmap_system_bigram;
     delete context->m_user_bigram;
-    delete context->m_pinyin_lookup;
-    delete context->m_phrase_lookup;
 
     g_free(context->m_system_dir);
     g_free(context->m_user_dir);
@@ -759,6 +773,7 @@ void zhuyin_fini(zhuyin_context_t * context){
 bool zhuyin_mask_out(zhuyin_context_t * context,
                      phrase_token_t mask,
                      phrase_token_t value) {
+    context->m_serial++;
 
     context->m_pinyin_table->mask_out(mask, value);
     context->m_phrase_table->mask_out(mask, value);
@@ -836,7 +851,6 @@ bool zhuyin_set_options(zhuyin_context_t * context,
     context->m_options = options;
 #if 0
     context->m_pinyin_table->set_options(context->m_options);
-    context->m_pinyin_lookup->set_options(context->m_options);
 #endif
     return true;
 }
@@ -850,6 +864,23 @@ zhuyin_instance_t * zhuyin_alloc_instance(zhuyin_context_t * context){
 
     instance->m_parsed_len = 0;
 
+    gfloat lambda = context->m_system_table_info.get_lambda();
+
+    instance->m_pinyin_lookup = new PhoneticLookup<1>
+        (lambda,
+         context->m_pinyin_table, context->m_phrase_index,
+         context->m_system_bigram, context->m_user_bigram);
+
+    instance->m_pinyin_lookup->set_incremental(true);
+    instance->m_pinyin_lookup->get_bigram_cache()->set_mmap_system_bigram
+        (context->m_mmap_system_bigram);
+    instance->m_serial = context->m_serial;
+
+    instance->m_phrase_lookup = new PhraseLookup
+        (lambda,
+         context->m_phrase_table, context->m_phrase_index,
+         context->m_system_bigram, context->m_user_bigram);
+
     instance->m_constraints = new ForwardPhoneticConstraints
         (context->m_phrase_index);
 
@@ -875,6 +906,8 @@ static bool _free_candidates(CandidateVector candidates) {
 
 void zhuyin_free_instance(zhuyin_instance_t * instance){
     g_array_free(instance->m_prefixes, TRUE);
+    delete instance->m_pinyin_lookup;
+    delete instance->m_phrase_lookup;
     delete instance->m_constraints;
     g_array_free(instance->m_phrase_result, TRUE);
     _free_candidates(instance->m_candidates);
@@ -892,6 +925,18 @@ static bool zhuyin_update_constraints(zhuyin_instance_t * instance){
     return true;
 }
 
+/* drop the saved trellis when the context is changed. */
+static bool _check_context_serial(zhuyin_instance_t * instance){
+    zhuyin_context_t * & context = instance->m_context;
+
+    if (instance->m_serial == context->m_serial)
+        return false;
+
+    instance->m_pinyin_lookup->invalidate();
+    instance->m_serial = context->m_serial;
+    return true;
+}
+
 bool zhuyin_guess_sentence(zhuyin_instance_t * instance){
     zhuyin_context_t * & context = instance->m_context;
     PhoneticKeyMatrix & matrix = instance->m_matrix;
@@ -900,7 +945,8 @@ bool zhuyin_guess_sentence(zhuyin_instance_t * instance){
     g_array_append_val(instance->m_prefixes, sentence_start);
 
     zhuyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_nbest_match
+    _check_context_serial(instance);
+    bool retval = instance->m_pinyin_lookup->get_nbest_match
         (instance->m_prefixes,
          &matrix,
          instance->m_constraints,
@@ -953,7 +999,8 @@ bool zhuyin_guess_sentence_with_prefix(zhuyin_instance_t * instance,
     _compute_prefixes(instance, prefix);
 
     zhuyin_update_constraints(instance);
-    bool retval = context->m_pinyin_lookup->get_nbest_match
+    _check_context_serial(instance);
+    bool retval = instance->m_pinyin_lookup->get_nbest_match
         (instance->m_prefixes,
          &matrix,
          instance->m_constraints,
@@ -972,7 +1019,7 @@ bool zhuyin_phrase_segment(zhuyin_instance_t * instance,
 
     g_return_val_if_fail(num_of_chars == ucs4_len, FALSE);
 
-    bool retval = context->m_phrase_lookup->get_best_match
+    bool retval = instance->m_phrase_lookup->get_best_match
         (ucs4_len, ucs4_str, instance->m_phrase_result);
 
     g_free(ucs4_str);
@@ -1228,7 +1275,7 @@ static void _append_items(PhraseIndexRanges ranges,
 
 static void _compute_frequency_of_items(zhuyin_context_t * context,
                                         phrase_token_t prev_token,
-                                        SingleGram * merged_gram,
+                                        const SingleGram * merged_gram,
                                         CandidateVector items) {
     pinyin_option_t & options = context->m_options;
     ssize_t i;
@@ -1470,6 +1517,9 @@ bool zhuyin_guess_candidates_after_cursor(zhuyin_instance_t * instance,
     if (0 == matrix.size())
         return false;
 
+    /* drop the cached single grams when the context is changed. */
+    _check_context_serial(instance);
+
     /* lookup the previous token here. */
     phrase_token_t prev_token = null_token;
 
@@ -1477,53 +1527,42 @@ bool zhuyin_guess_candidates_after_cursor(zhuyin_instance_t * instance,
         prev_token = _get_previous_token(instance, offset);
     }
 
-    SingleGram merged_gram;
-    SingleGram * system_gram = NULL, * user_gram = NULL;
+    SingleGram empty_gram;
+    const SingleGram * merged_gram = &empty_gram;
 
     if (options & DYNAMIC_ADJUST) {
         if (null_token != prev_token) {
-            context->m_system_bigram->load(prev_token, system_gram);
-            context->m_user_bigram->load(prev_token, user_gram);
-            merge_single_gram(&merged_gram, system_gram, user_gram);
+            MergedSingleGramCache * cache =
+                instance->m_pinyin_lookup->get_bigram_cache();
+            if (!cache->load(prev_token, merged_gram))
+                merged_gram = &empty_gram;
         }
     }
 
-    PhraseIndexRanges ranges;
-    memset(ranges, 0, sizeof(ranges));
-    context->m_phrase_index->prepare_ranges(ranges);
+    MatrixSearchResults results(context->m_phrase_index);
 
     _check_offset(matrix, offset);
 
     /* matrix reserved one extra slot. */
     const size_t start = offset;
-    for (size_t end = start + 1; end < matrix.size(); ++end) {
-        /* do pinyin search. */
-        context->m_phrase_index->clear_ranges(ranges);
-        int retval = search_matrix(context->m_pinyin_table, &matrix,
-                                   start, end, ranges);
 
-        if ( !(retval & SEARCH_OK) )
+    /* do pinyin search for all ends in one pass. */
+    search_matrix_all(context->m_pinyin_table, &matrix,
+                      start, matrix.size() - 1, &results);
+
+    for (size_t end = start + 1; end < matrix.size(); ++end) {
+        if ( !(results.get_result(end) & SEARCH_OK) )
             continue;
 
         lookup_candidate_t template_item;
         template_item.m_begin = start; template_item.m_end = end;
-        _append_items(ranges, &template_item, candidates);
-
-        if ( !(retval & SEARCH_CONTINUED) )
-            break;
+        _append_items(results.get_ranges(end), &template_item, candidates);
     }
-
-    context->m_phrase_index->destroy_ranges(ranges);
-    if (system_gram)
-        delete system_gram;
-    if (user_gram)
-        delete user_gram;
-
     /* post process to sort the candidates */
 
     _compute_phrase_length(context, candidates);
 
-    _compute_frequency_of_items(context, prev_token, &merged_gram, candidates);
+    _compute_frequency_of_items(context, prev_token, merged_gram, candidates);
 
     /* sort the candidates by length and frequency. */
     g_array_sort(candidates, compare_item_with_length_and_frequency);
@@ -1551,6 +1590,9 @@ bool zhuyin_guess_candidates_before_cursor(zhuyin_instance_t * instance,
     if (0 == matrix.size())
         return false;
 
+    /* drop the cached single grams when the context is changed. */
+    _check_context_serial(instance);
+
     PhraseIndexRanges ranges;
     memset(ranges, 0, sizeof(ranges));
     context->m_phrase_index->prepare_ranges(ranges);
@@ -1571,14 +1613,15 @@ bool zhuyin_guess_candidates_before_cursor(zhuyin_instance_t * instance,
             prev_token = _get_previous_token(instance, start);
         }
 
-        SingleGram merged_gram;
-        SingleGram * system_gram = NULL, * user_gram = NULL;
+        SingleGram empty_gram;
+        const SingleGram * merged_gram = &empty_gram;
 
         if (options & DYNAMIC_ADJUST) {
             if (null_token != prev_token) {
-                context->m_system_bigram->load(prev_token, system_gram);
-                context->m_user_bigram->load(prev_token, user_gram);
-                merge_single_gram(&merged_gram, system_gram, user_gram);
+                MergedSingleGramCache * cache =
+                    instance->m_pinyin_lookup->get_bigram_cache();
+                if (!cache->load(prev_token, merged_gram))
+                    merged_gram = &empty_gram;
             }
         }
 
@@ -1595,16 +1638,11 @@ bool zhuyin_guess_candidates_before_cursor(zhuyin_instance_t * instance,
         template_item.m_begin = start; template_item.m_end = offset;
         _append_items(ranges, &template_item, items);
 
-        if (system_gram)
-            delete system_gram;
-        if (user_gram)
-            delete user_gram;
-
         /* post process to sort the items */
 
         _compute_phrase_length(context, items);
 
-        _compute_frequency_of_items(context, prev_token, &merged_gram, items);
+        _compute_frequency_of_items(context, prev_token, merged_gram, items);
 
         /* sort the items by length and frequency. */
         g_array_sort(items, compare_item_with_length_and_frequency);
@@ -1705,11 +1743,12 @@ bool zhuyin_train(zhuyin_instance_t * instance){
         return false;
 
     context->m_modified = true;
+    context->m_serial++;
 
     MatchResult result = NULL;
     check_result(results.get_result(0, result));
 
-    bool retval = context->m_pinyin_lookup->train_result3
+    bool retval = instance->m_pinyin_lookup->train_result3
         (&matrix, instance->m_constraints, result);
 
     return retval;
@@ -1829,6 +1868,7 @@ bool zhuyin_token_add_unigram_frequency(zhuyin_instance_t * instance,
                                         phrase_token_t token,
                                         guint delta){
     zhuyin_context_t * & context = instance->m_context;
+    context->m_serial++;
     int retval = context->m_phrase_index->add_unigram_frequency
         (token, delta);
     return ERROR_OK == retval;
@@ -0,0 +1,154 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pinyin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* the candidate identity, the phrase token is internal,
+   and the phrase strings of the candidates are unique at one offset. */
+struct candidate_item_t {
+    lookup_candidate_type_t m_type;
+    gchar * m_string;
+    guint8 m_nbest_index;
+};
+
+/* Array of candidate_item_t */
+static GArray * get_candidates(pinyin_instance_t * instance) {
+    GArray * items = g_array_new(FALSE, TRUE, sizeof(candidate_item_t));
+
+    guint num = 0;
+    pinyin_get_n_candidate(instance, &num);
+    for (guint i = 0; i < num; ++i) {
+        lookup_candidate_t * candidate = NULL;
+        pinyin_get_candidate(instance, i, &candidate);
+
+        candidate_item_t item;
+        memset(&item, 0, sizeof(item));
+        pinyin_get_candidate_type(instance, candidate, &item.m_type);
+
+        const gchar * str = NULL;
+        pinyin_get_candidate_string(instance, candidate, &str);
+        item.m_string = g_strdup(str);
+
+        if (NBEST_MATCH_CANDIDATE == item.m_type)
+            pinyin_get_candidate_nbest_index
+                (instance, candidate, &item.m_nbest_index);
+
+        g_array_append_val(items, item);
+    }
+
+    return items;
+}
+
+static void free_candidates(GArray * items) {
+    for (size_t i = 0; i < items->len; ++i)
+        g_free(g_array_index(items, candidate_item_t, i).m_string);
+    g_array_free(items, TRUE);
+}
+
+/* the full pinyin separator "'" is parsed into one zero key column,
+   the candidates can't start right after it. */
+static bool is_zero_key_offset(const char * input, size_t offset) {
+    return offset > 0 && '\'' == input[offset - 1];
+}
+
+int main(int argc, char * argv[]){
+    const char * inputs[] = {
+        "nihao", "zhongguo", "zhonghuarenmingongheguo",
+        "xi'an", "changan", "shenme", "jintiantianqizhenhao",
+        "zhdd", "wobuzhidaozenmeban"
+    };
+
+    pinyin_context_t * context =
+        pinyin_init("../../data", "../../data");
+    assert(NULL != context);
+
+    pinyin_option_t options = PINYIN_INCOMPLETE |
+        PINYIN_CORRECT_ALL | USE_DIVIDED_TABLE | USE_RESPLIT_TABLE |
+        DYNAMIC_ADJUST;
+    pinyin_set_options(context, options);
+
+    pinyin_instance_t * instance = pinyin_alloc_instance(context);
+    const guint sort_option = SORT_BY_PHRASE_LENGTH | SORT_BY_FREQUENCY;
+
+    for (size_t n = 0; n < G_N_ELEMENTS(inputs); ++n) {
+        pinyin_parse_more_full_pinyins(instance, inputs[n]);
+        pinyin_guess_sentence(instance);
+
+        const size_t len = pinyin_get_parsed_input_length(instance);
+
+        /* the candidates computed at each offset. */
+        GPtrArray * expected = g_ptr_array_new();
+        for (size_t offset = 0; offset < len; ++offset) {
+            if (is_zero_key_offset(inputs[n], offset)) {
+                g_ptr_array_add(expected, NULL);
+                continue;
+            }
+
+            pinyin_guess_candidates(instance, offset, sort_option);
+            g_ptr_array_add(expected, get_candidates(instance));
+        }
+
+        /* the cached candidates of the batch are the same and
+           in the same order. */
+        bool retval = pinyin_guess_candidates_batch(instance, sort_option);
+        assert(retval);
+        for (size_t offset = 0; offset < len; ++offset) {
+            if (is_zero_key_offset(inputs[n], offset))
+                continue;
+
+            pinyin_guess_candidates(instance, offset, sort_option);
+            GArray * batch = get_candidates(instance);
+            GArray * items = (GArray *) g_ptr_array_index(expected, offset);
+
+            assert(items->len == batch->len);
+            for (size_t i = 0; i < items->len; ++i) {
+                candidate_item_t * item =
+                    &g_array_index(items, candidate_item_t, i);
+                candidate_item_t * batch_item =
+                    &g_array_index(batch, candidate_item_t, i);
+
+                assert(item->m_type == batch_item->m_type);
+                assert(0 == g_strcmp0(item->m_string, batch_item->m_string));
+                assert(item->m_nbest_index == batch_item->m_nbest_index);
+            }
+
+            free_candidates(batch);
+            free_candidates(items);
+        }
+        g_ptr_array_free(expected, TRUE);
+
+        printf("input:%s\toffsets:%zu\n", inputs[n], len);
+        pinyin_reset(instance);
+    }
+
+    pinyin_free_instance(instance);
+    pinyin_fini(context);
+
+    return 0;
+}
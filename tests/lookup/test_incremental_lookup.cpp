@@ -0,0 +1,227 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "pinyin_internal.h"
+#include "tests_helper.h"
+
+/* fill the matrix of the pinyin string. */
+static bool build_matrix(pinyin_option_t options,
+                         const char * str, size_t len,
+                         PhoneticKeyMatrix * matrix) {
+    FullPinyinParser2 parser;
+    ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    ChewingKeyRestVector key_rests =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+    int parsed_len = parser.parse(options, keys, key_rests, str, len);
+
+    bool retval = 0 != keys->len;
+    if (retval) {
+        fill_matrix(matrix, keys, key_rests, parsed_len);
+
+        resplit_step(options, matrix);
+
+        inner_split_step(options, matrix);
+
+        fuzzy_syllable_step(options, matrix);
+    }
+
+    g_array_free(keys, TRUE);
+    g_array_free(key_rests, TRUE);
+    return retval;
+}
+
+static void assert_same_results(const NBestMatchResults & lhs,
+                                const NBestMatchResults & rhs) {
+    assert(lhs.size() == rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        MatchResult lhs_result = NULL, rhs_result = NULL;
+        check_result(lhs.get_result(i, lhs_result));
+        check_result(rhs.get_result(i, rhs_result));
+
+        assert(lhs_result->len == rhs_result->len);
+        assert(0 == memcmp(lhs_result->data, rhs_result->data,
+                           lhs_result->len * sizeof(phrase_token_t)));
+    }
+}
+
+int main( int argc, char * argv[]){
+    const char * inputs[] = {
+        "nihao", "zhongguo", "xi'an", "changan", "shenme", "zhdd",
+        "jintiantianqizhenhao", "wobuzhidaozenmeban",
+        "zhonghuarenmingongheguozhongyangrenminzhengfu"
+    };
+
+    SystemTableInfo2 system_table_info;
+
+    bool retval = system_table_info.load("../../data/table.conf");
+    if (!retval) {
+        fprintf(stderr, "load table.conf failed.\n");
+        exit(ENOENT);
+    }
+
+    pinyin_option_t options =
+        USE_TONE | PINYIN_CORRECT_ALL | PINYIN_INCOMPLETE;
+    FacadeChewingTable2 largetable;
+
+    largetable.load("../../data/pinyin_index.bin", NULL);
+
+    const pinyin_table_info_t * phrase_files =
+        system_table_info.get_default_tables();
+
+    FacadePhraseIndex phrase_index;
+    if (!load_phrase_index(phrase_files, &phrase_index))
+        exit(ENOENT);
+
+    Bigram system_bigram;
+    system_bigram.attach("../../data/bigram.db", ATTACH_READONLY);
+    Bigram user_bigram;
+    user_bigram.attach(NULL, ATTACH_CREATE|ATTACH_READWRITE);
+
+    gfloat lambda = system_table_info.get_lambda();
+
+    /* the fresh lookup, the other lookups are checked against it. */
+    PhoneticLookup<2> pinyin_lookup(lambda, &largetable, &phrase_index,
+                                    &system_bigram, &user_bigram);
+    pinyin_lookup.set_nbest(3);
+    NBestMatchResults results;
+
+    /* re-use the trellis steps of the previous prefix of the input. */
+    PhoneticLookup<2> incremental_lookup(lambda, &largetable, &phrase_index,
+                                         &system_bigram, &user_bigram);
+    incremental_lookup.set_incremental(true);
+    incremental_lookup.set_nbest(3);
+    NBestMatchResults incremental_results;
+    NBestMatchResults prefix_results;
+
+    /* the narrow beam expands less states in one step. */
+    const size_t narrow_width = 8;
+    PhoneticLookup<2> narrow_lookup(lambda, &largetable, &phrase_index,
+                                    &system_bigram, &user_bigram);
+    narrow_lookup.set_beam(narrow_width, 20.);
+    NBestMatchResults narrow_results;
+
+    /* the more results are extracted on demand. */
+    const size_t wide_nbest = 10;
+    PhoneticLookup<2> wide_lookup(lambda, &largetable, &phrase_index,
+                                  &system_bigram, &user_bigram);
+    wide_lookup.set_nbest(wide_nbest);
+    NBestMatchResults wide_results;
+
+    /* the parallel expansion should get the same results. */
+    PhoneticLookup<2> parallel_lookup(lambda, &largetable, &phrase_index,
+                                      &system_bigram, &user_bigram);
+    parallel_lookup.set_nbest(3);
+    check_result(parallel_lookup.set_parallel(4));
+    NBestMatchResults parallel_results;
+
+    /* prepare the prefixes for get_nbest_match. */
+    TokenVector prefixes = g_array_new
+        (FALSE, FALSE, sizeof(phrase_token_t));
+    g_array_append_val(prefixes, sentence_start);
+
+    ForwardPhoneticConstraints constraints(&phrase_index);
+    ForwardPhoneticConstraints prefix_constraints(&phrase_index);
+
+    for (size_t n = 0; n < G_N_ELEMENTS(inputs); ++n) {
+        const char * input = inputs[n];
+
+        PhoneticKeyMatrix matrix;
+        retval = build_matrix(options, input, strlen(input), &matrix);
+        assert(retval);
+
+        constraints.validate_constraint(&matrix);
+        pinyin_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                      &results);
+
+        /* type the input one character at a time, the incremental mode
+           re-uses the steps of the shorter prefix, and should get
+           the same results as the fresh lookup. */
+        for (size_t len = 1; len <= strlen(input); ++len) {
+            PhoneticKeyMatrix prefix_matrix;
+            if (!build_matrix(options, input, len, &prefix_matrix))
+                continue;
+
+            prefix_constraints.validate_constraint(&prefix_matrix);
+
+            pinyin_lookup.get_nbest_match(prefixes, &prefix_matrix,
+                                          &prefix_constraints,
+                                          &prefix_results);
+            incremental_lookup.get_nbest_match(prefixes, &prefix_matrix,
+                                               &prefix_constraints,
+                                               &incremental_results);
+            assert_same_results(prefix_results, incremental_results);
+        }
+
+        /* the whole input after the prefixes. */
+        incremental_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                           &incremental_results);
+        assert_same_results(results, incremental_results);
+
+        parallel_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                        &parallel_results);
+        assert_same_results(results, parallel_results);
+
+        /* the lazy results should have the same best sentence. */
+        wide_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                    &wide_results);
+        assert(wide_results.size() <= wide_nbest);
+        assert(wide_results.size() >= results.size());
+        if (results.size() > 0) {
+            MatchResult result = NULL, wide = NULL;
+            check_result(results.get_result(0, result));
+            check_result(wide_results.get_result(0, wide));
+
+            assert(result->len == wide->len);
+            assert(0 == memcmp(result->data, wide->data,
+                               result->len * sizeof(phrase_token_t)));
+        }
+
+        for (size_t i = 1; i < wide_results.size(); ++i) {
+            MatchResult wide = NULL;
+            check_result(wide_results.get_result(i, wide));
+            assert(wide->len == matrix.size());
+        }
+
+        /* the expired deadline still gets the complete sentences. */
+        narrow_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                      &narrow_results, g_get_monotonic_time());
+        assert(matrix.size() <= 1 || narrow_lookup.is_degraded());
+        assert((0 == results.size()) == (0 == narrow_results.size()));
+
+        narrow_lookup.reset_beam_histogram();
+        narrow_lookup.get_nbest_match(prefixes, &matrix, &constraints,
+                                      &narrow_results);
+
+        const GArray * histogram = narrow_lookup.get_beam_histogram();
+        assert(histogram->len <= narrow_width + 1);
+
+        printf("input:%s\tresults:%zu\n", input, results.size());
+    }
+
+    g_array_free(prefixes, TRUE);
+
+    return 0;
+}
@@ -30,6 +30,32 @@
 
 size_t bench_times = 100;
 
+/* fill the matrix of the pinyin string. */
+static bool build_matrix(pinyin_option_t options,
+                         const char * str, size_t len,
+                         PhoneticKeyMatrix * matrix) {
+    FullPinyinParser2 parser;
+    ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    ChewingKeyRestVector key_rests =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+    int parsed_len = parser.parse(options, keys, key_rests, str, len);
+
+    bool retval = 0 != keys->len;
+    if (retval) {
+        fill_matrix(matrix, keys, key_rests, parsed_len);
+
+        resplit_step(options, matrix);
+
+        inner_split_step(options, matrix);
+
+        fuzzy_syllable_step(options, matrix);
+    }
+
+    g_array_free(keys, TRUE);
+    g_array_free(key_rests, TRUE);
+    return retval;
+}
+
 int main( int argc, char * argv[]){
     SystemTableInfo2 system_table_info;
 
@@ -59,8 +85,9 @@ int main( int argc, char * argv[]){
 
     gfloat lambda = system_table_info.get_lambda();
 
-    PhoneticLookup<2, 3> pinyin_lookup(lambda, &largetable, &phrase_index,
-                                       &system_bigram, &user_bigram);
+    PhoneticLookup<2> pinyin_lookup(lambda, &largetable, &phrase_index,
+                                    &system_bigram, &user_bigram);
+    pinyin_lookup.set_nbest(3);
 
     /* prepare the prefixes for get_nbest_match. */
     TokenVector prefixes = g_array_new
@@ -79,32 +106,13 @@ int main( int argc, char * argv[]){
         if ( strcmp ( linebuf, "quit" ) == 0)
             break;
 	
-        FullPinyinParser2 parser;
-        ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
-        ChewingKeyRestVector key_rests =
-            g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
-        int parsed_len = parser.parse(options, keys, key_rests,
-                                      linebuf, strlen(linebuf));
-
         PhoneticKeyMatrix matrix;
 
-        if ( 0 == keys->len ) /* invalid pinyin */
-            continue;
-
-        /* fill the matrix. */
-        fill_matrix(&matrix, keys, key_rests, parsed_len);
-
-        resplit_step(options, &matrix);
-
-        inner_split_step(options, &matrix);
-
-        fuzzy_syllable_step(options, &matrix);
+        if (!build_matrix(options, linebuf, strlen(linebuf), &matrix))
+            continue; /* invalid pinyin */
 
         dump_matrix(&matrix);
 
-        g_array_free(keys, TRUE);
-        g_array_free(key_rests, TRUE);
-
         /* initialize constraints. */
         constraints.validate_constraint(&matrix);
 
@@ -113,6 +121,10 @@ int main( int argc, char * argv[]){
             pinyin_lookup.get_nbest_match(prefixes, &matrix, &constraints, &results);
         print_time(start_time, bench_times);
 
+        guint32 hits = 0, misses = 0;
+        pinyin_lookup.get_pronunciation_cache_stats(hits, misses);
+        printf("pronunciation cache hits:%d misses:%d\n", hits, misses);
+
         for (size_t i = 0; i < results.size(); ++i) {
             MatchResult result = NULL;
             check_result(results.get_result(i, result));
@@ -29,6 +29,65 @@
 
 size_t bench_times = 1000;
 
+/* search all the fuzzy pinyin keys one by one. */
+static int search_fuzzy_one_by_one(ChewingLargeTable2 * largetable,
+                                   pinyin_option_t options,
+                                   ChewingKey keys[], int phrase_length,
+                                   int pos, PhraseIndexRanges ranges) {
+    if (pos == phrase_length)
+        return largetable->search(phrase_length, keys, ranges);
+
+    int result = SEARCH_NONE;
+    const ChewingKey key = keys[pos];
+    const bool incomplete = contains_incomplete_pinyin(&key, 1);
+
+    for (int initial = 0; initial < CHEWING_NUMBER_OF_INITIALS; ++initial) {
+        for (int final = 0; final < CHEWING_NUMBER_OF_FINALS; ++final) {
+            ChewingKey newkey = key;
+            newkey.m_initial = initial;
+            if (!incomplete)
+                newkey.m_final = final;
+            else if (CHEWING_ZERO_FINAL != final)
+                continue;
+
+            if (!pinyin_fuzzy_equal_with_tones(options, &key, &newkey, 1))
+                continue;
+
+            keys[pos] = newkey;
+            result |= search_fuzzy_one_by_one
+                (largetable, options, keys, phrase_length, pos + 1, ranges);
+        }
+    }
+
+    keys[pos] = key;
+    return result;
+}
+
+static void collect_tokens(PhraseIndexRanges ranges, GArray * tokens) {
+    g_array_set_size(tokens, 0);
+
+    for (size_t m = 0; m < PHRASE_INDEX_LIBRARY_COUNT; ++m) {
+        GArray * range = ranges[m];
+        if (NULL == range)
+            continue;
+
+        for (size_t n = 0; n < range->len; ++n) {
+            PhraseIndexRange * item = &g_array_index
+                (range, PhraseIndexRange, n);
+            for (phrase_token_t token = item->m_range_begin;
+                 token < item->m_range_end; ++token) {
+                size_t k = 0;
+                for (k = 0; k < tokens->len; ++k) {
+                    if (token == g_array_index(tokens, phrase_token_t, k))
+                        break;
+                }
+                if (k == tokens->len)
+                    g_array_append_val(tokens, token);
+            }
+        }
+    }
+}
+
 int main(int argc, char * argv[]) {
     SystemTableInfo2 system_table_info;
 
@@ -50,6 +109,30 @@ int main(int argc, char * argv[]) {
                            NULL, &phrase_index, type))
         exit(ENOENT);
 
+    /* build the compact chewing table from the same table files. */
+    ChewingCompactTableBuilder builder;
+    for (size_t i = 0; i < PHRASE_INDEX_LIBRARY_COUNT; ++i) {
+        const pinyin_table_info_t * table_info = phrase_files + i;
+
+        if (SYSTEM_FILE != table_info->m_file_type)
+            continue;
+
+        gchar * filename = g_build_filename("..", "..", "data",
+                                            table_info->m_table_filename,
+                                            NULL);
+        FILE * tablefile = fopen(filename, "r");
+        g_free(filename);
+        if (NULL == tablefile)
+            exit(ENOENT);
+
+        builder.load_text(tablefile, type);
+        fclose(tablefile);
+    }
+    check_result(builder.save("/tmp/compact_pinyin_index.bin"));
+
+    ChewingCompactTable compacttable;
+    check_result(compacttable.attach("/tmp/compact_pinyin_index.bin"));
+
 #if 0
     MemoryChunk * new_chunk = new MemoryChunk;
     largetable.store(new_chunk);
@@ -101,6 +184,74 @@ int main(int argc, char * argv[]) {
         phrase_index.clear_ranges(ranges);
         largetable.search(keys->len, (ChewingKey *)keys->data, ranges);
 
+        /* the compact chewing table returns the same ranges. */
+        PhraseIndexRanges compact_ranges;
+        memset(compact_ranges, 0, sizeof(PhraseIndexRanges));
+        phrase_index.prepare_ranges(compact_ranges);
+
+        start = record_time();
+        for (i = 0; i < bench_times; ++i) {
+            phrase_index.clear_ranges(compact_ranges);
+            compacttable.search(keys->len, (ChewingKey *)keys->data,
+                                compact_ranges);
+        }
+        print_time(start, bench_times);
+
+        for (i = 1; i <= keys->len; ++i) {
+            phrase_index.clear_ranges(ranges);
+            phrase_index.clear_ranges(compact_ranges);
+            int large_retval = largetable.search
+                (i, (ChewingKey *)keys->data, ranges);
+            int compact_retval = compacttable.search
+                (i, (ChewingKey *)keys->data, compact_ranges);
+            assert(large_retval == compact_retval);
+
+            for (size_t m = 0; m < PHRASE_INDEX_LIBRARY_COUNT; ++m) {
+                GArray * range = ranges[m];
+                GArray * compact_range = compact_ranges[m];
+                if (NULL == range)
+                    continue;
+                assert(range->len == compact_range->len);
+                assert(0 == memcmp(range->data, compact_range->data,
+                                   range->len * sizeof(PhraseIndexRange)));
+            }
+        }
+
+        /* the fuzzy chewing index returns the same tokens as
+           searching the fuzzy pinyin keys one by one. */
+        pinyin_option_t fuzzy_options = PINYIN_AMB_ALL;
+        GArray * tokens = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+        GArray * fuzzy_tokens = g_array_new
+            (FALSE, FALSE, sizeof(phrase_token_t));
+
+        for (i = 1; i <= keys->len; ++i) {
+            phrase_index.clear_ranges(ranges);
+            search_fuzzy_one_by_one(&largetable, fuzzy_options,
+                                    (ChewingKey *)keys->data, i, 0, ranges);
+            collect_tokens(ranges, tokens);
+
+            phrase_index.clear_ranges(ranges);
+            largetable.search_fuzzy(fuzzy_options, i,
+                                    (ChewingKey *)keys->data, ranges);
+            collect_tokens(ranges, fuzzy_tokens);
+            assert(tokens->len == fuzzy_tokens->len);
+
+            phrase_index.clear_ranges(compact_ranges);
+            compacttable.search_fuzzy(fuzzy_options, i,
+                                      (ChewingKey *)keys->data,
+                                      compact_ranges);
+            collect_tokens(compact_ranges, fuzzy_tokens);
+            assert(tokens->len == fuzzy_tokens->len);
+        }
+
+        g_array_free(tokens, TRUE);
+        g_array_free(fuzzy_tokens, TRUE);
+
+        phrase_index.destroy_ranges(compact_ranges);
+
+        phrase_index.clear_ranges(ranges);
+        largetable.search(keys->len, (ChewingKey *)keys->data, ranges);
+
         dump_ranges(&phrase_index, ranges);
 
         phrase_index.destroy_ranges(ranges);
@@ -111,6 +262,8 @@ int main(int argc, char * argv[]) {
     if (linebuf)
         free(linebuf);
 
+    printf("filter rejects:%d\n", largetable.get_filter_rejects());
+
     /* mask out all index items. */
     largetable.mask_out(0x0, 0x0);
 
@@ -103,13 +103,24 @@ int main(int argc, char * argv[]) {
     if (!load_phrase_index(phrase_files, &phrase_index))
         exit(ENOENT);
 
-    PhoneticParser2 * parser = new FullPinyinParser2();
+    FullPinyinParser2 * parser = new FullPinyinParser2();
     ChewingKeyVector keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
     ChewingKeyRestVector key_rests =
         g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
 
     PhoneticKeyMatrix matrix;
 
+    /* the incremental parse shares the parser with its own scratch. */
+    PhoneticParseScratch scratch;
+    ChewingKeyVector incremental_keys =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    ChewingKeyRestVector incremental_key_rests =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+    ChewingKeyVector prev_keys = g_array_new(FALSE, FALSE, sizeof(ChewingKey));
+    ChewingKeyRestVector prev_key_rests =
+        g_array_new(FALSE, FALSE, sizeof(ChewingKeyRest));
+    PhoneticKeyMatrix incremental_matrix;
+
     char* linebuf = NULL; size_t size = 0; ssize_t read;
     while( (read = getline(&linebuf, &size, stdin)) != -1 ){
         if ( '\n' == linebuf[strlen(linebuf) - 1] ) {
@@ -141,6 +152,45 @@ int main(int argc, char * argv[]) {
 
         dump_matrix(&matrix);
 
+        /* check the incremental parse against the full parse,
+           type the input one char by one char, then delete them. */
+        const pinyin_option_t incremental_options =
+            options | USE_RESPLIT_TABLE | USE_DIVIDED_TABLE;
+        const int linelen = strlen(linebuf);
+        for (int k = 1; k <= 2 * linelen - 1; ++k) {
+            const int prefix = k <= linelen ? k : 2 * linelen - k;
+
+            int incremental_len = parser->parse_incremental
+                (incremental_options, &scratch,
+                 incremental_keys, incremental_key_rests,
+                 linebuf, prefix);
+            refill_matrix(incremental_options, &incremental_matrix,
+                          prev_keys, prev_key_rests,
+                          incremental_keys, incremental_key_rests,
+                          incremental_len);
+
+            g_array_set_size(prev_keys, 0);
+            g_array_append_vals(prev_keys, incremental_keys->data,
+                                incremental_keys->len);
+            g_array_set_size(prev_key_rests, 0);
+            g_array_append_vals(prev_key_rests, incremental_key_rests->data,
+                                incremental_key_rests->len);
+
+            PhoneticKeyMatrix full_matrix;
+            int full_len = parser->parse(incremental_options, keys, key_rests,
+                                         linebuf, prefix);
+            fill_matrix(&full_matrix, keys, key_rests, full_len);
+            resplit_step(incremental_options, &full_matrix);
+            inner_split_step(incremental_options, &full_matrix);
+            fuzzy_syllable_step(incremental_options, &full_matrix);
+
+            assert(full_len == incremental_len);
+            assert(keys->len == incremental_keys->len);
+            assert(full_matrix.size() == incremental_matrix.size());
+            assert(diff_matrix(&full_matrix, &incremental_matrix) ==
+                   full_matrix.size());
+        }
+
         PhraseIndexRanges ranges;
         memset(ranges, 0, sizeof(PhraseIndexRanges));
 
@@ -166,6 +216,22 @@ int main(int argc, char * argv[]) {
             }
         }
 
+        /* check the one pass search against search_matrix. */
+        MatrixSearchResults results(&phrase_index);
+
+        for (size_t i = 0; i < matrix.size(); ++i) {
+            search_matrix_all(&largetable, &matrix,
+                              i, matrix.size() - 1, &results);
+
+            for (size_t j = i + 1; j < matrix.size(); ++j) {
+                phrase_index.clear_ranges(ranges);
+
+                int retval = search_matrix(&largetable, &matrix, i, j, ranges);
+                assert((retval & SEARCH_OK) ==
+                       (results.get_result(j) & SEARCH_OK));
+            }
+        }
+
         phrase_index.destroy_ranges(ranges);
     }
 
@@ -174,6 +240,10 @@ int main(int argc, char * argv[]) {
 
     delete parser;
 
+    g_array_free(prev_key_rests, TRUE);
+    g_array_free(prev_keys, TRUE);
+    g_array_free(incremental_key_rests, TRUE);
+    g_array_free(incremental_keys, TRUE);
     g_array_free(key_rests, TRUE);
     g_array_free(keys, TRUE);
 
@@ -78,8 +78,81 @@ int main(int argc, char * argv[]){
     check_result(bigram.save_db("/tmp/snapshot.db"));
     check_result(bigram.load_db("/tmp/snapshot.db"));
 
+    /* check the filter of the previous tokens. */
+    for (phrase_token_t token = 100; token < 200; ++token) {
+        assert(!bigram.load(token, gram));
+    }
+    assert(0 < bigram.get_filter_rejects());
+    printf("filter rejects:%d\n", bigram.get_filter_rejects());
+
+    check_result(bigram.store(100, &single_gram));
+    check_result(bigram.load(100, gram));
+    delete gram;
+    check_result(bigram.remove(100));
+
     g_array_free(items, TRUE);
 
+    /* check the merged single gram cache. */
+    MergedSingleGramCache cache(NULL, &bigram, 1);
+    const SingleGram * merged = NULL;
+    check_result(cache.load(2, merged));
+    check_result(merged->get_total_freq(freq));
+    assert(32 == freq);
+
+    /* evict the token 2. */
+    assert(!cache.load(3, merged));
+
+    single_gram.set_total_freq(64);
+    bigram.store(2, &single_gram);
+    cache.invalidate(2);
+    check_result(cache.load(2, merged));
+    check_result(merged->get_total_freq(freq));
+    assert(64 == freq);
+
+    /* check the read-only bi-gram. */
+    check_result(MmapBigram::save(&bigram, "/tmp/test.bin"));
+    MmapBigram mmap_bigram;
+    check_result(mmap_bigram.attach("/tmp/test.bin"));
+
+    GArray * mmap_items = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    mmap_bigram.get_all_items(mmap_items);
+    assert(2 == mmap_items->len);
+    g_array_free(mmap_items, TRUE);
+
+    SingleGram view;
+    check_result(mmap_bigram.load_view(2, view));
+    check_result(view.get_total_freq(freq));
+    assert(64 == freq);
+    check_result(view.get_freq(5, freq));
+    assert(8 == freq);
+    assert(!mmap_bigram.load_view(3, view));
+
+    /* the offset and the length of the corrupted file wrap around. */
+    gchar * contents = NULL; gsize length = 0;
+    check_result(g_file_get_contents("/tmp/test.bin", &contents,
+                                     &length, NULL));
+    mmap_bigram_index_item_t * item = (mmap_bigram_index_item_t *)
+        (contents + sizeof(guint32));
+    item->m_length = G_MAXUINT32 - item->m_offset + 1 + sizeof(guint32);
+    check_result(g_file_set_contents("/tmp/test.bin", contents,
+                                     length, NULL));
+    g_free(contents);
+    MmapBigram corrupted_bigram;
+    assert(!corrupted_bigram.attach("/tmp/test.bin"));
+
+    /* the tokens of the corrupted directory are not sorted. */
+    check_result(MmapBigram::save(&bigram, "/tmp/test.bin"));
+    check_result(g_file_get_contents("/tmp/test.bin", &contents,
+                                     &length, NULL));
+    item = (mmap_bigram_index_item_t *) (contents + sizeof(guint32));
+    phrase_token_t token = item[0].m_token;
+    item[0].m_token = item[1].m_token; item[1].m_token = token;
+    check_result(g_file_set_contents("/tmp/test.bin", contents,
+                                     length, NULL));
+    g_free(contents);
+    assert(!corrupted_bigram.attach("/tmp/test.bin"));
+    assert(!corrupted_bigram.load_view(2, view));
+
     /* mask out all index items. */
     bigram.mask_out(0x0, 0x0);
 
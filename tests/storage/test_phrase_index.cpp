@@ -1,6 +1,8 @@
 #include "timer.h"
 #include <stdio.h>
 #include <errno.h>
+#include <math.h>
+#include <float.h>
 #include "pinyin_internal.h"
 #include "tests_helper.h"
 
@@ -70,6 +72,55 @@ int main(int argc, char * argv[]){
         assert(poss == 0.5);
     }
 
+    {
+        /* modify the phrase items after loaded. */
+        ChewingKey key3 = ChewingKey(CHEWING_ZH, CHEWING_ZERO_MIDDLE,
+                                     CHEWING_ENG);
+
+        PhraseItem * removed_item = NULL;
+        check_result(ERROR_OK ==
+                     phrase_index_test.remove_phrase_item(1, removed_item));
+        removed_item->add_pronunciation(&key3, 600);
+        check_result(ERROR_OK ==
+                     phrase_index_test.add_phrase_item(1, removed_item));
+        delete removed_item;
+
+        check_result(ERROR_OK ==
+                     phrase_index_test.add_phrase_item(2, &phrase_item));
+        check_result(ERROR_OK ==
+                     phrase_index_test.add_unigram_frequency(2, 5));
+
+        PhraseItem item6;
+        check_result(ERROR_OK == phrase_index_test.get_phrase_item(1, item6));
+        assert(item6.get_n_pronunciation() == 3);
+        assert(item6.get_pronunciation_possibility(&key3) == 0.5);
+        check_result(ERROR_OK == phrase_index_test.get_phrase_item(2, item6));
+        assert(item6.get_unigram_frequency() == 5);
+
+        /* the unigram items follow the overlay. */
+        const PhraseUnigramItem * unigram = NULL;
+        check_result(ERROR_OK ==
+                     phrase_index_test.get_unigram_item(2, unigram));
+        assert(unigram->m_length == 1);
+        assert(unigram->m_freq == 5);
+        assert(fabs(unigram->m_log_freq - log(5.)) < DBL_EPSILON);
+        assert(ERROR_OK != phrase_index_test.get_unigram_item(3, unigram));
+
+        PhraseIndexRange range;
+        check_result(ERROR_OK == phrase_index_test.get_range(0, range));
+        assert(range.m_range_end == 3);
+
+        /* the stored chunk contains the overlay. */
+        MemoryChunk * merged = new MemoryChunk;
+        check_result(phrase_index_test.store(0, merged));
+        FacadePhraseIndex phrase_index_merged;
+        check_result(phrase_index_merged.load(0, merged));
+        check_result(ERROR_OK == phrase_index_merged.get_phrase_item(1, item6));
+        assert(item6.get_n_pronunciation() == 3);
+        check_result(ERROR_OK == phrase_index_merged.get_phrase_item(2, item6));
+        assert(item6.get_unigram_frequency() == 5);
+    }
+
     SystemTableInfo2 system_table_info;
 
     bool retval = system_table_info.load("../../data/table.conf");
@@ -115,6 +166,26 @@ int main(int argc, char * argv[]){
     phrase_index.get_phrase_item(16870553, item2);
     assert( item2.get_unigram_frequency() == 3);
 
+    const PhraseUnigramItem * unigram = NULL;
+    check_result(ERROR_OK == phrase_index.get_unigram_item(16870553, unigram));
+    assert(unigram->m_length == 14);
+    assert(unigram->m_freq == 3);
+
+    /* the unigram items match the phrase items after load. */
+    PhraseIndexRange range;
+    check_result(ERROR_OK == phrase_index.get_range(1, range));
+    for (phrase_token_t token = range.m_range_begin;
+         token < range.m_range_end; ++token) {
+        bool found = ERROR_OK == phrase_index.get_phrase_item(token, item2);
+        assert(found ==
+               (ERROR_OK == phrase_index.get_unigram_item(token, unigram)));
+        if (!found)
+            continue;
+
+        assert(unigram->m_length == item2.get_phrase_length());
+        assert(unigram->m_freq == item2.get_unigram_frequency());
+    }
+
     phrase_index.get_phrase_item(16777222, item2);
     assert(item2.get_phrase_length() == 1);
     assert(item2.get_n_pronunciation() == 2);
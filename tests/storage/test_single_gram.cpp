@@ -0,0 +1,227 @@
+/*
+ *  libpinyin
+ *  Library to deal with pinyin.
+ *
+ *  Copyright (C) 2025 Peng Wu <alexepico@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timer.h"
+#include <errno.h>
+#include <string.h>
+#include "pinyin_internal.h"
+
+/* benchmark the single gram kernels over the real bi-gram rows. */
+
+size_t bench_times = 10;
+
+static bool token_less_than(const SingleGramItem & lhs,
+                            const SingleGramItem & rhs) {
+    return lhs.m_token < rhs.m_token;
+}
+
+static size_t search_rows(GPtrArray * grams, GPtrArray * rows,
+                          BigramPhraseArray array, bool vectorized) {
+    size_t num = 0;
+
+    for (size_t i = 0; i < rows->len; ++i) {
+        SingleGram * single_gram = (SingleGram *) g_ptr_array_index(grams, i);
+        GArray * row = (GArray *) g_ptr_array_index(rows, i);
+        const SingleGramItem * items = (const SingleGramItem *) row->data;
+
+        guint32 total_freq = 0;
+        check_result(single_gram->get_total_freq(total_freq));
+
+        for (size_t index = 1; index < PHRASE_INDEX_LIBRARY_COUNT; ++index) {
+            const phrase_token_t begin = PHRASE_INDEX_MAKE_TOKEN(index, 0);
+            const phrase_token_t end = begin + PHRASE_MASK + 1;
+
+            SingleGramItem compare_item;
+            compare_item.m_token = begin;
+            const SingleGramItem * start = std_lite::lower_bound
+                (items, items + row->len, compare_item,
+                 token_less_than);
+
+            const size_t count = single_gram_scan_range
+                (start, items + row->len - start, end, vectorized);
+
+            g_array_set_size(array, count);
+            single_gram_normalize(start, count, total_freq,
+                                  (BigramPhraseItem *) array->data,
+                                  vectorized);
+            num += count;
+        }
+    }
+
+    return num;
+}
+
+int main(int argc, char * argv[]) {
+    Bigram system_bigram;
+    if (!system_bigram.attach("../../data/bigram.db", ATTACH_READONLY)) {
+        fprintf(stderr, "attach bigram.db failed.\n");
+        exit(ENOENT);
+    }
+
+    GArray * tokens = g_array_new(FALSE, FALSE, sizeof(phrase_token_t));
+    check_result(system_bigram.get_all_items(tokens));
+
+    /* load the rows. */
+    GPtrArray * grams = g_ptr_array_new();
+    GPtrArray * rows = g_ptr_array_new();
+    BigramPhraseWithCountArray items = g_array_new
+        (FALSE, FALSE, sizeof(BigramPhraseItemWithCount));
+
+    for (size_t i = 0; i < tokens->len; ++i) {
+        SingleGram * single_gram = NULL;
+        phrase_token_t token = g_array_index(tokens, phrase_token_t, i);
+        check_result(system_bigram.load(token, single_gram, true));
+        g_ptr_array_add(grams, single_gram);
+
+        g_array_set_size(items, 0);
+        check_result(single_gram->retrieve_all(items));
+
+        GArray * row = g_array_sized_new
+            (FALSE, FALSE, sizeof(SingleGramItem), items->len);
+        for (size_t k = 0; k < items->len; ++k) {
+            BigramPhraseItemWithCount * item =
+                &g_array_index(items, BigramPhraseItemWithCount, k);
+            SingleGramItem row_item;
+            row_item.m_token = item->m_token;
+            row_item.m_freq = item->m_count;
+            g_array_append_val(row, row_item);
+        }
+        g_ptr_array_add(rows, row);
+    }
+
+    printf("loaded %d rows.\n", rows->len);
+
+    /* check the SIMD kernels against the scalar kernels. */
+    BigramPhraseArray scalar = g_array_new
+        (FALSE, FALSE, sizeof(BigramPhraseItem));
+    BigramPhraseArray vectorized = g_array_new
+        (FALSE, FALSE, sizeof(BigramPhraseItem));
+
+    for (size_t i = 0; i < rows->len; ++i) {
+        GArray * row = (GArray *) g_ptr_array_index(rows, i);
+        const SingleGramItem * row_items = (const SingleGramItem *) row->data;
+
+        for (size_t k = 0; k <= row->len; ++k) {
+            const phrase_token_t end = k < row->len ?
+                row_items[k].m_token : PHRASE_INDEX_MAKE_TOKEN(15, 0);
+            assert(single_gram_scan_range(row_items, row->len, end, false) ==
+                   single_gram_scan_range(row_items, row->len, end, true));
+        }
+
+        g_array_set_size(scalar, row->len);
+        g_array_set_size(vectorized, row->len);
+        single_gram_normalize(row_items, row->len, 1 + i,
+                              (BigramPhraseItem *) scalar->data, false);
+        single_gram_normalize(row_items, row->len, 1 + i,
+                              (BigramPhraseItem *) vectorized->data, true);
+        assert(0 == memcmp(scalar->data, vectorized->data,
+                           row->len * sizeof(BigramPhraseItem)));
+    }
+
+    size_t scalar_num = 0, vectorized_num = 0;
+
+    printf("scalar search:\n");
+    guint32 start_time = record_time();
+    for (size_t i = 0; i < bench_times; ++i)
+        scalar_num = search_rows(grams, rows, scalar, false);
+    print_time(start_time, bench_times * rows->len);
+
+    printf("vectorized search:\n");
+    start_time = record_time();
+    for (size_t i = 0; i < bench_times; ++i)
+        vectorized_num = search_rows(grams, rows, vectorized, true);
+    print_time(start_time, bench_times * rows->len);
+    assert(scalar_num == vectorized_num);
+
+    /* merge with the empty and the sparse user single grams. */
+    SingleGram empty_user;
+    SingleGram merged;
+
+    printf("merge with the empty user single gram:\n");
+    start_time = record_time();
+    for (size_t i = 0; i < bench_times; ++i) {
+        for (size_t k = 0; k < grams->len; ++k) {
+            SingleGram * system = (SingleGram *) g_ptr_array_index(grams, k);
+            check_result(merge_single_gram(&merged, system, &empty_user));
+        }
+    }
+    print_time(start_time, bench_times * grams->len);
+
+    /* the user touches some of the system items. */
+    GPtrArray * users = g_ptr_array_new();
+    for (size_t k = 0; k < rows->len; ++k) {
+        GArray * row = (GArray *) g_ptr_array_index(rows, k);
+
+        SingleGram * user = new SingleGram;
+        for (size_t n = 0; n < row->len; n += 8) {
+            SingleGramItem * item = &g_array_index(row, SingleGramItem, n);
+            check_result(user->insert_freq(item->m_token, 1));
+        }
+        check_result(user->set_total_freq((row->len + 7) / 8));
+        g_ptr_array_add(users, user);
+    }
+
+    printf("merge with the sparse user single gram:\n");
+    start_time = record_time();
+    for (size_t i = 0; i < bench_times; ++i) {
+        for (size_t k = 0; k < grams->len; ++k) {
+            SingleGram * system = (SingleGram *) g_ptr_array_index(grams, k);
+            SingleGram * user = (SingleGram *) g_ptr_array_index(users, k);
+            check_result(merge_single_gram(&merged, system, user));
+        }
+    }
+    print_time(start_time, bench_times * grams->len);
+
+    /* check the merged single grams. */
+    for (size_t k = 0; k < grams->len; ++k) {
+        SingleGram * system = (SingleGram *) g_ptr_array_index(grams, k);
+        SingleGram * user = (SingleGram *) g_ptr_array_index(users, k);
+        GArray * row = (GArray *) g_ptr_array_index(rows, k);
+
+        check_result(merge_single_gram(&merged, system, user));
+        assert(merged.get_length() == row->len);
+
+        for (size_t n = 0; n < row->len; ++n) {
+            SingleGramItem * item = &g_array_index(row, SingleGramItem, n);
+            guint32 freq = 0;
+            check_result(merged.get_freq(item->m_token, freq));
+            assert(freq == item->m_freq + (0 == n % 8 ? 1 : 0));
+        }
+    }
+
+    for (size_t i = 0; i < users->len; ++i)
+        delete (SingleGram *) g_ptr_array_index(users, i);
+    g_ptr_array_free(users, TRUE);
+
+    for (size_t i = 0; i < grams->len; ++i)
+        delete (SingleGram *) g_ptr_array_index(grams, i);
+    g_ptr_array_free(grams, TRUE);
+
+    for (size_t i = 0; i < rows->len; ++i)
+        g_array_free((GArray *) g_ptr_array_index(rows, i), TRUE);
+    g_ptr_array_free(rows, TRUE);
+
+    g_array_free(scalar, TRUE);
+    g_array_free(vectorized, TRUE);
+    g_array_free(items, TRUE);
+    g_array_free(tokens, TRUE);
+
+    return 0;
+}
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 
 int main(int argc, char * argv[]){
     pinyin_context_t * context =
@@ -93,6 +94,28 @@ int main(int argc, char * argv[]){
         }
         printf("\n");
 
+        /* the same query re-uses the pooled scratch. */
+        pinyin_guess_candidates(instance, 0, sort_option);
+        guint allocations = 0;
+        pinyin_get_query_scratch_allocations(instance, &allocations);
+        assert(0 == allocations);
+
+        /* the batch conversion guesses the same sentence. */
+        char * sentence = NULL;
+        pinyin_guess_sentence(instance);
+        pinyin_get_sentence(instance, 0, &sentence);
+
+        const char * inputs[40]; char * results[40];
+        for (i = 0; i < G_N_ELEMENTS(inputs); ++i)
+            inputs[i] = linebuf;
+        pinyin_convert_batch(context, inputs, G_N_ELEMENTS(inputs),
+                             results, 4);
+        for (i = 0; i < G_N_ELEMENTS(results); ++i) {
+            assert(0 == g_strcmp0(sentence, results[i]));
+            g_free(results[i]);
+        }
+        g_free(sentence);
+
         pinyin_train(instance, 0);
         pinyin_reset(instance);
         pinyin_save(context);
@@ -34,6 +34,7 @@ static GOptionEntry entries[] =
 };
 
 bool generate_binary_files(const char * pinyin_table_filename,
+                           const char * compact_pinyin_table_filename,
                            const char * phrase_table_filename,
                            const pinyin_table_info_t * phrase_files,
                            TABLE_PHONETIC_TYPE type) {
@@ -41,6 +42,9 @@ bool generate_binary_files(const char * pinyin_table_filename,
     ChewingLargeTable2 pinyin_table;
     pinyin_table.attach(pinyin_table_filename, ATTACH_READWRITE|ATTACH_CREATE);
 
+    /* generate compact pinyin index */
+    ChewingCompactTableBuilder compact_pinyin_table;
+
     PhraseLargeTable3 phrase_table;
     phrase_table.attach(phrase_table_filename, ATTACH_READWRITE|ATTACH_CREATE);
 
@@ -67,6 +71,8 @@ bool generate_binary_files(const char * pinyin_table_filename,
 
         pinyin_table.load_text(tablefile, type);
         fseek(tablefile, 0L, SEEK_SET);
+        compact_pinyin_table.load_text(tablefile, type);
+        fseek(tablefile, 0L, SEEK_SET);
         phrase_table.load_text(tablefile);
         fseek(tablefile, 0L, SEEK_SET);
         phrase_index.load_text(i, tablefile, type);
@@ -74,6 +80,9 @@ bool generate_binary_files(const char * pinyin_table_filename,
         g_free(filename);
     }
 
+    if (!compact_pinyin_table.save(compact_pinyin_table_filename))
+        exit(ENOENT);
+
     phrase_index.compact();
 
     if (!save_phrase_index(phrase_files, &phrase_index))
@@ -136,12 +145,14 @@ int main(int argc, char * argv[]){
 
     TABLE_PHONETIC_TYPE type = system_table_info.get_table_phonetic_type();
     generate_binary_files(SYSTEM_PINYIN_INDEX,
+                          SYSTEM_COMPACT_PINYIN_INDEX,
                           SYSTEM_PHRASE_INDEX,
                           phrase_files, type);
 
     phrase_files = system_table_info.get_addon_tables();
 
     generate_binary_files(ADDON_SYSTEM_PINYIN_INDEX,
+                          ADDON_SYSTEM_COMPACT_PINYIN_INDEX,
                           ADDON_SYSTEM_PHRASE_INDEX,
                           phrase_files, type);
 
@@ -309,5 +309,11 @@ int main(int argc, char * argv[]){
     if (!save_phrase_index(phrase_files, &phrase_index))
         exit(ENOENT);
 
+    /* write the read-only bi-gram for the memory mapping. */
+    if (!MmapBigram::save(&bigram, SYSTEM_MMAP_BIGRAM)) {
+        fprintf(stderr, "save %s failed!\n", SYSTEM_MMAP_BIGRAM);
+        exit(ENOENT);
+    }
+
     return 0;
 }